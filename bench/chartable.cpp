@@ -0,0 +1,142 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The benchmark of characters table lookups. It feeds a multi-megabyte
+ * buffer of mixed English and Russian text to the characters table in
+ * the form of std::map and CharTable class and then measures text
+ * splitting by TextProcessor class with all other processing turned
+ * off, where characters table lookups are the major work.
+ */
+
+#include"voiceman.h"
+#include"langs/LangManager.h"
+#include"core/AbstractTextProcessor.h"
+#include"core/TextItem.h"
+#include"core/CharTable.h"
+#include"document.h"
+
+#define DEFAULT_DOCUMENT_SIZE 4194304
+#define DEFAULT_ITERATIONS 3
+
+typedef std::map<wchar_t, LangId> WCharToLangIdMap;
+
+static void associate(const std::wstring& str, LangId langId, WCharToLangIdMap& map, CharTable<LangId>& table)
+{
+  for(std::wstring::size_type i = 0;i < str.length();i++)
+    {
+      map[str[i]] = langId;
+      table.set(str[i], langId);
+    }
+}
+
+static void runLookups(const std::wstring& buffer, size_t iterations)
+{
+  WCharToLangIdMap map;
+  CharTable<LangId> table;
+  const LangId engId = langManager.getLangId("eng"), rusId = langManager.getLangId("rus");
+  associate(langManager.getLangById(engId)->getAllChars(), engId, map, table);
+  associate(langManager.getLangById(rusId)->getAllChars(), rusId, map, table);
+  associate(DEFAULT_CHARACTERS, LANG_ID_NONE, map, table);
+  double bestMap = 0, bestTable = 0;
+  unsigned long mapSum = 0, tableSum = 0;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      mapSum = 0;
+      tableSum = 0;
+      double start = getTime();
+      for(std::wstring::size_type i = 0;i < buffer.length();i++)
+	{
+	  WCharToLangIdMap::const_iterator it = map.find(buffer[i]);
+	  mapSum = mapSum * 3 + (it != map.end()?(unsigned long)it->second + 1:0);
+	}
+      const double mapElapsed = getTime() - start;
+      start = getTime();
+      for(std::wstring::size_type i = 0;i < buffer.length();i++)
+	{
+	  const LangId* langId = table.find(buffer[i]);
+	  tableSum = tableSum * 3 + (langId != NULL?(unsigned long)*langId + 1:0);
+	}
+      const double tableElapsed = getTime() - start;
+      if (k == 0 || mapElapsed < bestMap)
+	bestMap = mapElapsed;
+      if (k == 0 || tableElapsed < bestTable)
+	bestTable = tableElapsed;
+    } //for(iterations);
+  printf("lookups  %8lu chars: std::map %8.2f ms (%7.2f Mchars/s), CharTable %8.2f ms (%7.2f Mchars/s), %5.2fx, %s\n",
+	 (unsigned long)buffer.length(),
+	 bestMap * 1000, (double)buffer.length() / bestMap / 1000000,
+	 bestTable * 1000, (double)buffer.length() / bestTable / 1000000,
+	 bestMap / bestTable, mapSum == tableSum?"identical":"DIFFERENT");
+}
+
+static void runSplitting(const WStringVector& lines, size_t documentSize, size_t iterations)
+{
+  auto_ptr<AbstractTextProcessor> textProc = createNewTextProcessor(langManager, DigitsModeNone, 0, 0);
+  const LangId engId = langManager.getLangId("eng"), rusId = langManager.getLangId("rus");
+  textProc->associate(langManager.getLangById(engId)->getAllChars(), engId);
+  textProc->associate(langManager.getLangById(rusId)->getAllChars(), rusId);
+  textProc->setDefaultLangId(engId);
+  textProc->associate(DEFAULT_CHARACTERS, LANG_ID_NONE);
+  double best = 0;
+  size_t itemCount = 0;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      itemCount = 0;
+      const double start = getTime();
+      for(WStringVector::size_type i = 0;i < lines.size();i++)
+	{
+	  TextItemList items;
+	  textProc->process(TextItem(lines[i]), items);
+	  itemCount += items.size();
+	}
+      const double elapsed = getTime() - start;
+      if (k == 0 || elapsed < best)
+	best = elapsed;
+    } //for(iterations);
+  printf("split    %8lu chars in %8.2f ms (%7.2f Mchars/s), %lu items\n",
+	 (unsigned long)documentSize, best * 1000, (double)documentSize / best / 1000000, (unsigned long)itemCount);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+      std::cerr << "usage: " << argv[0] << " DATADIR [DOCUMENT_SIZE [ITERATIONS]]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  const std::string dataDir = argv[1];
+  const size_t documentSize = argc > 2?(size_t)atol(argv[2]):DEFAULT_DOCUMENT_SIZE;
+  const size_t iterations = argc > 3?(size_t)atol(argv[3]):DEFAULT_ITERATIONS;
+  try {
+    langManager.load(dataDir);
+    WStringVector lines;
+    generateDocument(documentSize, lines);
+    std::wstring buffer;
+    for(WStringVector::size_type i = 0;i < lines.size();i++)
+      {
+	buffer += lines[i];
+	buffer += L'\n';
+      }
+    runLookups(buffer, iterations);
+    runSplitting(lines, documentSize, iterations);
+  }
+  catch(const VoicemanException& e)
+    {
+      e.makeLogReport(LOG_ERR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
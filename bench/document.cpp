@@ -0,0 +1,99 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"document.h"
+
+#define LINE_LENGTH 80
+
+static const wchar_t* const engWords[] = {
+  L"the", L"Speech", L"server", L"VoiceMan", L"processes", L"text", L"HTML", L"ID",
+  L"output", L"with", L"punctuation", L"and", L"getValue", L"a", L"Linux", L"terminal",
+  NULL
+};
+
+static const wchar_t* const rusWords[] = {
+  L"\x0441\x0438\x043d\x0442\x0435\x0437", L"\x0440\x0435\x0447\x0438", L"\x0442\x0435\x043a\x0441\x0442",
+  L"\x0421\x0435\x0440\x0432\x0435\x0440", L"\x0438", L"\x0434\x0430\x043d\x043d\x044b\x0435",
+  NULL
+};
+
+static const wchar_t* const punctuation[] = {
+  L".", L",", L";", L":", L"-", L"+", L"=", L"[", L"]", L"(", L")", L"<", L">",
+  L"/", L"\\", L"\"", L"'", L"!", L"?", L"@", L"#", L"$", L"%", L"&", L"*", L"_",
+  L"{", L"}", L"|", L"~", L"^", L"`", L"...", L"->", L"::",
+  NULL
+};
+
+#define RANDOM_SEED 12345
+
+static unsigned long randomState = RANDOM_SEED;
+
+static size_t nextRandom(size_t limit)
+{
+  randomState = randomState * 1103515245 + 12345;
+  return (size_t)((randomState / 65536) % 32768) % limit;
+}
+
+static size_t countItems(const wchar_t* const items[])
+{
+  size_t i = 0;
+  while(items[i] != NULL)
+    i++;
+  return i;
+}
+
+void generateDocument(size_t size, WStringVector& lines)
+{
+  const size_t engCount = countItems(engWords), rusCount = countItems(rusWords), punctCount = countItems(punctuation);
+  size_t total = 0;
+  std::wstring line;
+  lines.clear();
+  randomState = RANDOM_SEED;
+  while(total < size)
+    {
+      const size_t kind = nextRandom(10);
+      std::wstring word;
+      if (kind < 5)
+	word = engWords[nextRandom(engCount)]; else
+      if (kind < 7)
+	word = rusWords[nextRandom(rusCount)]; else
+      if (kind < 9)
+	word = punctuation[nextRandom(punctCount)]; else
+	{
+	  std::wostringstream ss;
+	  ss << nextRandom(100000);
+	  word = ss.str();
+	}
+      if (!line.empty())
+	line += L' ';
+      line += word;
+      total += word.length() + 1;
+      if (line.length() >= LINE_LENGTH)
+	{
+	  lines.push_back(line);
+	  line.erase();
+	}
+    } //while();
+  if (!line.empty())
+    lines.push_back(line);
+}
+
+double getTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
@@ -0,0 +1,35 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_BENCH_DOCUMENT_H__
+#define __VOICEMAN_BENCH_DOCUMENT_H__
+
+/**\brief The characters associated with no language, the same as in default configuration*/
+#define DEFAULT_CHARACTERS L"0123456789.,;:_-+=[]&<>\"'/\\|?~`!@#$%^*(){}"
+
+/**\brief Generates text document for benchmarks
+ *
+ * The document consists of English and Russian words, punctuation and
+ * numbers. The same document is generated on each run.
+ *
+ * \param [in] size The approximate length of the document in characters
+ * \param [out] lines The lines of generated document
+ */
+void generateDocument(size_t size, WStringVector& lines);
+
+/**\brief Returns the value of monotonic clock in seconds*/
+double getTime();
+
+#endif //__VOICEMAN_BENCH_DOCUMENT_H__
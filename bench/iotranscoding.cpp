@@ -0,0 +1,136 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The benchmark of conversions between I/O charset and UNICODE. It
+ * generates long emacspeak trace in the current I/O charset (set with
+ * $LANG) and makes conversions done by voiceman-emacspeak for every
+ * line with Transcoding class and with the iconv() loop allocating new
+ * buffers for every block, as it was done before. Results of both must
+ * be identical.
+ */
+
+#include"voiceman.h"
+#include"document.h"
+
+#define DEFAULT_DOCUMENT_SIZE 4194304
+#define DEFAULT_ITERATIONS 3
+#define ICONV_BLOCK_SIZE 50
+
+/*
+ * The reference implementation;
+ */
+
+static std::wstring referenceIO2WString(iconv_t cd, const std::string& s)
+{
+  std::wstring res;
+  size_t i;
+  char* b = new char[s.length()];
+  char* bb = b;
+  for(i = 0;i < s.length();i++)
+    b[i] = s[i];
+  size_t bSize = s.length();
+  while(bSize)
+    {
+      wchar_t* r = new wchar_t[ICONV_BLOCK_SIZE];
+      char* rr = (char*)r;
+      size_t rsize = ICONV_BLOCK_SIZE * sizeof(wchar_t);
+      const size_t c = iconv(cd, &b, &bSize, &rr, &rsize);
+      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
+	res += r[i];
+      delete[] r;
+      if (c == (size_t)-1 && errno != E2BIG)
+	{
+	  res += L'?';
+	  if (errno != EILSEQ)
+	    break;
+	  b++;
+	  bSize--;
+	}
+    } //while();
+  delete[] bb;
+  return res;
+}
+
+static void generateTrace(size_t size, StringVector& trace)
+{
+  WStringVector lines;
+  generateDocument(size, lines);
+  trace.clear();
+  for(WStringVector::size_type i = 0;i < lines.size();i++)
+    {
+      if (i % 10 == 0)
+	trace.push_back("tts_set_speech_rate 50");
+      trace.push_back("q {" + WString2IO(lines[i]) + "}");
+      if (i % 3 == 0)
+	trace.push_back("l {" + WString2IO(lines[i].substr(0, 1)) + "}");
+      trace.push_back("d");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t documentSize = argc > 1?(size_t)atol(argv[1]):DEFAULT_DOCUMENT_SIZE;
+  const size_t iterations = argc > 2?(size_t)atol(argv[2]):DEFAULT_ITERATIONS;
+  iconv_t cd = iconv_open("utf32le", transcoding.getIOCharset().c_str());
+  if (cd == (iconv_t)-1)
+    {
+      perror("iconv_open()");
+      return EXIT_FAILURE;
+    }
+  StringVector trace;
+  generateTrace(documentSize, trace);
+  size_t bytes = 0;
+  for(StringVector::size_type i = 0;i < trace.size();i++)
+    bytes += trace[i].length();
+  double bestReference = 0, bestTranscoding = 0;
+  bool same = 1;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      StringVector referenceResult(trace.size()), result(trace.size());
+      //The text command was converted twice;
+      double start = getTime();
+      for(StringVector::size_type i = 0;i < trace.size();i++)
+	{
+	  if (trim(referenceIO2WString(cd, trace[i])).length() == 1)
+	    continue;
+	  referenceResult[i] = encodeUTF8(referenceIO2WString(cd, trace[i]));
+	}
+      const double referenceElapsed = getTime() - start;
+      start = getTime();
+      std::wstring w;
+      for(StringVector::size_type i = 0;i < trace.size();i++)
+	{
+	  IO2WString(trace[i], w);
+	  if (trim(w).length() == 1)
+	    continue;
+	  encodeUTF8(w, result[i]);
+	}
+      const double transcodingElapsed = getTime() - start;
+      if (result != referenceResult)
+	same = 0;
+      if (k == 0 || referenceElapsed < bestReference)
+	bestReference = referenceElapsed;
+      if (k == 0 || transcodingElapsed < bestTranscoding)
+	bestTranscoding = transcodingElapsed;
+    } //for(iterations);
+  iconv_close(cd);
+  const double mb = (double)bytes / 1048576;
+  printf("%-12s %8lu lines, %8lu bytes: iconv blocks %8.2f ms (%7.2f MB/s), Transcoding %8.2f ms (%7.2f MB/s), %5.2fx, %s\n",
+	 transcoding.getIOCharset().c_str(), (unsigned long)trace.size(), (unsigned long)bytes,
+	 bestReference * 1000, mb / bestReference, bestTranscoding * 1000, mb / bestTranscoding,
+	 bestReference / bestTranscoding, same?"same results":"RESULTS DIFFER");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,531 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The end-to-end load generator for voicemand. It starts the daemon with
+ * a generated configuration and with itself as a dummy executor, opens
+ * several connections through libvmclient and sends a mix of text,
+ * letter, tone, stop and parameter commands at the target rate. Each
+ * text command carries a marker with unique ID, the dummy executor
+ * records the time each marked text block reaches it, so the latency
+ * from sending of a command to its arrival at the executor is measured.
+ * The CPU time consumed by the daemon during the run is read from /proc.
+ */
+
+#include"voiceman.h"
+#include"CmdArgsParser.h"
+#include"vmclient.h"
+#include"executorCommandHeader.h"
+#include"document.h"
+
+#define DEFAULT_CLIENTS 4
+#define DEFAULT_RATE 1000
+#define DEFAULT_SECONDS 5
+#define DEFAULT_MIX "text=70,letter=15,param=8,tone=5,stop=2"
+#define DOCUMENT_SIZE 65536
+#define MARKER "vmbench"
+#define ID_CONSONANTS "bdfgklmnprstvz"
+#define ID_VOWELS "aeiou"
+#define CONNECT_TIMEOUT 5
+#define DRAIN_TIMEOUT 3
+#define STATS_BUF_SIZE 65536
+
+enum {
+  CommandText = 0,
+  CommandLetter,
+  CommandParam,
+  CommandTone,
+  CommandStop,
+  CommandCount
+};
+
+static const char* const commandNames[CommandCount] = {"text", "letter", "param", "tone", "stop"};
+
+CmdArg cmdLineParams[] = {
+  {'c', "clients", "NUMBER", "open NUMBER concurrent connections to the server;"},
+  {'d', "daemon", "PATH", "run voicemand from PATH;"},
+  {'h', "help", "", "show this help screen and exit;"},
+  {'m', "mix", "SPEC", "use command mix SPEC (default is \"" DEFAULT_MIX "\");"},
+  {'r', "rate", "NUMBER", "send NUMBER commands per second in total;"},
+  {'s', "stats", "", "print server runtime statistics after the load;"},
+  {'t', "time", "SECONDS", "send commands during SECONDS;"},
+  {'x', "executor", "FILE_NAME", "act as dummy executor recording received text blocks to FILE_NAME."},
+  {' ', NULL, NULL, NULL}
+};
+
+CmdArgsParser cmdLine(cmdLineParams);
+
+static bool readAll(int fd, void* buf, size_t size)
+{
+  char* b = (char*)buf;
+  size_t c = 0;
+  while(c < size)
+    {
+      const ssize_t res = read(fd, b + c, size - c);
+      if (res == -1 && errno == EINTR)
+	continue;
+      if (res <= 0)
+	return 0;
+      c += (size_t)res;
+    } //while();
+  return 1;
+}
+
+/*
+ * The dummy executor. It reads commands from stdin exactly as real
+ * executor does, but launches nothing. The time of arrival of each text
+ * block with the marker is appended to the record file and every text
+ * block or tone is reported as played at once, so the daemon counts its
+ * queue as empty.
+ */
+static int runExecutor(const std::string& fileName)
+{
+  const int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+  if (fd == -1)
+    {
+      perror(fileName.c_str());
+      return EXIT_FAILURE;
+    }
+  CommandHeader header;
+  std::vector<char> buf;
+  while(readAll(STDIN_FILENO, &header, sizeof(header)))
+    {
+      const int code = header.code & ~COMMAND_PLAYER_LIBAO;
+      if (code == COMMAND_TONE)
+	{
+	  printf("played\n");
+	  fflush(stdout);
+	  continue;
+	}
+      if (code != COMMAND_SAY && code != COMMAND_SAY_PERSISTENT)
+	continue;
+      const double stamp = getTime();
+      buf.resize(header.param1 + header.param2 + header.param3 + 1);
+      if (!readAll(STDIN_FILENO, &buf[0], buf.size() - 1))
+	break;
+      buf[buf.size() - 1] = '\0';
+      const char* text = &buf[header.param1 + header.param2];
+      const char* marker = strstr(text, MARKER " ");
+      if (marker != NULL)
+	{
+	  marker += strlen(MARKER " ");
+	  size_t len = 0;
+	  while(marker[len] >= 'a' && marker[len] <= 'z')
+	    len++;
+	  char line[64];
+	  const int lineLen = snprintf(line, sizeof(line), "%.*s %.9f\n", (int)(len < 32?len:32), marker, stamp);
+	  if (write(fd, line, lineLen) != lineLen)
+	    break;
+	}
+      printf("played\n");
+      fflush(stdout);
+    } //while();
+  close(fd);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * IDs of text commands are written as syllables of a consonant and a
+ * vowel, the least significant first. Text processing keeps such words
+ * as they are in any mode, while words without vowels are spelled.
+ */
+static std::string makeId(size_t index)
+{
+  const size_t base = strlen(ID_CONSONANTS) * strlen(ID_VOWELS);
+  std::string id;
+  do {
+    id += ID_CONSONANTS[(index % base) / strlen(ID_VOWELS)];
+    id += ID_VOWELS[index % strlen(ID_VOWELS)];
+    index /= base;
+  } while(index > 0);
+  return id;
+}
+
+static size_t parseId(const std::string& id)
+{
+  const size_t base = strlen(ID_CONSONANTS) * strlen(ID_VOWELS);
+  size_t index = 0;
+  for(std::string::size_type i = id.length() & ~(std::string::size_type)1;i > 0;i -= 2)
+    {
+      const char* consonant = strchr(ID_CONSONANTS, id[i - 2]);
+      const char* vowel = strchr(ID_VOWELS, id[i - 1]);
+      if (consonant == NULL || vowel == NULL)
+	return (size_t)-1;
+      index = index * base + (size_t)(consonant - ID_CONSONANTS) * strlen(ID_VOWELS) + (size_t)(vowel - ID_VOWELS);
+    }
+  return index;
+}
+
+static bool parseMix(const std::string& spec, size_t weights[CommandCount])
+{
+  for(size_t i = 0;i < CommandCount;i++)
+    weights[i] = 0;
+  size_t total = 0;
+  for(size_t k = 0;;k++)
+    {
+      const std::string item = trim(getDelimitedSubStr(spec, k, ','));
+      if (item.empty())
+	break;
+      const std::string name = trim(getDelimitedSubStr(item, 0, '='));
+      const std::string value = trim(getDelimitedSubStr(item, 1, '='));
+      size_t i;
+      for(i = 0;i < CommandCount;i++)
+	if (name == commandNames[i])
+	  break;
+      if (i >= CommandCount || !checkTypeUnsignedInt(value))
+	{
+	  std::cerr << "invalid command mix item \'" << item << "\'" << std::endl;
+	  return 0;
+	}
+      weights[i] = parseAsUnsignedInt(value);
+      total += weights[i];
+    } //for();
+  if (total == 0)
+    {
+      std::cerr << "command mix \'" << spec << "\' is empty" << std::endl;
+      return 0;
+    }
+  return 1;
+}
+
+static bool parseUIntParam(const std::string& name, size_t defaultValue, size_t& value)
+{
+  if (!cmdLine.used(name))
+    {
+      value = defaultValue;
+      return 1;
+    }
+  const std::string s = trim(cmdLine[name]);
+  if (!checkTypeUnsignedInt(s) || parseAsUnsignedInt(s) == 0)
+    {
+      std::cerr << "\'" << s << "\' is not a valid value of --" << name << std::endl;
+      return 0;
+    }
+  value = parseAsUnsignedInt(s);
+  return 1;
+}
+
+static bool writeConfiguration(const std::string& fileName, const std::string& socketName)
+{
+  std::ofstream f(fileName.c_str());
+  if (!f)
+    return 0;
+  f << "[Global]" << std::endl;
+  f << "socket = \"" << socketName << "\"" << std::endl;
+  f << "log level = error" << std::endl;
+  f << "default language = eng" << std::endl;
+  f << "max clients = 0" << std::endl;
+  f << "[families]" << std::endl;
+  f << "bench-eng = bench" << std::endl;
+  f << "bench-rus = bench" << std::endl;
+  f << "[output]" << std::endl;
+  f << "name = bench-eng" << std::endl;
+  f << "type = command" << std::endl;
+  f << "lang = eng" << std::endl;
+  f << "synth command = \"cat\"" << std::endl;
+  f << "alsa player command = \"cat > /dev/null\"" << std::endl;
+  f << "[output]" << std::endl;
+  f << "name = bench-rus" << std::endl;
+  f << "type = command" << std::endl;
+  f << "lang = rus" << std::endl;
+  f << "synth command = \"cat\"" << std::endl;
+  f << "alsa player command = \"cat > /dev/null\"" << std::endl;
+  return (bool)f;
+}
+
+static pid_t startDaemon(const std::string& daemonPath, const std::string& configFileName, const std::string& executor, const std::string& logFileName)
+{
+  const pid_t pid = fork();
+  if (pid == (pid_t)-1)
+    {
+      perror("fork()");
+      return pid;
+    }
+  if (pid == 0)
+    {
+      const int fd = open(logFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+      if (fd != -1)
+	{
+	  dup2(fd, STDOUT_FILENO);
+	  dup2(fd, STDERR_FILENO);
+	  close(fd);
+	}
+      execl(daemonPath.c_str(), daemonPath.c_str(), "-c", configFileName.c_str(), "-e", executor.c_str(), (char*)0);
+      perror(daemonPath.c_str());
+      _exit(EXIT_FAILURE);
+    }
+  return pid;
+}
+
+/*
+ * Returns user and system CPU time of the process in seconds, the 14th
+ * and the 15th fields of /proc/PID/stat, counting from the process name
+ * in parentheses.
+ */
+static double getProcessCpuTime(pid_t pid)
+{
+  std::ostringstream ss;
+  ss << "/proc/" << pid << "/stat";
+  std::ifstream f(ss.str().c_str());
+  std::string line;
+  if (!std::getline(f, line))
+    return 0;
+  const std::string::size_type pos = line.rfind(')');
+  if (pos == std::string::npos)
+    return 0;
+  std::istringstream fields(line.substr(pos + 1));
+  std::string field;
+  unsigned long utime = 0, stime = 0;
+  for(size_t i = 3;i < 14 && fields >> field;i++);
+  fields >> utime >> stime;
+  return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static size_t readRecords(const std::string& fileName, const std::vector<double>& sendTimes, std::vector<double>& latencies)
+{
+  latencies.clear();
+  std::ifstream f(fileName.c_str());
+  std::string id;
+  double stamp;
+  while(f >> id >> stamp)
+    {
+      const size_t index = parseId(id);
+      if (index < sendTimes.size())
+	latencies.push_back(stamp - sendTimes[index]);
+    } //while();
+  return latencies.size();
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  const size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+static void sleepUntil(double moment)
+{
+  const double delay = moment - getTime();
+  if (delay <= 0)
+    return;
+  struct timespec ts;
+  ts.tv_sec = (time_t)delay;
+  ts.tv_nsec = (long)((delay - (double)ts.tv_sec) * 1000000000.0);
+  nanosleep(&ts, NULL);
+}
+
+static vm_result_t sendParam(vm_connection_t con, unsigned long seed)
+{
+  const unsigned char value = (unsigned char)(seed % 101);
+  switch((seed >> 8) % 4)
+    {
+    case 0:
+      return vm_pitch(con, value);
+    case 1:
+      return vm_rate(con, value);
+    case 2:
+      return vm_volume(con, value);
+    default:
+      return vm_procmode(con, (unsigned char)(seed % 3));
+    } //switch();
+}
+
+static void printHelp()
+{
+  std::cout << "The load generator for VOICEMAN speech system. Version: " << PACKAGE_VERSION << "." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Usage:" << std::endl;
+  std::cout << "\tvoiceman-bench [OPTIONS]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Command line options:" << std::endl;
+  cmdLine.printHelp();
+}
+
+static int runLoad(const std::string& daemonPath, const std::string& workDir)
+{
+  size_t clients, rate, seconds;
+  size_t weights[CommandCount];
+  if (!parseUIntParam("clients", DEFAULT_CLIENTS, clients) ||
+      !parseUIntParam("rate", DEFAULT_RATE, rate) ||
+      !parseUIntParam("time", DEFAULT_SECONDS, seconds) ||
+      !parseMix(cmdLine.used("mix")?cmdLine["mix"]:DEFAULT_MIX, weights))
+    return EXIT_FAILURE;
+  size_t totalWeight = 0;
+  for(size_t i = 0;i < CommandCount;i++)
+    totalWeight += weights[i];
+  char selfPath[PATH_MAX];
+  const ssize_t selfPathLen = readlink("/proc/self/exe", selfPath, sizeof(selfPath) - 1);
+  if (selfPathLen <= 0)
+    {
+      perror("/proc/self/exe");
+      return EXIT_FAILURE;
+    }
+  selfPath[selfPathLen] = '\0';
+  const std::string configFileName = workDir + "/voiceman.conf", socketName = workDir + "/socket", recordsFileName = workDir + "/received", logFileName = workDir + "/voicemand.log";
+  if (!writeConfiguration(configFileName, socketName))
+    {
+      perror(configFileName.c_str());
+      return EXIT_FAILURE;
+    }
+  const std::string executor = "\'" + std::string(selfPath) + "\' --executor \'" + recordsFileName + "\'";
+  const pid_t daemonPid = startDaemon(daemonPath, configFileName, executor, logFileName);
+  if (daemonPid == (pid_t)-1)
+    return EXIT_FAILURE;
+  std::vector<vm_connection_t> cons;
+  double start = getTime();
+  while(cons.size() < clients && getTime() - start < CONNECT_TIMEOUT)
+    {
+      const vm_connection_t con = vm_connect_unix((char*)socketName.c_str());
+      if (con != VOICEMAN_BAD_CONNECTION)
+	cons.push_back(con); else
+	sleepUntil(getTime() + 0.05);
+    } //while();
+  int exitCode = EXIT_SUCCESS;
+  if (cons.size() < clients)
+    {
+      std::cerr << "could not connect to voicemand, see " << logFileName << std::endl;
+      exitCode = EXIT_FAILURE;
+    } else
+    {
+      WStringVector document;
+      generateDocument(DOCUMENT_SIZE, document);
+      std::vector<std::string> lines;
+      for(WStringVector::size_type i = 0;i < document.size();i++)
+	if (!trim(document[i]).empty())
+	  lines.push_back(encodeUTF8(document[i]));
+      const size_t total = rate * seconds;
+      size_t counts[CommandCount] = {0, 0, 0, 0, 0};
+      std::vector<double> sendTimes;
+      size_t failures = 0;
+      double maxLag = 0;
+      unsigned long seed = 1;
+      const double cpuBefore = getProcessCpuTime(daemonPid);
+      start = getTime();
+      for(size_t k = 0;k < total;k++)
+	{
+	  const double moment = start + (double)k / (double)rate;
+	  sleepUntil(moment);
+	  const double now = getTime();
+	  if (now - moment > maxLag)
+	    maxLag = now - moment;
+	  seed = seed * 1103515245 + 12345;
+	  size_t choice = (seed >> 16) % totalWeight, command = 0;
+	  while(choice >= weights[command])
+	    choice -= weights[command++];
+	  const vm_connection_t con = cons[k % cons.size()];
+	  vm_result_t res;
+	  switch(command)
+	    {
+	    case CommandText:
+	      {
+		const std::string text = MARKER " " + makeId(sendTimes.size()) + " " + lines[sendTimes.size() % lines.size()];
+		sendTimes.push_back(getTime());
+		res = vm_text(con, (char*)text.c_str());
+	      }
+	      break;
+	    case CommandLetter:
+	      {
+		char letter[2] = {(char)('a' + seed % 26), '\0'};
+		res = vm_letter(con, letter);
+	      }
+	      break;
+	    case CommandParam:
+	      res = sendParam(con, seed);
+	      break;
+	    case CommandTone:
+	      res = vm_tone(con, 440, 10);
+	      break;
+	    default:
+	      res = vm_stop(con);
+	    } //switch(command);
+	  if (res != VOICEMAN_OK)
+	    failures++;
+	  counts[command]++;
+	} //for(commands);
+      const double elapsed = getTime() - start;
+      //Waiting for the executor while it is receiving new text blocks;
+      std::vector<double> latencies;
+      size_t received = 0;
+      double lastProgress = getTime();
+      while(received < sendTimes.size() && getTime() - lastProgress < DRAIN_TIMEOUT)
+	{
+	  sleepUntil(getTime() + 0.1);
+	  const size_t count = readRecords(recordsFileName, sendTimes, latencies);
+	  if (count > received)
+	    lastProgress = getTime();
+	  received = count;
+	} //while();
+      const double cpu = getProcessCpuTime(daemonPid) - cpuBefore;
+      std::sort(latencies.begin(), latencies.end());
+      printf("%lu clients, %lu commands in %.2f s (%.0f per second), maximum lag behind schedule %.2f ms\n", (unsigned long)cons.size(), (unsigned long)total, elapsed, (double)total / elapsed, maxLag * 1000);
+      for(size_t i = 0;i < CommandCount;i++)
+	printf("%-8s %lu\n", commandNames[i], (unsigned long)counts[i]);
+      if (failures > 0)
+	printf("failed sends %lu\n", (unsigned long)failures);
+      printf("text blocks received by executor: %lu of %lu\n", (unsigned long)latencies.size(), (unsigned long)sendTimes.size());
+      if (!latencies.empty())
+	printf("command-to-executor latency, ms: p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+	       percentile(latencies, 0.5) * 1000, percentile(latencies, 0.95) * 1000,
+	       percentile(latencies, 0.99) * 1000, latencies.back() * 1000);
+      printf("daemon CPU time %.2f s (%.1f%% of run time, %.1f us per command)\n", cpu, cpu * 100 / elapsed, cpu * 1000000 / (double)total);
+      if (cmdLine.used("stats"))
+	{
+	  std::vector<char> buf(STATS_BUF_SIZE);
+	  if (vm_stats(cons[0], &buf[0], buf.size()) == VOICEMAN_OK)
+	    std::cout << std::endl << &buf[0]; else
+	    std::cerr << "could not receive statistics from server" << std::endl;
+	}
+    }
+  for(std::vector<vm_connection_t>::size_type i = 0;i < cons.size();i++)
+    vm_close(cons[i]);
+  kill(daemonPid, SIGTERM);
+  waitpid(daemonPid, NULL, 0);
+  unlink(recordsFileName.c_str());
+  unlink(socketName.c_str());
+  unlink(configFileName.c_str());
+  if (exitCode == EXIT_SUCCESS)
+    unlink(logFileName.c_str());
+  return exitCode;
+}
+
+int main(int argc, char* argv[])
+{
+  if (!cmdLine.parse(argc, argv))
+    return EXIT_FAILURE;
+  if (cmdLine.used("help"))
+    {
+      printHelp();
+      return EXIT_SUCCESS;
+    }
+  if (cmdLine.used("executor"))
+    return runExecutor(cmdLine["executor"]);
+  if (!cmdLine.used("daemon"))
+    {
+      std::cerr << "path to voicemand is not specified, use --daemon option" << std::endl;
+      return EXIT_FAILURE;
+    }
+  signal(SIGPIPE, SIG_IGN);
+  char workDir[] = "/tmp/voiceman-bench.XXXXXX";
+  if (mkdtemp(workDir) == NULL)
+    {
+      perror("mkdtemp()");
+      return EXIT_FAILURE;
+    }
+  const int exitCode = runLoad(cmdLine["daemon"], workDir);
+  if (exitCode == EXIT_SUCCESS)
+    rmdir(workDir);
+  return exitCode;
+}
@@ -0,0 +1,509 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The suite of microbenchmarks of text processing components. The
+ * corpus is made of lines of the shipped data files completed with the
+ * generated document, so it has all punctuation, replacements and
+ * numbers the daemon deals with. Text processor, outputs and languages
+ * are prepared from the data directory in the same way as the daemon
+ * does it, outputs take cap list from the configuration file if it is
+ * given. Each benchmark is run several times and the best time is
+ * taken. The results are printed in CSV format with throughput in
+ * characters per second and the number of memory allocations per
+ * processed item, counted by replaced operator new.
+ */
+
+#include"voiceman.h"
+#include"langs/LangManager.h"
+#include"core/AbstractTextProcessor.h"
+#include"core/TextItem.h"
+#include"core/Output.h"
+#include"system/DelimitedFile.h"
+#include"config_file/ConfigFile.h"
+#include"document.h"
+
+#define DEFAULT_CORPUS_SIZE 262144
+#define DEFAULT_ITERATIONS 5
+
+#define OUTPUT_REPLACEMENTS "replacements.espeak"
+#define OUTPUT_SECTION "espeak"
+
+static const char* const dataFiles[] = {
+  "caps",
+  "chars-table",
+  "replacements.all",
+  "replacements.none",
+  "replacements.some",
+  "replacements.espeak",
+  "replacements.mbrola",
+  "replacements.ru_tts",
+  "ru_const"
+};
+
+#define DATA_FILE_COUNT (sizeof(dataFiles) / sizeof(dataFiles[0]))
+
+static size_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+  allocationCount++;
+  void* p = malloc(size > 0?size:1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) throw()
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) throw()
+{
+  free(p);
+}
+
+class BenchConfigFile: public ConfigFile
+{
+public:
+  BenchConfigFile() {}
+  virtual ~BenchConfigFile() {}
+
+protected:
+  int params(const std::string&, const std::string&) const
+  {
+    return AnyValue;
+  }
+}; //class BenchConfigFile;
+
+typedef std::vector<std::string> StringVector;
+typedef std::vector<Output> OutputVector;
+
+/**\brief Everything the benchmarks work with*/
+struct Context
+{
+  std::string dataDir;
+  std::string configFileName;
+  WStringVector lines;
+  StringVector utf8Lines;
+  StringVector ioLines;
+  size_t chars;
+  auto_ptr<AbstractTextProcessor> splitter;
+  auto_ptr<AbstractTextProcessor> processor;
+  TextItemVector items;
+  size_t itemChars;
+  OutputVector outputs;//indexed by language ID;
+  OutputVector outputsWithoutCaps;
+  OutputVector outputsWithoutReplacements;
+}; //struct Context;
+
+typedef size_t (*BenchFunc)(const Context& c);
+
+static std::string readFile(const std::string& fileName)
+{
+  std::ifstream f(fileName.c_str());
+  std::ostringstream s;
+  s << f.rdbuf();
+  return s.str();
+}
+
+static void prepareCorpus(size_t corpusSize, Context& c)
+{
+  WStringVector dataLines;
+  for(size_t i = 0;i < DATA_FILE_COUNT;i++)
+    {
+      std::istringstream s(readFile(concatUnixPath<std::string>(c.dataDir, dataFiles[i])));
+      std::string line;
+      while(std::getline(s, line))
+	if (!trim(line).empty() && trim(line)[0] != '#')
+	  dataLines.push_back(readUTF8(line));
+    }
+  c.chars = 0;
+  //The first half is the data files repeated, the second one is the generated document;
+  for(size_t i = 0;!dataLines.empty() && c.chars < corpusSize / 2;i++)
+    {
+      c.lines.push_back(dataLines[i % dataLines.size()]);
+      c.chars += c.lines.back().length();
+    }
+  WStringVector document;
+  generateDocument(corpusSize - c.chars, document);
+  for(WStringVector::size_type i = 0;i < document.size();i++)
+    {
+      c.lines.push_back(document[i]);
+      c.chars += document[i].length();
+    }
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      c.utf8Lines.push_back(encodeUTF8(c.lines[i]));
+      c.ioLines.push_back(WString2IO(c.lines[i]));
+    }
+}
+
+static void prepareTextProcessor(AbstractTextProcessor& textProc, const std::string& dataDir, bool replacements)
+{
+  const LangId engId = langManager.getLangId("eng"), rusId = langManager.getLangId("rus");
+  textProc.associate(langManager.getLangById(engId)->getAllChars(), engId);
+  textProc.associate(langManager.getLangById(rusId)->getAllChars(), rusId);
+  textProc.setDefaultLangId(engId);
+  textProc.associate(DEFAULT_CHARACTERS, LANG_ID_NONE);
+  DelimitedFile f;
+  f.read(concatUnixPath<std::string>(dataDir, "chars-table"));
+  for(size_t i = 0;i < f.getLineCount();i++)
+    {
+      if (f.getItemCountInLine(i) != 2)
+	continue;
+      const std::wstring charFrom = readUTF8(trim(f.getItem(i, 0)));
+      const std::wstring value = readUTF8(trim(f.getItem(i, 1)));
+      if (charFrom.length() == 1 && !value.empty())
+	textProc.setSpecialValueFor(charFrom[0], value);
+    }
+  if (!replacements)
+    return;
+  f.read(concatUnixPath<std::string>(dataDir, "replacements.all"));
+  for(size_t i = 0;i < f.getLineCount();i++)
+    {
+      if (f.getItemCountInLine(i) != 3)
+	continue;
+      const std::string langName = toLower(trim(f.getItem(i, 0)));
+      const std::string fromString = f.getItem(i, 1);
+      if (!langManager.hasLanguage(langName) || fromString.empty())
+	continue;
+      textProc.addReplacement(langManager.getLangId(langName), readUTF8(fromString), readUTF8(f.getItem(i, 2)));
+    } //for(lines);
+}
+
+static void readCapList(const std::string& configFileName, WCharToWStringMap& capList)
+{
+  if (configFileName.empty())
+    return;
+  BenchConfigFile config;
+  config.load(configFileName);
+  for(ConfigFileSectionVector::size_type i = 0;i < config.getSectionCount();i++)
+    {
+      const ConfigFileSection& section = config.getSection(i);
+      if (section.getName() != "output" || !section.has("name") || trim(section["name"]) != OUTPUT_SECTION || !section.has("caplist"))
+	continue;
+      StringDelimitedIterator<std::wstring> it(trim(readUTF8(section["caplist"])), L" ");
+      while(it.next())
+	{
+	  const std::wstring letter = it.str();
+	  if (!it.next())
+	    break;
+	  if (letter.length() == 1)
+	    capList[letter[0]] = it.str();
+	}
+    } //for(sections);
+}
+
+static void prepareOutputs(const Context& c, const WCharToWStringMap& capList, bool replacements, OutputVector& outputs)
+{
+  DelimitedFile f;
+  if (replacements)
+    f.read(concatUnixPath<std::string>(c.dataDir, OUTPUT_REPLACEMENTS));
+  const LangId langIds[] = {langManager.getLangId("eng"), langManager.getLangId("rus")};
+  for(size_t k = 0;k < sizeof(langIds) / sizeof(langIds[0]);k++)
+    {
+      const LangId langId = langIds[k];
+      if ((size_t)langId >= outputs.size())
+	outputs.resize((size_t)langId + 1);
+      Output& o = outputs[langId];
+      o.setLangId(langId);
+      o.setLang(langManager.getLangById(langId));
+      for(size_t i = 0;i < f.getLineCount();i++)
+	if (f.getItemCountInLine(i) == 2 && !f.getItem(i, 0).empty())
+	  o.addReplacement(readUTF8(f.getItem(i, 0)), readUTF8(f.getItem(i, 1)));
+      for(WCharToWStringMap::const_iterator it = capList.begin();it != capList.end();it++)
+	o.addCapMapItem(it->first, it->second);
+    }
+}
+
+static void prepareContext(Context& c, size_t corpusSize)
+{
+  prepareCorpus(corpusSize, c);
+  c.splitter = createNewTextProcessor(langManager, DigitsModeNone, 0, 0);
+  prepareTextProcessor(*c.splitter, c.dataDir, 0);
+  c.processor = createNewTextProcessor(langManager, DigitsModeNormal, 1, 1);
+  prepareTextProcessor(*c.processor, c.dataDir, 1);
+  c.itemChars = 0;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      TextItemList items;
+      c.processor->process(TextItem(c.lines[i]), items);
+      for(TextItemList::const_iterator it = items.begin();it != items.end();it++)
+	if (it->getLangId() != LANG_ID_NONE)
+	  {
+	    c.items.push_back(*it);
+	    c.itemChars += it->getText().length();
+	  }
+    }
+  WCharToWStringMap capList;
+  readCapList(c.configFileName, capList);
+  prepareOutputs(c, capList, 1, c.outputs);
+  prepareOutputs(c, WCharToWStringMap(), 1, c.outputsWithoutCaps);
+  prepareOutputs(c, capList, 0, c.outputsWithoutReplacements);
+}
+
+static size_t benchSplit(const Context& c)
+{
+  size_t sum = 0;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      TextItemList items;
+      c.splitter->process(TextItem(c.lines[i]), items);
+      sum += items.size();
+    }
+  return sum;
+}
+
+static size_t benchProcess(const Context& c)
+{
+  size_t sum = 0;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      TextItemList items;
+      c.processor->process(TextItem(c.lines[i]), items);
+      sum += items.size();
+    }
+  return sum;
+}
+
+static size_t benchProcessLetter(const Context& c)
+{
+  size_t sum = 0;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    for(std::wstring::size_type j = 0;j < c.lines[i].length();j++)
+      {
+	TextItemList items;
+	c.processor->processLetter(c.lines[i][j], TextParam(), TextParam(), TextParam(), items);
+	sum += items.size();
+      }
+  return sum;
+}
+
+static size_t prepareTexts(const Context& c, const OutputVector& outputs)
+{
+  size_t sum = 0;
+  for(TextItemVector::size_type i = 0;i < c.items.size();i++)
+    sum += outputs[c.items[i].getLangId()].prepareText(c.items[i]).length();
+  return sum;
+}
+
+static size_t benchPrepareText(const Context& c)
+{
+  return prepareTexts(c, c.outputs);
+}
+
+static size_t benchPrepareTextWithoutCaps(const Context& c)
+{
+  return prepareTexts(c, c.outputsWithoutCaps);
+}
+
+static size_t benchPrepareTextWithoutReplacements(const Context& c)
+{
+  return prepareTexts(c, c.outputsWithoutReplacements);
+}
+
+static size_t expandNumbers(const Context& c, const char* langName, bool singleDigits)
+{
+  const Lang* lang = langManager.getLangById(langManager.getLangId(langName));
+  size_t sum = 0;
+  std::wstring s;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      s = c.lines[i];
+      lang->expandNumbers(s, singleDigits);
+      sum += s.length();
+    }
+  return sum;
+}
+
+static size_t benchEngExpandNumbers(const Context& c)
+{
+  return expandNumbers(c, "eng", 0);
+}
+
+static size_t benchEngExpandDigits(const Context& c)
+{
+  return expandNumbers(c, "eng", 1);
+}
+
+static size_t benchRusExpandNumbers(const Context& c)
+{
+  return expandNumbers(c, "rus", 0);
+}
+
+static size_t benchRusExpandDigits(const Context& c)
+{
+  return expandNumbers(c, "rus", 1);
+}
+
+static size_t markCapitals(const Context& c, const char* langName)
+{
+  const Lang* lang = langManager.getLangById(langManager.getLangId(langName));
+  size_t sum = 0;
+  BoolVector marks;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      marks.assign(c.lines[i].length(), 0);
+      lang->markCapitals(c.lines[i], marks);
+      sum += (size_t)std::count(marks.begin(), marks.end(), 1);
+    }
+  return sum;
+}
+
+static size_t benchEngMarkCapitals(const Context& c)
+{
+  return markCapitals(c, "eng");
+}
+
+static size_t benchRusMarkCapitals(const Context& c)
+{
+  return markCapitals(c, "rus");
+}
+
+static size_t benchDecodeUTF8(const Context& c)
+{
+  size_t sum = 0;
+  std::wstring s;
+  for(StringVector::size_type i = 0;i < c.utf8Lines.size();i++)
+    {
+      readUTF8(c.utf8Lines[i].data(), c.utf8Lines[i].length(), s);
+      sum += s.length();
+    }
+  return sum;
+}
+
+static size_t benchEncodeUTF8(const Context& c)
+{
+  size_t sum = 0;
+  std::string s;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      encodeUTF8(c.lines[i], s);
+      sum += s.length();
+    }
+  return sum;
+}
+
+static size_t benchDecodeIO(const Context& c)
+{
+  size_t sum = 0;
+  std::wstring s;
+  for(StringVector::size_type i = 0;i < c.ioLines.size();i++)
+    {
+      transcoding.trIO2WString(c.ioLines[i], s);
+      sum += s.length();
+    }
+  return sum;
+}
+
+static size_t benchEncodeIO(const Context& c)
+{
+  size_t sum = 0;
+  std::string s;
+  for(WStringVector::size_type i = 0;i < c.lines.size();i++)
+    {
+      transcoding.trWString2IO(c.lines[i], s);
+      sum += s.length();
+    }
+  return sum;
+}
+
+static size_t benchDelimitedFile(const Context& c)
+{
+  size_t sum = 0;
+  for(size_t i = 0;i < DATA_FILE_COUNT;i++)
+    {
+      DelimitedFile f;
+      f.read(concatUnixPath<std::string>(c.dataDir, dataFiles[i]));
+      sum += f.getLineCount();
+    }
+  return sum;
+}
+
+static size_t benchConfigFile(const Context& c)
+{
+  BenchConfigFile config;
+  config.load(c.configFileName);
+  config.checkParams();
+  return config.getSectionCount();
+}
+
+static void run(const char* name, BenchFunc func, const Context& c, size_t items, size_t chars, size_t iterations)
+{
+  double best = 0;
+  size_t allocations = 0;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      const size_t allocationsBefore = allocationCount;
+      const double start = getTime();
+      func(c);
+      const double elapsed = getTime() - start;
+      if (k == 0 || elapsed < best)
+	best = elapsed;
+      allocations = allocationCount - allocationsBefore;
+    }
+  printf("%s,%lu,%lu,%.6f,%.0f,%.2f\n", name, (unsigned long)items, (unsigned long)chars, best,
+	 best > 0?(double)chars / best:0, items > 0?(double)allocations / (double)items:0);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+      std::cerr << "usage: " << argv[0] << " DATADIR [CONFIG_FILE [CORPUS_SIZE [ITERATIONS]]]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  Context c;
+  c.dataDir = argv[1];
+  c.configFileName = argc > 2 && std::string(argv[2]) != "-"?argv[2]:"";
+  const size_t corpusSize = argc > 3?(size_t)atol(argv[3]):DEFAULT_CORPUS_SIZE;
+  const size_t iterations = argc > 4?(size_t)atol(argv[4]):DEFAULT_ITERATIONS;
+  try {
+    langManager.load(c.dataDir);
+    prepareContext(c, corpusSize);
+    size_t dataChars = 0;
+    for(size_t i = 0;i < DATA_FILE_COUNT;i++)
+      dataChars += readFile(concatUnixPath<std::string>(c.dataDir, dataFiles[i])).length();
+    const size_t lineCount = c.lines.size();
+    printf("benchmark,items,chars,seconds,chars_per_second,allocations_per_item\n");
+    run("TextProcessor.split", benchSplit, c, lineCount, c.chars, iterations);
+    run("TextProcessor.process", benchProcess, c, lineCount, c.chars, iterations);
+    run("TextProcessor.processLetter", benchProcessLetter, c, c.chars, c.chars, iterations);
+    run("Output.prepareText", benchPrepareText, c, c.items.size(), c.itemChars, iterations);
+    run("Output.prepareText.nocaps", benchPrepareTextWithoutCaps, c, c.items.size(), c.itemChars, iterations);
+    run("Output.prepareText.noreplacements", benchPrepareTextWithoutReplacements, c, c.items.size(), c.itemChars, iterations);
+    run("EngLang.expandNumbers", benchEngExpandNumbers, c, lineCount, c.chars, iterations);
+    run("EngLang.expandNumbers.single", benchEngExpandDigits, c, lineCount, c.chars, iterations);
+    run("RusLang.expandNumbers", benchRusExpandNumbers, c, lineCount, c.chars, iterations);
+    run("RusLang.expandNumbers.single", benchRusExpandDigits, c, lineCount, c.chars, iterations);
+    run("EngLang.markCapitals", benchEngMarkCapitals, c, lineCount, c.chars, iterations);
+    run("RusLang.markCapitals", benchRusMarkCapitals, c, lineCount, c.chars, iterations);
+    run("Transcoding.decodeUTF8", benchDecodeUTF8, c, lineCount, c.chars, iterations);
+    run("Transcoding.encodeUTF8", benchEncodeUTF8, c, lineCount, c.chars, iterations);
+    run("Transcoding.decodeIO", benchDecodeIO, c, lineCount, c.chars, iterations);
+    run("Transcoding.encodeIO", benchEncodeIO, c, lineCount, c.chars, iterations);
+    run("DelimitedFile.read", benchDelimitedFile, c, DATA_FILE_COUNT, dataChars, iterations);
+    if (!c.configFileName.empty())
+      run("ConfigFile.load", benchConfigFile, c, 1, readFile(c.configFileName).length(), iterations);
+  }
+  catch(const VoicemanException& e)
+    {
+      e.makeLogReport(LOG_ERR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
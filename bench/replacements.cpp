@@ -0,0 +1,187 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The benchmark of replacements inserting. It reads real replacement
+ * files shipped with VoiceMan and inserts replacements into a generated
+ * document with ReplacementMatcher class and with straightforward
+ * implementation checking each replacement at each text position, as
+ * it was done before ReplacementMatcher introduction. Results of both
+ * implementations must be identical.
+ */
+
+#include"voiceman.h"
+#include"langs/LangManager.h"
+#include"core/ReplacementMatcher.h"
+#include"system/DelimitedFile.h"
+#include"document.h"
+
+#define DEFAULT_DOCUMENT_SIZE 262144
+#define DEFAULT_ITERATIONS 3
+
+/*
+ * The reference implementation;
+ */
+
+static bool findReplacement(const ReplacementVector& replacements, const Lang* lang, const std::wstring& str, std::wstring::size_type pos, ReplacementVector::size_type& result)
+{
+  //Case sensitive search;
+  for(ReplacementVector::size_type i = 0;i < replacements.size();i++)
+    {
+      if (str.length() - pos < replacements[i].oldValue.length())
+	continue;
+      std::wstring::size_type j;
+      for(j = 0;j < replacements[i].oldValue.length();j++)
+	if (str[pos + j] != replacements[i].oldValue[j])
+	    break;
+      if (j == replacements[i].oldValue.length())
+	{
+	  result = i;
+	  return 1;
+	}
+    } //for(replacements);
+  if (lang == NULL)
+    return 0;
+  //Case insensitive search;
+  for(ReplacementVector::size_type i = 0;i < replacements.size();i++)
+    {
+      if (str.length() - pos < replacements[i].oldValue.length())
+	continue;
+      std::wstring::size_type j;
+      for(j = 0;j < replacements[i].oldValue.length();j++)
+	if (!lang->equalChars(str[pos + j], replacements[i].oldValue[j]))
+	    break;
+      if (j == replacements[i].oldValue.length())
+	{
+	  result = i;
+	  return 1;
+	}
+    } //for(replacements);
+  return 0;
+}
+
+static std::wstring insertReplacements(const ReplacementVector& replacements, const Lang* lang, const std::wstring& str)
+{
+  std::wstring newStr;
+  for(std::wstring::size_type i = 0;i < str.length();i++)
+    {
+      ReplacementVector::size_type k;
+      if (findReplacement(replacements, lang, str, i, k))
+	{
+	  const std::wstring& newValue = replacements[k].newValue;
+	  if (newValue.length() > 1)
+	    {
+	      if (BLANK_CHAR(newValue[0]))
+		attachSpace(newStr);
+	      newStr += trim(newValue);
+	      if (BLANK_CHAR(newValue[newValue.length() - 1]))
+		attachSpace(newStr);
+	    } else 
+	    newStr += newValue;
+	  i += replacements[k].oldValue.length()-1;
+	} else
+	attachCharWithoutDoubleSpaces(newStr, str[i]);
+    }
+  return newStr;
+}
+
+/*
+ * Benchmark itself;
+ */
+
+//Reads files with both "old:new" and "lang:old:new" records;
+static void readReplacements(const std::string& fileName, const std::string& langName, ReplacementVector& replacements)
+{
+  DelimitedFile f;
+  f.read(fileName);
+  replacements.clear();
+  for(size_t i = 0;i < f.getLineCount();i++)
+    {
+      const size_t count = f.getItemCountInLine(i);
+      if (count == 3 && toLower(trim(f.getItem(i, 0))) != langName)
+	continue;
+      if (count != 2 && count != 3)
+	continue;
+      const std::string fromString = f.getItem(i, count - 2);
+      if (fromString.empty())
+	continue;
+      replacements.push_back(Replacement(readUTF8(fromString), readUTF8(f.getItem(i, count - 1))));
+    } //for(lines);
+}
+
+static void runFile(const std::string& dataDir, const std::string& name, const std::string& langName, const WStringVector& lines, size_t documentSize, size_t iterations)
+{
+  ReplacementVector replacements;
+  readReplacements(concatUnixPath<std::string>(dataDir, name), langName, replacements);
+  const Lang* lang = langManager.getLangById(langManager.getLangId(langName));
+  ReplacementMatcher matcher;
+  matcher.setLang(lang);
+  for(ReplacementVector::size_type i = 0;i < replacements.size();i++)
+    matcher.add(replacements[i].oldValue, replacements[i].newValue);
+  double bestReference = 0, bestMatcher = 0;
+  bool identical = 1;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      WStringVector referenceResults, matcherResults;
+      double start = getTime();
+      for(WStringVector::size_type i = 0;i < lines.size();i++)
+	referenceResults.push_back(insertReplacements(replacements, lang, lines[i]));
+      const double referenceElapsed = getTime() - start;
+      start = getTime();
+      for(WStringVector::size_type i = 0;i < lines.size();i++)
+	matcherResults.push_back(matcher.insertReplacements(lines[i]));
+      const double matcherElapsed = getTime() - start;
+      if (k == 0 || referenceElapsed < bestReference)
+	bestReference = referenceElapsed;
+      if (k == 0 || matcherElapsed < bestMatcher)
+	bestMatcher = matcherElapsed;
+      if (referenceResults != matcherResults)
+	identical = 0;
+    } //for(iterations);
+  printf("%-20s %s %3lu rules: reference %8.2f ms (%7.2f Mchars/s), matcher %8.2f ms (%7.2f Mchars/s), %5.2fx, %s\n",
+	 name.c_str(), langName.c_str(), (unsigned long)replacements.size(),
+	 bestReference * 1000, (double)documentSize / bestReference / 1000000,
+	 bestMatcher * 1000, (double)documentSize / bestMatcher / 1000000,
+	 bestReference / bestMatcher, identical?"identical":"DIFFERENT");
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+      std::cerr << "usage: " << argv[0] << " DATADIR [DOCUMENT_SIZE [ITERATIONS]]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  const std::string dataDir = argv[1];
+  const size_t documentSize = argc > 2?(size_t)atol(argv[2]):DEFAULT_DOCUMENT_SIZE;
+  const size_t iterations = argc > 3?(size_t)atol(argv[3]):DEFAULT_ITERATIONS;
+  try {
+    langManager.load(dataDir);
+    WStringVector lines;
+    generateDocument(documentSize, lines);
+    runFile(dataDir, "replacements.espeak", "eng", lines, documentSize, iterations);
+    runFile(dataDir, "replacements.mbrola", "eng", lines, documentSize, iterations);
+    runFile(dataDir, "replacements.ru_tts", "rus", lines, documentSize, iterations);
+    runFile(dataDir, "replacements.all", "eng", lines, documentSize, iterations);
+    runFile(dataDir, "replacements.all", "rus", lines, documentSize, iterations);
+    runFile(dataDir, "replacements.some", "eng", lines, documentSize, iterations);
+  }
+  catch(const VoicemanException& e)
+    {
+      e.makeLogReport(LOG_ERR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
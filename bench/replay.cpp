@@ -0,0 +1,271 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The player of client sessions recorded by voicemand with "capture
+ * file" option. It connects to the running daemon and sends the
+ * captured lines through separate connections as they were received,
+ * with the original timing, N times faster or as fast as possible.
+ * Statistics of the daemon are requested before the replay and after
+ * the executor queue is drained, so the number of text items dropped by
+ * queue limit and latency percentiles are reported. Latency is measured
+ * only if the daemon has "trace latency" option enabled.
+ */
+
+#include"voiceman.h"
+#include"CmdArgsParser.h"
+#include"vmclient.h"
+#include"core/SessionCapture.h"
+#include"document.h"
+
+#define DEFAULT_DRAIN_TIMEOUT 60
+#define STATS_BUF_SIZE 65536
+
+typedef std::map<std::string, double> StatsMap;
+typedef std::map<size_t, vm_connection_t> ConnectionMap;
+
+CmdArg cmdLineParams[] = {
+  {'h', "help", "", "show this help screen and exit;"},
+  {'s', "socket", "FILE_NAME", "connect to the server via UNIX domain socket FILE_NAME;"},
+  {'w', "wait", "SECONDS", "wait up to SECONDS for the executor queue to be drained after the replay;"},
+  {'x', "speed", "FACTOR", "replay FACTOR times faster than recorded, 0 sends everything at once."},
+  {' ', NULL, NULL, NULL}
+};
+
+CmdArgsParser cmdLine(cmdLineParams);
+
+static vm_connection_t connect()
+{
+  if (cmdLine.used("socket"))
+    return vm_connect_unix((char*)cmdLine["socket"].c_str());
+  return vm_connect();
+}
+
+static bool requestStats(vm_connection_t con, StatsMap& stats)
+{
+  std::vector<char> buf(STATS_BUF_SIZE);
+  if (vm_stats(con, &buf[0], buf.size()) != VOICEMAN_OK)
+    return 0;
+  stats.clear();
+  std::istringstream s(&buf[0]);
+  std::string line;
+  while(std::getline(s, line))
+    {
+      std::istringstream fields(line);
+      std::string name;
+      double value;
+      if (fields >> name >> value)
+	stats[name] = value;
+    } //while();
+  return 1;
+}
+
+static double getStat(const StatsMap& stats, const std::string& name)
+{
+  StatsMap::const_iterator it = stats.find(name);
+  return it != stats.end()?it->second:0;
+}
+
+static void sleepUntil(double moment)
+{
+  const double delay = moment - getTime();
+  if (delay <= 0)
+    return;
+  struct timespec ts;
+  ts.tv_sec = (time_t)delay;
+  ts.tv_nsec = (long)((delay - (double)ts.tv_sec) * 1000000000.0);
+  nanosleep(&ts, NULL);
+}
+
+static void printHelp()
+{
+  std::cout << "The player of captured client sessions for VOICEMAN speech system. Version: " << PACKAGE_VERSION << "." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Usage:" << std::endl;
+  std::cout << "\tvoiceman-replay [OPTIONS] CAPTURE_FILE" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Command line options:" << std::endl;
+  cmdLine.printHelp();
+}
+
+static void printLatency(const StatsMap& before, const StatsMap& after)
+{
+  for(StatsMap::const_iterator it = after.begin();it != after.end();it++)
+    {
+      const std::string& key = it->first;
+      if (key.find("latency.") != 0 || key.length() <= strlen("latency..count") ||
+	  key.compare(key.length() - strlen(".count"), std::string::npos, ".count") != 0)
+	continue;
+      const std::string name = key.substr(strlen("latency."), key.length() - strlen("latency..count"));
+      const double count = it->second - getStat(before, it->first);
+      if (count <= 0)
+	continue;
+      const std::string prefix = "latency." + name;
+      printf("%-12s %7.0f items, ms: p50 %.3f, p95 %.3f, p99 %.3f%s\n", name.c_str(), count,
+	     getStat(after, prefix + ".p50"), getStat(after, prefix + ".p95"), getStat(after, prefix + ".p99"),
+	     getStat(before, it->first) > 0?" (since daemon start)":"");
+    } //for(stats);
+}
+
+int main(int argc, char* argv[])
+{
+  if (!cmdLine.parse(argc, argv))
+    return EXIT_FAILURE;
+  if (cmdLine.used("help"))
+    {
+      printHelp();
+      return EXIT_SUCCESS;
+    }
+  if (cmdLine.files.size() != 1)
+    {
+      std::cerr << "exactly one capture file must be specified" << std::endl;
+      return EXIT_FAILURE;
+    }
+  double speed = 1;
+  if (cmdLine.used("speed"))
+    {
+      char* end = NULL;
+      const std::string value = trim(cmdLine["speed"]);
+      speed = strtod(value.c_str(), &end);
+      if (value.empty() || *end != '\0' || speed < 0)
+	{
+	  std::cerr << "\'" << value << "\' is not a valid speed factor" << std::endl;
+	  return EXIT_FAILURE;
+	}
+    }
+  size_t drainTimeout = DEFAULT_DRAIN_TIMEOUT;
+  if (cmdLine.used("wait"))
+    {
+      const std::string value = trim(cmdLine["wait"]);
+      if (!checkTypeUnsignedInt(value))
+	{
+	  std::cerr << "\'" << value << "\' is not a valid number of seconds" << std::endl;
+	  return EXIT_FAILURE;
+	}
+      drainTimeout = parseAsUnsignedInt(value);
+    }
+  //Whole capture is read beforehand, so disk access does not disturb timing;
+  std::vector<CaptureRecord> records;
+  SessionCaptureReader reader;
+  if (!reader.open(cmdLine.files[0]))
+    {
+      std::cerr << cmdLine.files[0] << " is not a valid capture file" << std::endl;
+      return EXIT_FAILURE;
+    }
+  CaptureRecord record;
+  while(reader.read(record))
+    records.push_back(record);
+  signal(SIGPIPE, SIG_IGN);
+  const vm_connection_t control = connect();
+  if (control == VOICEMAN_BAD_CONNECTION)
+    {
+      std::cerr << "could not connect to voicemand" << std::endl;
+      return EXIT_FAILURE;
+    }
+  StatsMap before, after;
+  if (!requestStats(control, before))
+    {
+      std::cerr << "could not receive statistics from server" << std::endl;
+      vm_close(control);
+      return EXIT_FAILURE;
+    }
+  ConnectionMap cons;
+  size_t sentLines = 0, skippedLines = 0, failures = 0, connectionCount = 0;
+  double maxLag = 0;
+  const double start = getTime();
+  for(std::vector<CaptureRecord>::size_type i = 0;i < records.size();i++)
+    {
+      const CaptureRecord& r = records[i];
+      if (speed > 0)
+	{
+	  const double moment = start + r.time / speed;
+	  sleepUntil(moment);
+	  if (getTime() - moment > maxLag)
+	    maxLag = getTime() - moment;
+	}
+      ConnectionMap::iterator it = cons.find(r.connection);
+      if (r.closed)
+	{
+	  if (it != cons.end())
+	    {
+	      vm_close(it->second);
+	      cons.erase(it);
+	    }
+	  continue;
+	}
+      //Replies to statistics requests are not read, they would only fill the socket buffer;
+      const std::string command = trim(r.line);
+      if (command == "I" || command.find("I:") == 0)
+	{
+	  skippedLines++;
+	  continue;
+	}
+      if (it == cons.end())
+	{
+	  const vm_connection_t con = connect();
+	  if (con == VOICEMAN_BAD_CONNECTION)
+	    {
+	      failures++;
+	      continue;
+	    }
+	  it = cons.insert(ConnectionMap::value_type(r.connection, con)).first;
+	  connectionCount++;
+	}
+      if (vm_send_line(it->second, (char*)r.line.data(), r.line.length()) != VOICEMAN_OK)
+	failures++; else
+	sentLines++;
+    } //for(records);
+  const double elapsed = getTime() - start;
+  //The daemon must process all lines and the executor must finish everything before the statistics can be compared;
+  bool drained = 0;
+  size_t statsRequests = 0;
+  double processedLines = 0;
+  const double drainStart = getTime();
+  while(requestStats(control, after))
+    {
+      statsRequests++;
+      //Statistics requests of this connection are counted by the daemon too;
+      processedLines = getStat(after, "input.lines") - getStat(before, "input.lines") - (double)statsRequests;
+      if (processedLines >= (double)sentLines && getStat(after, "executor.queue") == 0)
+	{
+	  drained = 1;
+	  break;
+	}
+      if (getTime() - drainStart >= drainTimeout)
+	break;
+      sleepUntil(getTime() + 0.1);
+    } //while();
+  for(ConnectionMap::iterator it = cons.begin();it != cons.end();it++)
+    vm_close(it->second);
+  vm_close(control);
+  const double recorded = records.empty()?0:records.back().time;
+  printf("%lu lines through %lu connections in %.2f s (recorded in %.2f s), maximum lag behind schedule %.2f ms\n",
+	 (unsigned long)sentLines, (unsigned long)connectionCount, elapsed, recorded, maxLag * 1000);
+  if (skippedLines > 0)
+    printf("skipped statistics requests %lu\n", (unsigned long)skippedLines);
+  if (failures > 0)
+    printf("failed sends %lu\n", (unsigned long)failures);
+  if (after.empty())
+    {
+      std::cerr << "could not receive statistics from server" << std::endl;
+      return EXIT_FAILURE;
+    }
+  if (!drained)
+    printf("daemon was not drained in %lu s, %.0f items left in executor queue\n", (unsigned long)drainTimeout, getStat(after, "executor.queue"));
+  printf("lines processed by daemon %.0f\n", processedLines);
+  printf("dropped by queue limit %.0f\n", getStat(after, "executor.queuelimit") - getStat(before, "executor.queuelimit"));
+  printLatency(before, after);
+  return failures > 0?EXIT_FAILURE:EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The benchmark of text processing with replacements. It generates a
+ * large document of mixed English and Russian text with punctuation and
+ * digits and passes it line by line through text processors prepared
+ * for "all", "some" and "none" punctuation modes. Each mode is measured
+ * twice: with complete processing and with replacements only (numbers
+ * expanding, capitals marking and separation are turned off). Timing and
+ * checksum of produced text are printed for each run, the checksum must
+ * not be changed by any optimization of text processing.
+ */
+
+#include"voiceman.h"
+#include"langs/LangManager.h"
+#include"core/AbstractTextProcessor.h"
+#include"core/TextItem.h"
+#include"system/DelimitedFile.h"
+#include"document.h"
+
+#define DEFAULT_DOCUMENT_SIZE 262144
+#define DEFAULT_ITERATIONS 3
+
+static auto_ptr<AbstractTextProcessor> prepareTextProcessor(const std::string& replacementsFileName, bool fullProcessing)
+{
+  auto_ptr<AbstractTextProcessor> textProc = fullProcessing?createNewTextProcessor(langManager, DigitsModeNormal, 1, 1):createNewTextProcessor(langManager, DigitsModeNone, 0, 0);
+  const LangId engId = langManager.getLangId("eng"), rusId = langManager.getLangId("rus");
+  textProc->associate(langManager.getLangById(engId)->getAllChars(), engId);
+  textProc->associate(langManager.getLangById(rusId)->getAllChars(), rusId);
+  textProc->setDefaultLangId(engId);
+  textProc->associate(DEFAULT_CHARACTERS, LANG_ID_NONE);
+  DelimitedFile f;
+  f.read(replacementsFileName);
+  for(size_t i = 0;i < f.getLineCount();i++)
+    {
+      if (f.getItemCountInLine(i) != 3)
+	continue;
+      const std::string langName = toLower(trim(f.getItem(i, 0)));
+      const std::string fromString = f.getItem(i, 1);
+      if (!langManager.hasLanguage(langName) || fromString.empty())
+	continue;
+      textProc->addReplacement(langManager.getLangId(langName), readUTF8(fromString), readUTF8(f.getItem(i, 2)));
+    } //for(lines);
+  return textProc;
+}
+
+static void runMode(const std::string& dataDir, const std::string& mode, bool fullProcessing, const WStringVector& lines, size_t documentSize, size_t iterations)
+{
+  auto_ptr<AbstractTextProcessor> textProc = prepareTextProcessor(concatUnixPath<std::string>(dataDir, "replacements." + mode), fullProcessing);
+  unsigned long checksum = 0;
+  size_t produced = 0;
+  double best = 0;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      unsigned long sum = 0;
+      produced = 0;
+      const double start = getTime();
+      for(WStringVector::size_type i = 0;i < lines.size();i++)
+	{
+	  TextItemList items;
+	  textProc->process(TextItem(lines[i]), items);
+	  for(TextItemList::const_iterator it = items.begin();it != items.end();it++)
+	    {
+	      const std::wstring& s = it->getText();
+	      for(std::wstring::size_type j = 0;j < s.length();j++)
+		sum = sum * 31 + (unsigned long)s[j];
+	      produced += s.length();
+	    }
+	} //for(lines);
+      const double elapsed = getTime() - start;
+      if (k == 0 || elapsed < best)
+	best = elapsed;
+      checksum = sum;
+    } //for(iterations);
+  printf("%-5s %-12s %8lu chars in %8.2f ms (%7.2f Mchars/s), produced %lu chars, checksum %08lx\n",
+	 mode.c_str(), fullProcessing?"full":"replacements", (unsigned long)documentSize, best * 1000, (double)documentSize / best / 1000000, (unsigned long)produced, checksum & 0xffffffffUL);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+      std::cerr << "usage: " << argv[0] << " DATADIR [DOCUMENT_SIZE [ITERATIONS]]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  const std::string dataDir = argv[1];
+  const size_t documentSize = argc > 2?(size_t)atol(argv[2]):DEFAULT_DOCUMENT_SIZE;
+  const size_t iterations = argc > 3?(size_t)atol(argv[3]):DEFAULT_ITERATIONS;
+  try {
+    langManager.load(dataDir);
+    WStringVector lines;
+    generateDocument(documentSize, lines);
+    const char* const modes[] = {"all", "some", "none"};
+    for(size_t i = 0;i < sizeof(modes) / sizeof(modes[0]);i++)
+      {
+	runMode(dataDir, modes[i], 1, lines, documentSize, iterations);
+	runMode(dataDir, modes[i], 0, lines, documentSize, iterations);
+      }
+  }
+  catch(const VoicemanException& e)
+    {
+      e.makeLogReport(LOG_ERR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
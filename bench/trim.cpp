@@ -0,0 +1,188 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The benchmark of voiceman-trim filtering. It takes a recorded 16-bit
+ * PCM file or generates speech-like signal with silence gaps and
+ * compares the former sample-by-sample filtering with writing of every
+ * sample to /dev/null, the same filtering without system calls and the
+ * block filtering by Trimmer class, checking they produce the same
+ * output.
+ */
+
+#include"voiceman.h"
+#include"Trimmer.h"
+#include"document.h"
+
+#define DEFAULT_SAMPLE_RATE 22050
+#define DEFAULT_SECONDS 60
+#define DEFAULT_ITERATIONS 5
+#define BLOCK_SIZE 32768
+
+typedef std::vector<short> SampleVector;
+
+static void generateSignal(size_t sampleCount, SampleVector& samples)
+{
+  samples.resize(sampleCount);
+  unsigned long seed = 1;
+  size_t i = 0;
+  //Leading silence as synthesizers produce before the speech;
+  const size_t leading = DEFAULT_SAMPLE_RATE / 5 < sampleCount?DEFAULT_SAMPLE_RATE / 5:sampleCount;
+  for(;i < leading;i++)
+    samples[i] = 0;
+  while(i < sampleCount)
+    {
+      seed = seed * 1103515245 + 12345;
+      const size_t wordLen = DEFAULT_SAMPLE_RATE / 8 + (seed >> 16) % (DEFAULT_SAMPLE_RATE / 4);
+      const double freq = 100 + (double)((seed >> 8) % 200);
+      for(size_t k = 0;k < wordLen && i < sampleCount;k++, i++)
+	{
+	  const double envelope = sin(M_PI * (double)k / (double)wordLen);
+	  samples[i] = (short)(8000 * envelope * sin(2 * M_PI * freq * (double)k / DEFAULT_SAMPLE_RATE));
+	}
+      seed = seed * 1103515245 + 12345;
+      const size_t gapLen = DEFAULT_SAMPLE_RATE / 20 + (seed >> 16) % (DEFAULT_SAMPLE_RATE / 5);
+      for(size_t k = 0;k < gapLen && i < sampleCount;k++, i++)
+	samples[i] = 0;
+    } //while();
+}
+
+static bool readSignal(const std::string& fileName, SampleVector& samples)
+{
+  FILE* f = fopen(fileName.c_str(), "rb");
+  if (f == NULL)
+    return 0;
+  short buf[4096];
+  size_t count;
+  while((count = fread(buf, sizeof(short), sizeof(buf) / sizeof(short), f)) > 0)
+    samples.insert(samples.end(), buf, buf + count);
+  fclose(f);
+  return 1;
+}
+
+/*
+ * The algorithm of voiceman-trim before block processing, each write()
+ * call is replaced with an optional write to the given descriptor and
+ * appending to the output vector.
+ */
+static void trimBySamples(const SampleVector& samples, int fd, SampleVector& output)
+{
+  size_t i = 0;
+  while(i < samples.size() && samples[i] == 0)
+    i++;
+  while(i < samples.size())
+    {
+      const short c = samples[i++];
+      if (fd >= 0 && write(fd, &c, sizeof(c)) == -1)
+	return;
+      output.push_back(c);
+      size_t k = 0;
+      while(i < samples.size() && samples[i] == 0)
+	{
+	  i++;
+	  k++;
+	}
+      if (i >= samples.size())
+	break;
+      for(;k > 0;k--)
+	{
+	  const short z = 0;
+	  if (fd >= 0 && write(fd, &z, sizeof(z)) == -1)
+	    return;
+	  output.push_back(z);
+	}
+    } //while();
+}
+
+static void trimByBlocks(const SampleVector& samples, unsigned int threshold, size_t maxGap, SampleVector& output)
+{
+  Trimmer<short> trimmer(threshold, maxGap);
+  for(size_t i = 0;i < samples.size();i += BLOCK_SIZE)
+    trimmer.process(&samples[i], samples.size() - i < BLOCK_SIZE?samples.size() - i:BLOCK_SIZE, output);
+}
+
+static void report(const char* name, size_t sampleCount, double elapsed)
+{
+  printf("%-28s %10.2f ms (%9.2f MB/s)\n", name, elapsed * 1000, (double)(sampleCount * sizeof(short)) / (elapsed * 1048576));
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t iterations = argc > 2?(size_t)atol(argv[2]):DEFAULT_ITERATIONS;
+  SampleVector samples;
+  if (argc > 1 && std::string(argv[1]) != "-")
+    {
+      if (!readSignal(argv[1], samples))
+	{
+	  perror(argv[1]);
+	  return EXIT_FAILURE;
+	}
+    } else
+    generateSignal(DEFAULT_SAMPLE_RATE * DEFAULT_SECONDS, samples);
+  if (samples.empty())
+    {
+      std::cerr << "no samples to process" << std::endl;
+      return EXIT_FAILURE;
+    }
+  const int fd = open("/dev/null", O_WRONLY);
+  if (fd == -1)
+    {
+      perror("/dev/null");
+      return EXIT_FAILURE;
+    }
+  SampleVector expected, output;
+  double start = getTime();
+  trimBySamples(samples, fd, expected);
+  report("per-sample write()", samples.size(), getTime() - start);
+  close(fd);
+  double best = 0;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      output.clear();
+      start = getTime();
+      trimBySamples(samples, -1, output);
+      const double elapsed = getTime() - start;
+      if (k == 0 || elapsed < best)
+	best = elapsed;
+    }
+  report("per-sample, no syscalls", samples.size(), best);
+  for(size_t k = 0;k < iterations;k++)
+    {
+      output.clear();
+      start = getTime();
+      trimByBlocks(samples, 0, TrimUnlimitedGap, output);
+      const double elapsed = getTime() - start;
+      if (k == 0 || elapsed < best)
+	best = elapsed;
+    }
+  report("Trimmer blocks", samples.size(), best);
+  if (output != expected)
+    {
+      std::cerr << "block filtering output differs from sample-by-sample one" << std::endl;
+      return EXIT_FAILURE;
+    }
+  for(size_t k = 0;k < iterations;k++)
+    {
+      output.clear();
+      start = getTime();
+      trimByBlocks(samples, 64, DEFAULT_SAMPLE_RATE / 10, output);
+      const double elapsed = getTime() - start;
+      if (k == 0 || elapsed < best)
+	best = elapsed;
+    }
+  report("Trimmer blocks, compressing", samples.size(), best);
+  printf("%lu samples in, %lu kept, %lu kept with gap compression\n", (unsigned long)samples.size(), (unsigned long)expected.size(), (unsigned long)output.size());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The benchmark of UTF-8 decoding and encoding. English, Russian and
+ * mixed documents are split onto lines as they are received from
+ * clients and processed by Transcoding class and by iconv() called the
+ * way it was done before, the results of both must be identical.
+ */
+
+#include"voiceman.h"
+#include"document.h"
+
+#define DEFAULT_DOCUMENT_SIZE 4194304
+#define DEFAULT_ITERATIONS 3
+#define ICONV_BLOCK_SIZE 50
+
+/*
+ * The reference implementation;
+ */
+
+static std::wstring iconvDecode(iconv_t cd, const std::string& s)
+{
+  std::wstring res;
+  std::vector<char> in(s.begin(), s.end());
+  char* b = in.empty()?NULL:&in[0];
+  size_t bSize = in.size();
+  while(bSize)
+    {
+      wchar_t r[ICONV_BLOCK_SIZE];
+      char* rr = (char*)r;
+      size_t rsize = sizeof(r);
+      const size_t c = iconv(cd, &b, &bSize, &rr, &rsize);
+      res.append(r, ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t));
+      if (c == (size_t)-1 && errno != E2BIG)
+	{
+	  res.append(errno == EINVAL?1:3, L'?');
+	  break;
+	}
+    } //while();
+  return res;
+}
+
+static std::string iconvEncode(iconv_t cd, const std::wstring& s)
+{
+  std::string res;
+  std::vector<wchar_t> in(s.begin(), s.end());
+  char* b = in.empty()?NULL:(char*)&in[0];
+  size_t bSize = in.size() * sizeof(wchar_t);
+  while(bSize)
+    {
+      char r[ICONV_BLOCK_SIZE];
+      char* rr = r;
+      size_t rsize = sizeof(r);
+      const size_t c = iconv(cd, &b, &bSize, &rr, &rsize);
+      res.append(r, ICONV_BLOCK_SIZE - rsize);
+      if (c == (size_t)-1 && errno != E2BIG)
+	{
+	  res += '?';
+	  if (errno != EILSEQ)
+	    break;
+	  b += sizeof(wchar_t);
+	  bSize -= sizeof(wchar_t);
+	}
+    } //while();
+  return res;
+}
+
+static void makeEnglish(const WStringVector& lines, WStringVector& res)
+{
+  res.resize(lines.size());
+  for(WStringVector::size_type i = 0;i < lines.size();i++)
+    {
+      res[i].erase();
+      for(std::wstring::size_type j = 0;j < lines[i].length();j++)
+	if (lines[i][j] < 128)
+	  res[i] += lines[i][j];
+    }
+}
+
+static void makeRussian(const WStringVector& lines, WStringVector& res)
+{
+  res.resize(lines.size());
+  for(WStringVector::size_type i = 0;i < lines.size();i++)
+    {
+      res[i] = lines[i];
+      for(std::wstring::size_type j = 0;j < res[i].length();j++)
+	{
+	  const wchar_t c = res[i][j];
+	  if (c >= 'a' && c <= 'z')
+	    res[i][j] = 0x0430 + (c - 'a'); else
+	    if (c >= 'A' && c <= 'Z')
+	      res[i][j] = 0x0410 + (c - 'A');
+	}
+    }
+}
+
+static void runDocument(const char* name, const WStringVector& lines, size_t iterations)
+{
+  iconv_t decoder = iconv_open("utf32le", "utf8"), encoder = iconv_open("utf8", "utf32le");
+  if (decoder == (iconv_t)-1 || encoder == (iconv_t)-1)
+    {
+      perror("iconv_open()");
+      exit(EXIT_FAILURE);
+    }
+  StringVector encoded(lines.size());
+  size_t bytes = 0;
+  for(WStringVector::size_type i = 0;i < lines.size();i++)
+    {
+      encoded[i] = iconvEncode(encoder, lines[i]);
+      bytes += encoded[i].length();
+    }
+  double bestIconvDecode = 0, bestDecode = 0, bestIconvEncode = 0, bestEncode = 0;
+  bool same = 1;
+  for(size_t k = 0;k < iterations;k++)
+    {
+      double start = getTime();
+      WStringVector iconvDecoded(lines.size());
+      for(StringVector::size_type i = 0;i < encoded.size();i++)
+	iconvDecoded[i] = iconvDecode(decoder, encoded[i]);
+      const double iconvDecodeElapsed = getTime() - start;
+      start = getTime();
+      WStringVector decoded(lines.size());
+      for(StringVector::size_type i = 0;i < encoded.size();i++)
+	readUTF8(encoded[i].data(), encoded[i].length(), decoded[i]);
+      const double decodeElapsed = getTime() - start;
+      start = getTime();
+      StringVector iconvEncoded(lines.size());
+      for(WStringVector::size_type i = 0;i < lines.size();i++)
+	iconvEncoded[i] = iconvEncode(encoder, lines[i]);
+      const double iconvEncodeElapsed = getTime() - start;
+      start = getTime();
+      StringVector reencoded(lines.size());
+      for(WStringVector::size_type i = 0;i < lines.size();i++)
+	encodeUTF8(lines[i], reencoded[i]);
+      const double encodeElapsed = getTime() - start;
+      if (decoded != iconvDecoded || decoded != lines || reencoded != iconvEncoded)
+	same = 0;
+      if (k == 0 || iconvDecodeElapsed < bestIconvDecode)
+	bestIconvDecode = iconvDecodeElapsed;
+      if (k == 0 || decodeElapsed < bestDecode)
+	bestDecode = decodeElapsed;
+      if (k == 0 || iconvEncodeElapsed < bestIconvEncode)
+	bestIconvEncode = iconvEncodeElapsed;
+      if (k == 0 || encodeElapsed < bestEncode)
+	bestEncode = encodeElapsed;
+    } //for(iterations);
+  iconv_close(decoder);
+  iconv_close(encoder);
+  const double mb = (double)bytes / 1048576;
+  printf("%-8s %8lu bytes: decode iconv %8.2f MB/s, Transcoding %8.2f MB/s (%5.2fx); encode iconv %8.2f MB/s, Transcoding %8.2f MB/s (%5.2fx), %s\n",
+	 name, (unsigned long)bytes,
+	 mb / bestIconvDecode, mb / bestDecode, bestIconvDecode / bestDecode,
+	 mb / bestIconvEncode, mb / bestEncode, bestIconvEncode / bestEncode,
+	 same?"same results":"RESULTS DIFFER");
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t documentSize = argc > 1?(size_t)atol(argv[1]):DEFAULT_DOCUMENT_SIZE;
+  const size_t iterations = argc > 2?(size_t)atol(argv[2]):DEFAULT_ITERATIONS;
+  WStringVector mixed, english, russian;
+  generateDocument(documentSize, mixed);
+  makeEnglish(mixed, english);
+  makeRussian(mixed, russian);
+  runDocument("english", english, iterations);
+  runDocument("russian", russian, iterations);
+  runDocument("mixed", mixed, iterations);
+  return EXIT_SUCCESS;
+}
@@ -21,8 +21,10 @@
  * The VoiceMan executor as external process has stdout and stderr
  * streams to send data back to VoiceMan and report errors. These two
  * streams must be handled in general main loop via adding them into
- * pselect() call. This interface is used to get both file descriptors of
- * executor and send notification there is data to read from them.
+ * epoll_wait() call. This interface is used to get both file descriptors of
+ * executor and send notification there is data to read from them. The
+ * executor input pipe is non-blocking, so it is also watched by the main
+ * loop while there are buffered commands not written to it yet.
  *
  * \sa ExecutorInterface MainLoop
  */
@@ -32,7 +34,7 @@ public:
   /**\brief Returns the file descriptor of executor stdout stream
    *
    * This method returns file descriptor of executor stdout stream. This
-   * descriptor must be added to the main pselect() call to know when we
+   * descriptor must be added to the main epoll_wait() call to know when we
    * have data to read.
    *
    * \return The file descriptor of executor stdout stream
@@ -42,7 +44,7 @@ public:
   /**\brief Returns the file descriptor of executor stderr stream
    *
    * This method returns file descriptor of executor stderr stream. This
-   * descriptor must be added to the main pselect() call to know when we
+   * descriptor must be added to the main epoll_wait() call to know when we
    * have data to read.
    *
    * \return The file descriptor of executor stderr stream
@@ -53,8 +55,9 @@ public:
    *
    * This method notifies implementation to read accessible data from
    * executor output stream. This notification is sent by MainLoop class
-   * when it receives corresponding information from main pselect() system
-   * call.
+   * when it receives corresponding information from main epoll_wait() system
+   * call. The descriptor is registered in edge-triggered mode, so all
+   * accessible data must be read until read() reports EAGAIN.
    */
   virtual void readExecutorStdoutData() = 0;
 
@@ -62,10 +65,39 @@ public:
    *
    * This method notifies implementation to read accessible data from
    * executor error stream. This notification is sent by MainLoop class
-   * when it receives corresponding information from main pselect() system
-   * call.
+   * when it receives corresponding information from main epoll_wait() system
+   * call. The descriptor is registered in edge-triggered mode, so all
+   * accessible data must be read until read() reports EAGAIN.
    */
   virtual void readExecutorStderrData() = 0;
+
+  /**\brief Returns the file descriptor of executor stdin stream
+   *
+   * This method returns file descriptor of the pipe used to send
+   * commands to executor. The descriptor is changed each time executor
+   * is relaunched.
+   *
+   * \return The file descriptor of executor stdin stream or -1 if executor is not running
+   */
+  virtual int getExecutorStdinDescriptor() const = 0;
+
+  /**\brief Checks if there are commands waiting to be sent to executor
+   *
+   * The main loop waits for executor stdin stream to become writable only
+   * while this method returns non-zero value.
+   *
+   * \return Non-zero if there is buffered data for executor or zero otherwise
+   */
+  virtual bool hasExecutorStdinData() const = 0;
+
+  /**\brief Notifies executor stdin stream is ready for writing
+   *
+   * This method notifies implementation to write buffered commands to
+   * executor input pipe. This notification is sent by MainLoop class
+   * when it receives corresponding information from main epoll_wait()
+   * system call.
+   */
+  virtual void writeExecutorStdinData() = 0;
 }; //class AbstractExecutorOutput;
 
 #endif //__VOICEMAN_ABSTRACT_EXECUTOR_OUTPUT_H__
@@ -0,0 +1,132 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_CHAR_TABLE_H__
+#define __VOICEMAN_CHAR_TABLE_H__
+
+/**\brief The table of values associated with characters
+ *
+ * This class is a replacement of std::map for the tables with character
+ * keys, which are consulted for each character of the processed
+ * text. Characters of the basic multilingual plane are looked up with
+ * two-level page table: the first level is indexed by high byte of the
+ * character and refers to a page of 256 entries, allocated only for the
+ * blocks actually used (usually only ASCII and Cyrillic). All other
+ * characters are stored in usual std::map.
+ *
+ * \sa TextProcessor
+ */
+template<typename T>
+class CharTable
+{
+public:
+  /**\brief The default constructor*/
+  CharTable()
+  {
+    clear();
+  }
+
+  /**\brief The destructor*/
+  virtual ~CharTable() {}
+
+  /**\brief Associates value with character
+   *
+   * \param [in] c The character to set value for
+   * \param [in] value The value to set
+   */
+  void set(wchar_t c, const T& value)
+  {
+    if (!isPaged(c))
+      {
+	m_other[c] = value;
+	return;
+      }
+    size_t& page = m_directory[pageIndex(c)];
+    if (page == NoPage)
+      {
+	page = m_pages.size();
+	m_pages.push_back(Page(PAGE_SIZE));
+      }
+    Entry& entry = m_pages[page][entryIndex(c)];
+    entry.value = value;
+    entry.present = 1;
+  }
+
+  /**\brief Finds value associated with character
+   *
+   * \param [in] c The character to find value for
+   *
+   * \return The pointer to the value or NULL if there is no value for this character
+   */
+  const T* find(wchar_t c) const
+  {
+    if (isPaged(c))
+      {
+	const size_t page = m_directory[pageIndex(c)];
+	if (page == NoPage)
+	  return NULL;
+	const Entry& entry = m_pages[page][entryIndex(c)];
+	return entry.present?&entry.value:NULL;
+      }
+    typename std::map<wchar_t, T>::const_iterator it = m_other.find(c);
+    return it != m_other.end()?&it->second:NULL;
+  }
+
+  /**\brief Removes all values from the table*/
+  void clear()
+  {
+    for(size_t i = 0;i < DIRECTORY_SIZE;i++)
+      m_directory[i] = NoPage;
+    m_pages.clear();
+    m_other.clear();
+  }
+
+private:
+  enum {PAGE_BITS = 8, PAGE_SIZE = 256, DIRECTORY_SIZE = 256, NoPage = (size_t)-1};
+
+  struct Entry
+  {
+    Entry()
+      : value(), present(0) {}
+
+    T value;
+    bool present;
+  }; //struct Entry;
+
+  typedef std::vector<Entry> Page;
+  typedef std::vector<Page> PageVector;
+
+  static bool isPaged(wchar_t c)
+  {
+    return c >= 0 && (unsigned long)c < PAGE_SIZE * DIRECTORY_SIZE;
+  }
+
+  static size_t pageIndex(wchar_t c)
+  {
+    return (size_t)c >> PAGE_BITS;
+  }
+
+  static size_t entryIndex(wchar_t c)
+  {
+    return (size_t)c & (PAGE_SIZE - 1);
+  }
+
+private:
+  size_t m_directory[DIRECTORY_SIZE];
+  PageVector m_pages;
+  std::map<wchar_t, T> m_other;
+}; //class CharTable;
+
+#endif //__VOICEMAN_CHAR_TABLE_H__
@@ -17,6 +17,7 @@
 #define __VOICEMAN_CLIENT_H__
 
 #include"TextParam.h"
+#include"UtteranceTrace.h"
 #include"system/sockets.h"
 
 /**\brief The class to store client specific data
@@ -34,21 +35,27 @@ class Client
 public:
   /**\brief The default constructor*/
   Client()
-    : rejecting(0) {}
+    : id(0), rejecting(0) {}
 
   /**\brief The constructor with socket object specification
    *
    * \param [in] s The socket object for data exchanging
    */
   Client(auto_ptr<Socket> s)
-    : rejecting(0), socket(s) {}
+    : id(0), rejecting(0), socket(s) {}
 
   /**\brief The destructor*/
   virtual ~Client() {}
 
 public:
-  /**\brief The buffer with received incomplete data */
-  std::string buf;
+  /**\brief The number of the connection since the daemon start, zero for fake clients*/
+  size_t id;
+
+  /**\brief The buffer the data from the client is received into*/
+  LineReader input;
+
+  /**\brief The data waiting to be sent to the client*/
+  std::string output;
 
   /**\brief The current volume value associated with the connection*/
   TextParam volume;
@@ -65,6 +72,9 @@ public:
   /**\brief The name of selected text processor*/
   std::string selectedTextProcessor;
 
+  /**\brief The timestamps of the line being processed*/
+  UtteranceTrace trace;
+
   /**\brief Is server skip all data from the client due to line length exceed*/
   bool rejecting;
 
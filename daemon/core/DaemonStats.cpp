@@ -0,0 +1,104 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"DaemonStats.h"
+
+//Four buckets per binary order from one microsecond to 2^28 microseconds;
+#define BUCKETS_PER_ORDER 4
+#define BUCKET_COUNT (28 * BUCKETS_PER_ORDER + 1)
+
+DaemonStats daemonStats;
+
+LatencyHistogram::LatencyHistogram()
+  : m_buckets(BUCKET_COUNT, 0), m_count(0)
+{
+}
+
+void LatencyHistogram::add(double seconds)
+{
+  const double us = seconds * 1000000;
+  size_t index = 0;
+  if (us >= 1)
+    index = (size_t)(log2(us) * BUCKETS_PER_ORDER) + 1;
+  if (index >= BUCKET_COUNT)
+    index = BUCKET_COUNT - 1;
+  m_buckets[index]++;
+  m_count++;
+}
+
+double LatencyHistogram::getPercentile(double percentile) const
+{
+  if (m_count == 0)
+    return 0;
+  //The number of values not greater than the percentile value, at least one;
+  size_t rank = (size_t)ceil(percentile * (double)m_count / 100);
+  if (rank == 0)
+    rank = 1;
+  size_t c = 0;
+  for(size_t i = 0;i < m_buckets.size();i++)
+    {
+      c += m_buckets[i];
+      if (c >= rank)
+	return pow(2.0, (double)i / BUCKETS_PER_ORDER) / 1000000;
+    }
+  return pow(2.0, (double)(m_buckets.size() - 1) / BUCKETS_PER_ORDER) / 1000000;
+}
+
+void DaemonStats::addTrace(const UtteranceTrace& trace)
+{
+  for(int i = 0;i < TraceStageCount;i++)
+    {
+      const double duration = trace.getDuration(i);
+      if (duration >= 0)
+	stageLatency[i].add(duration);
+    }
+  const double audioStart = trace.getAudioStartLatency();
+  if (audioStart >= 0)
+    audioStartLatency.add(audioStart);
+}
+
+static void formatHistogram(std::ostringstream& s, const std::string& name, const LatencyHistogram& h)
+{
+  s << name << ".count " << h.getCount() << std::endl;
+  if (h.getCount() == 0)
+    return;
+  s << name << ".p50 " << h.getPercentile(50) * 1000 << std::endl;
+  s << name << ".p95 " << h.getPercentile(95) * 1000 << std::endl;
+  s << name << ".p99 " << h.getPercentile(99) * 1000 << std::endl;
+}
+
+std::string DaemonStats::format() const
+{
+  std::ostringstream s;
+  s.setf(std::ios::fixed);
+  s.precision(3);
+  s << "clients.connected " << connectedClients << std::endl;
+  s << "clients.accepted " << acceptedClients << std::endl;
+  s << "input.bytes " << receivedBytes << std::endl;
+  s << "input.lines " << receivedLines << std::endl;
+  for(StringToSizeMap::const_iterator it = textProcessorItems.begin();it != textProcessorItems.end();it++)
+    s << "textproc." << it->first << ".items " << it->second << std::endl;
+  s << "executor.starts " << executorStarts << std::endl;
+  s << "executor.restarts " << (executorStarts > 0?executorStarts - 1:0) << std::endl;
+  s << "executor.queue " << executorQueueSize << std::endl;
+  s << "executor.queuelimit " << queueLimitDrops << std::endl;
+  for(int i = 0;i < TraceStageCount;i++)
+    if (i != TraceStageRead)//the first stage has no duration;
+      formatHistogram(s, std::string("latency.") + getStageName(i), stageLatency[i]);
+  formatHistogram(s, "latency.audiostart", audioStartLatency);
+  s << std::endl;
+  return s.str();
+}
@@ -0,0 +1,114 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_DAEMON_STATS_H__
+#define __VOICEMAN_DAEMON_STATS_H__
+
+#include"UtteranceTrace.h"
+
+/**\brief The histogram of latency values
+ *
+ * This class counts latency values in buckets growing by a quarter of
+ * binary order each, from one microsecond up to several minutes. It
+ * takes fixed amount of memory regardless of the number of values and
+ * gives percentiles with relative error below 19 percent, that is
+ * enough to watch the service latency.
+ */
+class LatencyHistogram
+{
+public:
+  /**\brief The default constructor*/
+  LatencyHistogram();
+
+  /**\brief Counts new value
+   *
+   * \param [in] seconds The latency value in seconds
+   */
+  void add(double seconds);
+
+  /**\brief Returns the number of counted values
+   *
+   * \return The number of counted values
+   */
+  size_t getCount() const
+  {
+    return m_count;
+  }
+
+  /**\brief Returns the upper bound of values below the given percentile
+   *
+   * \param [in] percentile The percentile from 0 to 100
+   *
+   * \return The value in seconds or zero if no values were counted
+   */
+  double getPercentile(double percentile) const;
+
+private:
+  std::vector<size_t> m_buckets;
+  size_t m_count;
+}; //class LatencyHistogram;
+
+/**\brief Runtime counters of the daemon
+ *
+ * This structure collects counters of the daemon activity. The counters
+ * are increased by the classes doing the corresponding work and can be
+ * queried by clients with the statistics command of the protocol. The
+ * latency histograms are filled only if latency tracing is enabled.
+ *
+ * \sa VoicemanProtocol UtteranceTrace
+ */
+struct DaemonStats
+{
+  /**\brief The default constructor*/
+  DaemonStats()
+    : connectedClients(0),
+      acceptedClients(0),
+      receivedBytes(0),
+      receivedLines(0),
+      executorStarts(0),
+      executorQueueSize(0),
+      queueLimitDrops(0) {}
+
+  /**\brief Counts stage durations of the text block which playback is over
+   *
+   * \param [in] trace The timestamps of the text block
+   */
+  void addTrace(const UtteranceTrace& trace);
+
+  /**\brief Prepares the statistics report
+   *
+   * The report consists of lines with counter name and value separated
+   * by space. Latencies are given in milliseconds. The report is
+   * terminated by an empty line.
+   *
+   * \return The report text
+   */
+  std::string format() const;
+
+  size_t connectedClients;
+  size_t acceptedClients;
+  size_t receivedBytes;
+  size_t receivedLines;
+  StringToSizeMap textProcessorItems;
+  size_t executorStarts;
+  size_t executorQueueSize;
+  size_t queueLimitDrops;
+  LatencyHistogram stageLatency[TraceStageCount];
+  LatencyHistogram audioStartLatency;
+}; //struct DaemonStats;
+
+extern DaemonStats daemonStats;
+
+#endif //__VOICEMAN_DAEMON_STATS_H__
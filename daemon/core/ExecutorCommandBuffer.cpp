@@ -0,0 +1,168 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"ExecutorCommandBuffer.h"
+
+#define INITIAL_CAPACITY 4096
+
+void ExecutorCommandBuffer::append(const void* buf, size_t size)
+{
+  assert(buf);
+  if (size == 0)
+    return;
+  reserve(m_size + size);
+  const char* b = (const char*)buf;
+  size_t tail = (m_head + m_size) % m_data.size();
+  size_t c = 0;
+  while(c < size)
+    {
+      const size_t chunk = std::min(size - c, m_data.size() - tail);
+      memcpy(&m_data[tail], &b[c], chunk);
+      c += chunk;
+      tail = (tail + chunk) % m_data.size();
+    } //while();
+  m_size += size;
+  m_pendingSize += size;
+}
+
+void ExecutorCommandBuffer::commit(bool droppable)
+{
+  if (m_pendingSize == 0)
+    return;
+  m_commands.push_back(Command(m_pendingSize, droppable));
+  m_pendingSize = 0;
+}
+
+size_t ExecutorCommandBuffer::dropPending()
+{
+  assert(m_pendingSize == 0);
+  size_t keptSize = 0, dropped = 0;
+  bool first = 1;
+  for(CommandDeque::const_iterator it = m_commands.begin();it != m_commands.end();it++)
+    {
+      //Command already partially written must be completed to keep framing;
+      if (!it->droppable || (first && m_headWritten > 0))
+	keptSize += it->size; else
+	dropped++;
+      first = 0;
+    } //for(commands);
+  if (dropped == 0)
+    return 0;
+  std::vector<char> newData(std::max(keptSize, (size_t)INITIAL_CAPACITY));
+  CommandDeque newCommands;
+  size_t offset = 0, newOffset = 0;
+  first = 1;
+  for(CommandDeque::const_iterator it = m_commands.begin();it != m_commands.end();it++)
+    {
+      const size_t written = first?m_headWritten:0;
+      if (!it->droppable || (first && m_headWritten > 0))
+	{
+	  copyOut(offset, it->size - written, &newData[newOffset]);
+	  newOffset += it->size - written;
+	  newCommands.push_back(*it);
+	}
+      offset += it->size - written;
+      first = 0;
+    } //for(commands);
+  //m_headWritten is kept as is, partially written command remains the first one;
+  m_data.swap(newData);
+  m_commands.swap(newCommands);
+  m_head = 0;
+  m_size = newOffset;
+  return dropped;
+}
+
+int ExecutorCommandBuffer::flush(int fd)
+{
+  while(m_size > 0)
+    {
+      struct iovec iov[2];
+      const size_t firstPart = std::min(m_size, m_data.size() - m_head);
+      iov[0].iov_base = &m_data[m_head];
+      iov[0].iov_len = firstPart;
+      iov[1].iov_base = &m_data[0];
+      iov[1].iov_len = m_size - firstPart;
+      const ssize_t res = writev(fd, iov, iov[1].iov_len > 0?2:1);
+      if (res == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    return 0;
+	  return -1;
+	}
+      consume((size_t)res);
+    } //while();
+  return 0;
+}
+
+void ExecutorCommandBuffer::clear()
+{
+  m_head = 0;
+  m_size = 0;
+  m_commands.clear();
+  m_headWritten = 0;
+  m_pendingSize = 0;
+}
+
+void ExecutorCommandBuffer::copyOut(size_t offset, size_t size, char* dest) const
+{
+  assert(offset + size <= m_size);
+  size_t pos = (m_head + offset) % m_data.size();
+  size_t c = 0;
+  while(c < size)
+    {
+      const size_t chunk = std::min(size - c, m_data.size() - pos);
+      memcpy(&dest[c], &m_data[pos], chunk);
+      c += chunk;
+      pos = (pos + chunk) % m_data.size();
+    } //while();
+}
+
+void ExecutorCommandBuffer::reserve(size_t size)
+{
+  if (size <= m_data.size())
+    return;
+  size_t newCapacity = m_data.empty()?INITIAL_CAPACITY:m_data.size();
+  while(newCapacity < size)
+    newCapacity *= 2;
+  std::vector<char> newData(newCapacity);
+  if (m_size > 0)
+    copyOut(0, m_size, &newData[0]);
+  m_data.swap(newData);
+  m_head = 0;
+}
+
+void ExecutorCommandBuffer::consume(size_t size)
+{
+  assert(size <= m_size);
+  m_head = (m_head + size) % m_data.size();
+  m_size -= size;
+  size_t c = size;
+  while(c > 0)
+    {
+      assert(!m_commands.empty());
+      const size_t left = m_commands.front().size - m_headWritten;
+      if (c < left)
+	{
+	  m_headWritten += c;
+	  break;
+	}
+      c -= left;
+      m_commands.pop_front();
+      m_headWritten = 0;
+    } //while();
+}
@@ -0,0 +1,115 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_EXECUTOR_COMMAND_BUFFER_H__
+#define __VOICEMAN_EXECUTOR_COMMAND_BUFFER_H__
+
+/**\brief The ring buffer of commands waiting to be written to executor
+ *
+ * The executor input pipe is non-blocking, so commands which cannot be
+ * written immediately are kept in this buffer until the main loop
+ * reports the pipe is writable again. Data is stored in a growing ring
+ * and flushed with single writev() call for both its parts. The buffer
+ * remembers the boundaries of each command, so the commands not yet
+ * started to be written can be dropped without breaking command
+ * framing. It lets "STOP" command overtake queued "SAY" data.
+ *
+ * \sa ExecutorInterface
+ */
+class ExecutorCommandBuffer
+{
+public:
+  /**\brief The default constructor*/
+  ExecutorCommandBuffer()
+    : m_head(0), m_size(0), m_headWritten(0), m_pendingSize(0) {}
+
+  /**\brief The destructor*/
+  virtual ~ExecutorCommandBuffer() {}
+
+  /**\brief Appends data block to the command being prepared
+   *
+   * \param [in] buf The data to append
+   * \param [in] size The length of the data in bytes
+   */
+  void append(const void* buf, size_t size);
+
+  /**\brief Finishes the command prepared by previous append() calls
+   *
+   * \param [in] droppable May this command be dropped by dropPending() call
+   */
+  void commit(bool droppable);
+
+  /**\brief Drops all droppable commands not yet started to be written
+   *
+   * \return The number of dropped commands
+   */
+  size_t dropPending();
+
+  /**\brief Writes as much buffered data as possible
+   *
+   * This method writes buffered commands to the given non-blocking
+   * descriptor until all of them are written or write would block.
+   *
+   * \param [in] fd The descriptor to write data to
+   *
+   * \return Zero on success or -1 on error with errno set
+   */
+  int flush(int fd);
+
+  /**\brief Removes all buffered data*/
+  void clear();
+
+  /**\brief Checks if there are commands waiting to be written
+   *
+   * \return Non-zero if there are buffered commands or zero otherwise
+   */
+  bool isEmpty() const
+  {
+    return m_commands.empty();
+  }
+
+  /**\brief Returns the number of buffered bytes
+   *
+   * \return The number of buffered bytes
+   */
+  size_t getSize() const
+  {
+    return m_size;
+  }
+
+private:
+  struct Command
+  {
+    Command(size_t s, bool d)
+      : size(s), droppable(d) {}
+
+    size_t size;
+    bool droppable;
+  }; //struct Command;
+
+  typedef std::deque<Command> CommandDeque;
+
+  void copyOut(size_t offset, size_t size, char* dest) const;
+  void reserve(size_t size);
+  void consume(size_t size);
+
+private:
+  std::vector<char> m_data;
+  size_t m_head, m_size;
+  CommandDeque m_commands;
+  size_t m_headWritten, m_pendingSize;
+}; //class ExecutorCommandBuffer;
+
+#endif //__VOICEMAN_EXECUTOR_COMMAND_BUFFER_H__
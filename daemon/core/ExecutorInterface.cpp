@@ -18,12 +18,16 @@
 #include"executorCommandHeader.h"
 
 #define SHELL "/bin/sh"
+#define MAX_TRACED_UTTERANCES 256
 
-ExecutorInterface::ExecutorInterface(AbstractExecutorCallback& callback, const OutputSet& outputSet, size_t maxQueueSize, const std::string& executorName, PlayerType playerType)
-  : m_callback(callback), m_outputSet(outputSet), m_maxQueueSize(maxQueueSize), m_executorName(executorName), m_playerType(playerType), m_pid(0)
+ExecutorInterface::ExecutorInterface(AbstractExecutorCallback& callback, const OutputSet& outputSet, size_t maxQueueSize, const std::string& executorName, PlayerType playerType, const sigset_t& origMask)
+  : m_callback(callback), m_outputSet(outputSet), m_maxQueueSize(maxQueueSize), m_executorName(executorName), m_playerType(playerType), m_origMask(origMask), m_pid(0), m_lastUtterance(0)
 {
   VM_SYS(pipe(m_outputPipe) == 0, "pipe()");
   VM_SYS(pipe(m_errorPipe) == 0, "pipe()");
+  //Reading ends are handled by edge-triggered main loop and must not block;
+  VM_SYS(fcntl(m_outputPipe[0], F_SETFL, O_NONBLOCK) != -1, "fcntl()");
+  VM_SYS(fcntl(m_errorPipe[0], F_SETFL, O_NONBLOCK) != -1, "fcntl()");
 }
 
 ExecutorInterface::~ExecutorInterface()
@@ -34,22 +38,22 @@ ExecutorInterface::~ExecutorInterface()
   close(m_errorPipe[1]);
 }
 
-void ExecutorInterface::sayOrEnqueue(const TextItem& textItem)
+void ExecutorInterface::sayOrEnqueue(const TextItem& textItem, const UtteranceTrace& trace, bool continuation)
 {
-  const std::string& outputName = textItem.getOutputName();
-  if (trim(outputName).empty())
+  const OutputHandle outputHandle = textItem.getOutputHandle();
+  if (outputHandle == OUTPUT_HANDLE_NONE)
     {
-      logMsg(LOG_WARNING, "Received text item to play, but output name is empty, ignoring...");
+      logMsg(LOG_WARNING, "Received text item to play, but output is not assigned, ignoring...");
       return;
     }
-  if (!m_outputSet.hasOutput(outputName))
+  if (!m_outputSet.hasOutput(outputHandle))
     {
-      logMsg(LOG_ERR, "Received text item, but output name is unknown (\'%s\'), ignoring...", outputName.c_str());
+      logMsg(LOG_ERR, "Received text item, but output handle is unknown (%u), ignoring...", outputHandle);
       return;
     }
   if (m_pid == 0)//executor is not started;
     {
-      logMsg(LOG_DEBUG, "Having text to say, but executor is not running, Launching it...");
+      VM_LOG_DEBUG("Having text to say, but executor is not running, Launching it...");
       runExecutor();
       if (m_pid == 0)
 	{
@@ -63,9 +67,9 @@ void ExecutorInterface::sayOrEnqueue(const TextItem& textItem)
       stopExecutor();
       return;
     }
-  const std::string synthCommand = m_outputSet.prepareSynthCommand(outputName, textItem);
-  const std::string playerCommand = m_outputSet.preparePlayerCommand(outputName, m_playerType, textItem);
-  const std::string text = m_outputSet.prepareText(outputName, textItem);
+  const std::string synthCommand = m_outputSet.prepareSynthCommand(outputHandle, textItem);
+  const std::string playerCommand = m_outputSet.preparePlayerCommand(outputHandle, m_playerType, textItem);
+  const std::string text = m_outputSet.prepareText(outputHandle, textItem);
   if (trim(synthCommand).empty())
     {
       logMsg(LOG_WARNING, "Prepared synth command to be sent to executor is empty");
@@ -76,32 +80,52 @@ void ExecutorInterface::sayOrEnqueue(const TextItem& textItem)
       logMsg(LOG_WARNING, "Prepared player command to be sent to executor is empty");
       return;
     }
-  logMsg(LOG_DEBUG, "Text and command line prepared to be sent to executor:");
-  logMsg(LOG_DEBUG, "Synth command line: %s;", synthCommand.c_str());
-  logMsg(LOG_DEBUG, "Player command line: %s;", playerCommand.c_str());
-  logMsg(LOG_DEBUG, "Text: %s.", text.c_str());
+  VM_LOG_DEBUG("Text and command line prepared to be sent to executor (output \'%s\'):", m_outputSet.getOutputName(outputHandle).c_str());
+  VM_LOG_DEBUG("Synth command line: %s;", synthCommand.c_str());
+  VM_LOG_DEBUG("Player command line: %s;", playerCommand.c_str());
+  VM_LOG_DEBUG("Text: %s.", text.c_str());
   CommandHeader header;
-  header.code = COMMAND_SAY;
+  header.code = m_outputSet.isPersistent(outputHandle)?COMMAND_SAY_PERSISTENT:COMMAND_SAY;
+  if (m_playerType == PlayerTypeLibao)//player command contains audio format to be played by executor itself;
+    header.code |= COMMAND_PLAYER_LIBAO;
+  if (continuation)//the whole text split into chunks is accepted or dropped by executor queue limit;
+    header.code |= COMMAND_CONTINUATION;
   header.param1 = synthCommand.length() + 1;//+1 to reflect ending zero;
   header.param2 = playerCommand.length() + 1;//+1 to reflect ending zero;
   header.param3 = text.length() + 1;//+1 to reflect ending zero;
-  if (!sendBlockToExecutor(&header, sizeof(CommandHeader), "\'SAY\' command header"))
-    return;
-  if (!sendBlockToExecutor(synthCommand.c_str(), synthCommand.length() + 1, "synth command"))
-    return;
-  if (!sendBlockToExecutor(playerCommand.c_str(), playerCommand.length() + 1, "player command"))
-    return;
-  if (!sendBlockToExecutor(text.c_str(), text.length() + 1, "text"))
+  header.utterance = 0;
+  if (utteranceTracing)
+    {
+      if (++m_lastUtterance == 0)
+	m_lastUtterance = 1;
+      header.utterance = m_lastUtterance;
+    }
+  m_commandBuffer.append(&header, sizeof(CommandHeader));
+  m_commandBuffer.append(synthCommand.c_str(), synthCommand.length() + 1);
+  m_commandBuffer.append(playerCommand.c_str(), playerCommand.length() + 1);
+  m_commandBuffer.append(text.c_str(), text.length() + 1);
+  m_commandBuffer.commit(1);
+  if (!flushCommands("\'SAY\' command"))
     return;
-  logMsg(LOG_DEBUG, "Command was successfully sent to executor!");
+  daemonStats.executorQueueSize++;
+  if (header.utterance != 0)
+    {
+      UtteranceTrace& t = m_traces[header.utterance];
+      t = trace;
+      t.mark(TraceStageWrite);
+      //Text blocks rejected by executor queue limit never finish;
+      if (m_traces.size() > MAX_TRACED_UTTERANCES)
+	m_traces.erase(m_traces.begin());
+    }
+  VM_LOG_DEBUG("Command was successfully queued to executor!");
 }
 
 void ExecutorInterface::stop()
 {
-  logMsg(LOG_DEBUG, "Sending \'STOP\' command to executor");
+  VM_LOG_DEBUG("Sending \'STOP\' command to executor");
   if (m_pid == 0)//executor is not running;
     {
-      logMsg(LOG_DEBUG, "We must send \'STOP\' command, but executor is not running");
+      VM_LOG_DEBUG("We must send \'STOP\' command, but executor is not running");
       return;
     }
   if (m_pipe == 0)
@@ -109,20 +133,29 @@ void ExecutorInterface::stop()
       logMsg(LOG_ERR, "Executor pid is non-zero but input pipe is not valid, error sending \'STOP\' command");
       return;
     }
+  const size_t dropped = m_commandBuffer.dropPending();
+  if (dropped > 0)
+    VM_LOG_DEBUG("%u commands not yet sent to executor were dropped", dropped);
+  m_traces.clear();//stopped text blocks have no playback end;
+  daemonStats.executorQueueSize = 0;
   CommandHeader header;
   header.code = COMMAND_STOP;
   header.param1 = 0;
   header.param2 = 0;
   header.param3 = 0;
-  sendBlockToExecutor(&header, sizeof(CommandHeader), "stop command header");
-  logMsg(LOG_DEBUG, "\'STOP\' command was sent successfully");
+  header.utterance = 0;
+  m_commandBuffer.append(&header, sizeof(CommandHeader));
+  m_commandBuffer.commit(0);
+  if (!flushCommands("stop command header"))
+    return;
+  VM_LOG_DEBUG("\'STOP\' command was sent successfully");
 }
 
 void ExecutorInterface::tone(size_t freq, size_t duration)
 {
   if (m_pid == 0)//executor is not started;
     {
-      logMsg(LOG_DEBUG, "Having tone to play, but executor is not running, Launching it...");
+      VM_LOG_DEBUG("Having tone to play, but executor is not running, Launching it...");
       runExecutor();
       if (m_pid == 0)
 	{
@@ -135,7 +168,11 @@ void ExecutorInterface::tone(size_t freq, size_t duration)
   header.param1 = freq;
   header.param2 = duration;
   header.param3 = 0;
-  sendBlockToExecutor(&header, sizeof(CommandHeader), "\'TONE\' command");
+  header.utterance = 0;
+  m_commandBuffer.append(&header, sizeof(CommandHeader));
+  m_commandBuffer.commit(1);
+  if (flushCommands("\'TONE\' command"))
+    daemonStats.executorQueueSize++;
 }
 
 void ExecutorInterface::runExecutor()
@@ -148,7 +185,7 @@ void ExecutorInterface::runExecutor()
       logMsg(LOG_ERR, "Could not create pipe for communications with executor (pipe() returned %s)", ERRNO_MSG);
       return;
     }
-  logMsg(LOG_DEBUG, "starting executor as \'%s\'", m_executorName.c_str());
+  VM_LOG_DEBUG("starting executor as \'%s\'", m_executorName.c_str());
   m_pid = fork();
   if (m_pid == (pid_t)-1)
     {
@@ -166,28 +203,43 @@ void ExecutorInterface::runExecutor()
       dup2(pp[0], STDIN_FILENO);
       dup2(m_outputPipe[1], STDOUT_FILENO);
       dup2(m_errorPipe[1], STDERR_FILENO);
+      //Signals blocked by daemon main loop must not stay blocked in executor and its synthesizers and players;
+      sigprocmask(SIG_SETMASK, &m_origMask, NULL);
       if (execlp(SHELL, SHELL, "-c", m_executorName.c_str(), (char*)0) == -1)
 	exit(EXIT_FAILURE);
     } // child process;
   close(pp[0]);
   m_pipe = pp[1];
+  //Commands are buffered and written as the pipe becomes writable, daemon must never block on busy executor;
+  if (fcntl(m_pipe, F_SETFL, O_NONBLOCK) == -1)
+    logMsg(LOG_ERR, "Could not switch executor input pipe to non-blocking mode (fcntl() returned %s)", ERRNO_MSG);
+  m_commandBuffer.clear();
+  daemonStats.executorStarts++;
   CommandHeader header;
   header.code = COMMAND_SET_QUEUE_LIMIT;
   header.param1 = m_maxQueueSize;
   header.param2 = 0;
   header.param3 = 0;
-  sendBlockToExecutor(&header, sizeof(CommandHeader), "\'SET_QUEUE_LIMIT\' command");
+  header.utterance = 0;
+  m_commandBuffer.append(&header, sizeof(CommandHeader));
+  m_commandBuffer.commit(0);
+  flushCommands("\'SET_QUEUE_LIMIT\' command");
 }
 
 void ExecutorInterface::stopExecutor()
 {
   if (m_pid == 0)
     {
-      logMsg(LOG_DEBUG, "Could not stop executor, it is not running (pid == 0)");
+      VM_LOG_DEBUG("Could not stop executor, it is not running (pid == 0)");
       return;
     }
   close(m_pipe);
   m_pipe = 0;
+  if (!m_commandBuffer.isEmpty())
+    VM_LOG_DEBUG("%u bytes of commands were not sent to stopped executor", m_commandBuffer.getSize());
+  m_commandBuffer.clear();
+  m_traces.clear();
+  daemonStats.executorQueueSize = 0;
   int status = 0;
   //Maybe it is good idea to add delay and send SIGKILL explicitly if executor does not died in one second after input pipe closing;
   const pid_t pid = waitpid(m_pid, &status, 0);
@@ -197,47 +249,91 @@ void ExecutorInterface::stopExecutor()
       logMsg(LOG_ERR, "waitpid() for executor process has returned -1 (error is \'%s\')", ERRNO_MSG);
       return;
     }
-  logMsg(LOG_DEBUG, "executor input pipe was closed and zombie was picked up (waitpid() status = %d)", status);
+  VM_LOG_DEBUG("executor input pipe was closed and zombie was picked up (waitpid() status = %d)", status);
 }
 
-bool ExecutorInterface::sendBlockToExecutor(const void* buf, size_t size, const std::string& descr)
+bool ExecutorInterface::flushCommands(const std::string& descr)
 {
   assert(m_pid != 0);
   assert(m_pipe != 0);
-  const ssize_t res = writeBuffer(m_pipe, buf, size);
-  if (res == -1)
+  if (m_commandBuffer.flush(m_pipe) == -1)
     {
       logMsg(LOG_ERR, "Error sending %s to executor, stopping it. It will be launched again at next text block (error was \'%s\')", descr.c_str(), ERRNO_MSG);
       stopExecutor();
       return 0;
     }
-  assert(res == (ssize_t)size);
+  if (!m_commandBuffer.isEmpty())
+    VM_LOG_DEBUG("Executor input pipe is full, %u bytes are buffered", m_commandBuffer.getSize());
   return 1;
 }
 
-void ExecutorInterface::processExecutorOutputLine(const std::string& line) const
+void ExecutorInterface::processExecutorOutputLine(const std::string& line)
 {
+  if (line.compare(0, 6, "trace ") == 0)
+    {
+      processTraceLine(line);
+      return;
+    }
+  if (line == "played")
+    {
+      if (daemonStats.executorQueueSize > 0)
+	daemonStats.executorQueueSize--;
+      return;
+    }
   if (trim(toLower(line)) == "silence")
     {
-      logMsg(LOG_DEBUG, "Received \'SILENCE\' notification from executor");
+      VM_LOG_DEBUG("Received \'SILENCE\' notification from executor");
+      daemonStats.executorQueueSize = 0;
       m_callback.onExecutorEvent(AbstractExecutorCallback::Silence);
       return;
     }
   if (trim(toLower(line)) == "stopped")
     {
-      logMsg(LOG_DEBUG, "Received \'STOPPED\' notification from executor");
+      VM_LOG_DEBUG("Received \'STOPPED\' notification from executor");
+      daemonStats.executorQueueSize = 0;
       m_callback.onExecutorEvent(AbstractExecutorCallback::Stopped);
       return;
     }
-  if (trim(toLower(line)) == "QueueLimit")
+  if (trim(toLower(line)) == "queuelimit")
     {
-      logMsg(LOG_DEBUG, "Received \'QUEUELIMIT\' notification from executor");
+      VM_LOG_DEBUG("Received \'QUEUELIMIT\' notification from executor");
+      daemonStats.queueLimitDrops++;
+      if (daemonStats.executorQueueSize > 0)
+	daemonStats.executorQueueSize--;
       m_callback.onExecutorEvent(AbstractExecutorCallback::QueueLimit);
       return;
     }
   logMsg(LOG_WARNING, "Received unexpected line from executor \'%s\'", line.c_str());
 }
 
+void ExecutorInterface::processTraceLine(const std::string& line)
+{
+  std::istringstream s(line);
+  std::string word, event;
+  size_t utterance = 0;
+  double stamp = 0;
+  if (!(s >> word >> utterance >> event >> stamp))
+    {
+      logMsg(LOG_WARNING, "Received invalid trace line from executor \'%s\'", line.c_str());
+      return;
+    }
+  const int stage = traceStageByEventName(event);
+  if (stage == TraceStageNone)
+    {
+      logMsg(LOG_WARNING, "Received trace line from executor with unknown event \'%s\'", event.c_str());
+      return;
+    }
+  UtteranceTraceMap::iterator it = m_traces.find(utterance);
+  if (it == m_traces.end())//stopped or too old;
+    return;
+  it->second.stamps[stage] = stamp;
+  if (stage != TraceStagePlayerExit)
+    return;
+  daemonStats.addTrace(it->second);
+  VM_LOG(LOG_INFO, "Utterance %u latency: %s", (unsigned)utterance, it->second.format().c_str());
+  m_traces.erase(it);
+}
+
 void ExecutorInterface::processExecutorErrorLine(const std::string& line) const
 {
   logMsg(LOG_ERR, "executor error:%s", line.c_str());
@@ -253,44 +349,73 @@ int ExecutorInterface::getExecutorStderrDescriptor() const
   return m_errorPipe[0];
 }
 
+int ExecutorInterface::getExecutorStdinDescriptor() const
+{
+  if (m_pid == 0 || m_pipe == 0)
+    return -1;
+  return m_pipe;
+}
+
+bool ExecutorInterface::hasExecutorStdinData() const
+{
+  return !m_commandBuffer.isEmpty();
+}
+
+void ExecutorInterface::writeExecutorStdinData()
+{
+  if (m_pid == 0 || m_pipe == 0)
+    return;
+  flushCommands("buffered commands");
+}
+
 void ExecutorInterface::readExecutorStdoutData()
 {
   char buf[2048];
-  const ssize_t res = ::read(m_outputPipe[0], buf, sizeof(buf));
-  if (res == -1)
+  while(1)
     {
-      logMsg(LOG_ERR, "Cannot read data from executor stdout stream (%s)", ERRNO_MSG);
-      return;
-    }
-  for(ssize_t i = 0;i < res;i++)
-    m_executorOutputChain += buf[i];
-  TextQueue<std::string> queue(m_executorOutputChain);
+      const ssize_t res = ::read(m_outputPipe[0], buf, sizeof(buf));
+      if (res == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno != EAGAIN && errno != EWOULDBLOCK)
+	    logMsg(LOG_ERR, "Cannot read data from executor stdout stream (%s)", ERRNO_MSG);
+	  break;
+	}
+      if (res == 0)
+	break;
+      m_executorOutput.append(buf, res);
+    } //while(1);
   std::string s;
-  while (queue.next(s))
+  while (m_executorOutput.next(s))
     {
-      logMsg(LOG_DEBUG, "Received line from executor: \'%s\'", s.c_str());
+      VM_LOG_DEBUG("Received line from executor: \'%s\'", s.c_str());
       processExecutorOutputLine(s);
     }
-  m_executorOutputChain = queue.chain();
 }
 
 void ExecutorInterface::readExecutorStderrData()
 {
   char buf[2048];
-  const ssize_t res = ::read(m_errorPipe[0], buf, sizeof(buf));
-  if (res == -1)
+  while(1)
     {
-      logMsg(LOG_ERR, "Cannot read data from executor stderr stream (%s)", ERRNO_MSG);
-      return;
-    }
-  for(ssize_t i = 0;i < res;i++)
-    m_executorErrorChain += buf[i];
-  TextQueue<std::string> queue(m_executorErrorChain);
+      const ssize_t res = ::read(m_errorPipe[0], buf, sizeof(buf));
+      if (res == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno != EAGAIN && errno != EWOULDBLOCK)
+	    logMsg(LOG_ERR, "Cannot read data from executor stderr stream (%s)", ERRNO_MSG);
+	  break;
+	}
+      if (res == 0)
+	break;
+      m_executorError.append(buf, res);
+    } //while(1);
   std::string s;
-  while (queue.next(s))
+  while (m_executorError.next(s))
     {
-      logMsg(LOG_DEBUG, "Received error line from executor: \'%s\'", s.c_str());
+      VM_LOG_DEBUG("Received error line from executor: \'%s\'", s.c_str());
       processExecutorErrorLine(s);
     }
-  m_executorErrorChain = queue.chain();
 }
@@ -18,6 +18,9 @@
 
 #include"OutputSet.h"
 #include"AbstractExecutorOutput.h"
+#include"ExecutorCommandBuffer.h"
+#include"UtteranceTrace.h"
+#include"DaemonStats.h"
 
 /**\brief The interface for executor event handlers
  *
@@ -53,7 +56,12 @@ public:
  * feedback info, like "silence" message, if there are no more items in
  * queue to speak, or notifications about queue size limit exceeds.  It
  * stored in separated executable file and can be changed via
- * configuration file parameter.
+ * configuration file parameter. Commands are written to executor through
+ * non-blocking pipe and buffered while executor does not read them, so
+ * busy executor never stalls the daemon main loop. If latency tracing
+ * is enabled, each text block gets an utterance ID and the executor
+ * reports the stages of its playback. The complete latency breakdown is
+ * logged when the playback is over.
  *
  * \sa AbstractExecutorCallback AbstractExecutorOutput
  */
@@ -67,8 +75,9 @@ public:
    * \param [in] maxQueueSize The maximum number of items in queue (0 - not limited)
    * \param executorName The file name of executor to run
    * \param [in] playerType Used player type (alsa, pulseaudio, pcspeaker)
+   * \param [in] origMask The signal mask the daemon had before blocking signals, it is restored in executor process
    */
-  ExecutorInterface(AbstractExecutorCallback& callback, const OutputSet& outputSet, size_t maxQueueSize, const std::string& executorName, PlayerType playerType);
+  ExecutorInterface(AbstractExecutorCallback& callback, const OutputSet& outputSet, size_t maxQueueSize, const std::string& executorName, PlayerType playerType, const sigset_t& origMask);
 
   /**\brief The destructor*/
   virtual ~ExecutorInterface();
@@ -80,13 +89,17 @@ public:
    * will be stored in queue otherwise.
    *
    * \param [in] textItem The text item to enqueue
+   * \param [in] trace The timestamps of the daemon stages the text item has passed
+   * \param [in] continuation Non-zero if the text item is the next chunk of the previous one, it is not checked against queue size limit
    */
-  void sayOrEnqueue(const TextItem& textItem);
+  void sayOrEnqueue(const TextItem& textItem, const UtteranceTrace& trace, bool continuation = 0);
 
   /**\brief Sends command to stop speech and clear queue
    *
    * This method sends "STOP" command to executor process. On receiving it
-   * executor must stop any playback and clear queue.
+   * executor must stop any playback and clear queue. Buffered "SAY" and
+   * "TONE" commands not yet written to executor are dropped, so "STOP"
+   * command overtakes them.
 */
   void stop();
 
@@ -116,7 +129,7 @@ public://AbstractExecutorOutput;
   /**\brief Returns the file descriptor of executor stdout stream
    *
    * This method returns file descriptor of executor stdout stream. This
-   * descriptor must be added to the main pselect() call to know when we
+   * descriptor must be added to the main epoll_wait() call to know when we
    * have data to read.
    *
    * \return The file descriptor of executor stdout stream
@@ -128,7 +141,7 @@ public://AbstractExecutorOutput;
   /**\brief Returns the file descriptor of executor stderr stream
    *
    * This method returns file descriptor of executor stderr stream. This
-   * descriptor must be added to the main pselect() call to know when we
+   * descriptor must be added to the main epoll_wait() call to know when we
    * have data to read.
    *
    * \return The file descriptor of executor stderr stream
@@ -141,8 +154,9 @@ public://AbstractExecutorOutput;
    *
    * This method notifies implementation to read accessible data from
    * executor output stream. This notification is sent by MainLoop class
-   * when it receives corresponding information from main pselect() system
-   * call.
+   * when it receives corresponding information from main epoll_wait() system
+   * call. The descriptor is registered in edge-triggered mode, so all
+   * accessible data must be read until read() reports EAGAIN.
    *
    * \sa AbstractExecutorOutput
    */
@@ -152,19 +166,52 @@ public://AbstractExecutorOutput;
    *
    * This method notifies implementation to read accessible data from
    * executor error stream. This notification is sent by MainLoop class
-   * when it receives corresponding information from main pselect() system
-   * call.
+   * when it receives corresponding information from main epoll_wait() system
+   * call. The descriptor is registered in edge-triggered mode, so all
+   * accessible data must be read until read() reports EAGAIN.
    *
    * \sa abstractExecutorOutput
    */
   void readExecutorStderrData();
 
+  /**\brief Returns the file descriptor of executor stdin stream
+   *
+   * This method returns file descriptor of the pipe used to send
+   * commands to executor. The descriptor is changed each time executor
+   * is relaunched.
+   *
+   * \return The file descriptor of executor stdin stream or -1 if executor is not running
+   *
+   * \sa AbstractExecutorOutput
+   */
+  int getExecutorStdinDescriptor() const;
+
+  /**\brief Checks if there are commands waiting to be sent to executor
+   *
+   * \return Non-zero if there is buffered data for executor or zero otherwise
+   *
+   * \sa AbstractExecutorOutput
+   */
+  bool hasExecutorStdinData() const;
+
+  /**\brief Notifies executor stdin stream is ready for writing
+   *
+   * This method writes buffered commands to executor input pipe until
+   * all of them are sent or the pipe is full again.
+   *
+   * \sa AbstractExecutorOutput
+   */
+  void writeExecutorStdinData();
+
 private:
-  void processExecutorOutputLine(const std::string& line) const;
+  typedef std::map<size_t, UtteranceTrace> UtteranceTraceMap;
+
+  void processExecutorOutputLine(const std::string& line);
+  void processTraceLine(const std::string& line);
   void processExecutorErrorLine(const std::string& line) const;
   void runExecutor();
   //The descr parameter is used only for proper logging output;
-  bool sendBlockToExecutor(const void* buf, size_t size, const std::string& descr);
+  bool flushCommands(const std::string& descr);
 
 private:
   AbstractExecutorCallback& m_callback;
@@ -172,10 +219,14 @@ private:
   const size_t m_maxQueueSize;
   const std::string m_executorName;
   const PlayerType m_playerType;
+  const sigset_t m_origMask;
   pid_t m_pid;
   int m_pipe;
   int m_outputPipe[2], m_errorPipe[2];
-  std::string m_executorOutputChain, m_executorErrorChain;
+  LineReader m_executorOutput, m_executorError;
+  ExecutorCommandBuffer m_commandBuffer;
+  size_t m_lastUtterance;
+  UtteranceTraceMap m_traces;
 }; //class ExecutorInterface;
 
 #endif //__VOICEMAN_EXECUTOR_INTERFACE_H__;
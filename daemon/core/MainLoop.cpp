@@ -15,122 +15,259 @@
 
 #include"voiceman.h"
 #include"MainLoop.h"
+#include"DaemonStats.h"
+#include"SessionCapture.h"
+
+#define MAX_EPOLL_EVENTS 64
+#define CLIENT_READ_BLOCK_SIZE 4096
+#define MAX_CLIENT_OUTPUT_SIZE 65536
 
 void MainLoop::run(const SocketList& sockets, sigset_t* sigMask)
 {
   assert(sigMask != NULL);
+  sigset_t blockedMask, watchedMask;
+  sigemptyset(&watchedMask);
+  VM_SYS(sigprocmask(SIG_BLOCK, NULL, &blockedMask) == 0, "sigprocmask()");
+  for(int i = 1;i < NSIG;i++)
+    if (sigismember(&blockedMask, i) == 1 && sigismember(sigMask, i) != 1)
+      sigaddset(&watchedMask, i);
+  m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+  VM_SYS(m_epollFd != -1, "epoll_create1()");
+  m_signalFd = signalfd(-1, &watchedMask, SFD_NONBLOCK | SFD_CLOEXEC);
+  VM_SYS(m_signalFd != -1, "signalfd()");
+  registerDescriptor(m_signalFd);
+  std::set<int> listeningFds;
+  for(SocketList::const_iterator socketIt = sockets.begin();socketIt != sockets.end();socketIt++)
+    {
+      const int fd = (*socketIt)->getHandler();
+      VM_SYS(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != -1, "fcntl()");
+      registerDescriptor(fd);
+      listeningFds.insert(fd);
+    }
+  const int executorStdout = m_executorOutput.getExecutorStdoutDescriptor();
+  const int executorStderr = m_executorOutput.getExecutorStderrDescriptor();
+  registerDescriptor(executorStdout);
+  registerDescriptor(executorStderr);
+  for(ClientList::iterator clientIt = m_connectedClients.begin();clientIt != m_connectedClients.end();clientIt++)
+    {
+      const int fd = (*clientIt)->socket->getHandler();
+      VM_SYS(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != -1, "fcntl()");
+      registerDescriptor(fd, 1);
+      m_clientsByFd.insert(FdToClientMap::value_type(fd, *clientIt));
+    }
+  struct epoll_event events[MAX_EPOLL_EVENTS];
   while(!m_terminationFlag)
     {
-      fd_set fds;
-      SocketList::const_iterator socketIt;
-      ClientList::iterator clientIt;
-      int maxFd = 0;
-      FD_ZERO(&fds);
-      for(socketIt = sockets.begin();socketIt != sockets.end();socketIt++)
-	{
-	  const int fd=(*socketIt)->getHandler();
-	  if (fd > maxFd)
-	    maxFd = fd;
-	  FD_SET(fd, &fds);
-	} //for (sockets);
-      for(clientIt = m_connectedClients.begin();clientIt != m_connectedClients.end();clientIt++)
-	{
-	  const int fd=(*clientIt)->socket->getHandler();
-	  if (fd > maxFd)
-	    maxFd = fd;
-	  FD_SET(fd, &fds);
-	} //for (clients);
-      const int executorStdout = m_executorOutput.getExecutorStdoutDescriptor();
-      const int executorStderr = m_executorOutput.getExecutorStderrDescriptor();
-      FD_SET(executorStdout, &fds);
-      FD_SET(executorStderr, &fds);
-      if (maxFd < executorStdout)
-	maxFd = executorStdout;
-      if (maxFd < executorStderr)
-	maxFd = executorStderr;
-      if (pselect(maxFd + 1, &fds, NULL, NULL, NULL, sigMask) == -1)
+      watchExecutorStdin();
+      const int count = epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, -1);
+      if (count == -1)
 	{
 	  const int errorCode = errno;
-	  logMsg(LOG_DEBUG, "pselect() has returned -1, checking what the reason...");
+	  VM_LOG_DEBUG("epoll_wait() has returned -1, checking what the reason...");
 	  if (errorCode == EINTR)
 	    {
-	      logMsg(LOG_DEBUG, "pselect() call was interrupted by system signal, going to next iteration...");
+	      VM_LOG_DEBUG("epoll_wait() call was interrupted by system signal, going to next iteration...");
 	      m_signalHandler.onSystemSignal();
 	      continue;
 	    } //EINTR;
-	  logMsg(LOG_DEBUG, "pselect() has returned an unexpected error, stopping main loop... ");
-	  throw SystemException(errorCode, "pselect()");
-	} //select has returned an error;
-      if (FD_ISSET(executorStdout, &fds))
-	{
-	  logMsg(LOG_DEBUG, "New data available on executor stdout stream");
-	  m_executorOutput.readExecutorStdoutData();
-	  continue;
-	}
-      if (FD_ISSET(executorStderr, &fds))
+	  VM_LOG_DEBUG("epoll_wait() has returned an unexpected error, stopping main loop... ");
+	  throw SystemException(errorCode, "epoll_wait()");
+	} //epoll_wait() has returned an error;
+      //All ready descriptors are handled in one pass, the edge-triggered mode requires reading each of them until EAGAIN;
+      for(int i = 0;i < count;i++)
 	{
-	  logMsg(LOG_DEBUG, "New data available on executor stderr stream");
-	  m_executorOutput.readExecutorStderrData();
-	  continue;
-	}
-      bool wasNewClients = 0;
-      for(socketIt = sockets.begin();socketIt != sockets.end();socketIt++)
-	{
-	  const int fd = (*socketIt)->getHandler();
-	  if (!FD_ISSET(fd, &fds))
-	    continue;
-	  //OK:we found new connected client;
-	  logMsg(LOG_DEBUG, "New connection registered");
-	  wasNewClients=1;
-	  const int newClientFd = ::accept(fd, NULL, NULL);
-	  if (newClientFd == -1)
+	  const int fd = events[i].data.fd;
+	  if (fd == m_signalFd)
 	    {
-	      logMsg(LOG_ERR, "New client cannot be accepted, accept() says \'%s\'", ERRNO_MSG);
+	      readSignals();
 	      continue;
 	    }
-	  logMsg(LOG_DEBUG, "New client connection was established (fd=%d)", newClientFd);
-	  auto_ptr<Socket> newSocket(new Socket(newClientFd));
-	  if (m_maxClients > 0 && m_connectedClients.size() >= m_maxClients)
+	  if (fd == executorStdout)
 	    {
-	      newSocket->close();
-	      logMsg(LOG_WARNING, "Client count limit reached, closing new connection (already have %u clients)", m_connectedClients.size());
-	    } else//adding new record to the connected clients list;
+	      VM_LOG_DEBUG("New data available on executor stdout stream");
+	      m_executorOutput.readExecutorStdoutData();
+	      continue;
+	    }
+	  if (fd == executorStderr)
 	    {
-	      auto_ptr<Client> newClient = m_clientFactory.createNewClient(newSocket);
-	      m_connectedClients.push_back(newClient.get());
-	      newClient.release();
-	      logMsg(LOG_INFO, "New connection was successfully accepted and added to the list of connected clients (fd=%d)", newClientFd);
+	      VM_LOG_DEBUG("New data available on executor stderr stream");
+	      m_executorOutput.readExecutorStderrData();
+	      continue;
 	    }
-	} //new clients handling;
-      if (wasNewClients)
-	continue;//resetting set of file descriptors with new sockets;
-      //now checking list of clients, is there any data from them;
-      for(clientIt = m_connectedClients.begin();clientIt != m_connectedClients.end();clientIt++)
-	{
-	  int fd = (*clientIt)->socket->getHandler();
-	  if (!FD_ISSET(fd, &fds))
-	    continue;
-	  std::string data;
-	  bool toClose=0;
-	  ssize_t readBytes = (*clientIt)->socket->read(data);
-	  if (readBytes > 0)
-	    logMsg(LOG_DEBUG, "Read %u bytes from client (fd=%d)", data.length(), fd);
-	  if (readBytes <= 0)//if connection closed or there was reading problem;
-	    toClose = 1;
-	  if (readBytes < 0)//there was reading problem;
-	    logMsg(LOG_ERR, "Problem reading data from client, connection will be closed (read(fd=%d) returned %s)", fd, ERRNO_MSG);
-	  if (toClose)
+	  if (fd == m_executorOutput.getExecutorStdinDescriptor())
+	    {
+	      VM_LOG_DEBUG("Executor stdin stream is ready to accept more data");
+	      m_executorOutput.writeExecutorStdinData();
+	      continue;
+	    }
+	  if (listeningFds.find(fd) != listeningFds.end())
 	    {
-	      (*clientIt)->socket->close();
-	      delete *clientIt;
-	      m_connectedClients.erase(clientIt);
-	      logMsg(LOG_INFO, "Client was closed and its data destroyed (fd=%d)", fd);
-	      break;//do not handle other clients;
-	    } // closing connection;
-	  m_clientDataHandler.processClientData(**clientIt, data);
-	} // for (clients);
+	      acceptNewClients(fd);
+	      continue;
+	    }
+	  FdToClientMap::iterator it = m_clientsByFd.find(fd);
+	  if (it == m_clientsByFd.end())//client was closed earlier in this pass;
+	    continue;
+	  if (!readClientData(*it->second) || !writeClientData(*it->second))
+	    closeClient(fd);
+	} //for(events);
     } // while(!m_terminationFlag);
+  close(m_signalFd);
+  m_signalFd = -1;
+  close(m_epollFd);
+  m_epollFd = -1;
+  m_clientsByFd.clear();
   for(ClientList::iterator it = m_connectedClients.begin();it != m_connectedClients.end();it++)
     delete *it;
   m_connectedClients.clear();
 }
+
+void MainLoop::registerDescriptor(int fd, bool watchOutput)
+{
+  assert(m_epollFd != -1);
+  struct epoll_event event;
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = EPOLLIN | EPOLLET;
+  if (watchOutput)
+    event.events |= EPOLLOUT;
+  event.data.fd = fd;
+  VM_SYS(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) == 0, "epoll_ctl(EPOLL_CTL_ADD)");
+}
+
+void MainLoop::watchExecutorStdin()
+{
+  assert(m_epollFd != -1);
+  if (!m_executorOutput.hasExecutorStdinData())
+    return;
+  const int fd = m_executorOutput.getExecutorStdinDescriptor();
+  if (fd == -1)
+    return;
+  //One-shot registration is armed again on each iteration while data is buffered, the pipe is closed and removed from epoll set automatically on executor relaunch;
+  struct epoll_event event;
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = EPOLLOUT | EPOLLONESHOT;
+  event.data.fd = fd;
+  if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event) == 0)
+    return;
+  VM_SYS(errno == ENOENT, "epoll_ctl(EPOLL_CTL_MOD)");
+  VM_SYS(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) == 0, "epoll_ctl(EPOLL_CTL_ADD)");
+}
+
+void MainLoop::acceptNewClients(int fd)
+{
+  while(1)
+    {
+      const int newClientFd = ::accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (newClientFd == -1)
+	{
+	  if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    return;
+	  if (errno == EINTR || errno == ECONNABORTED)
+	    continue;
+	  logMsg(LOG_ERR, "New client cannot be accepted, accept() says \'%s\'", ERRNO_MSG);
+	  return;
+	}
+      VM_LOG_DEBUG("New client connection was established (fd=%d)", newClientFd);
+      auto_ptr<Socket> newSocket(new Socket(newClientFd));
+      if (m_maxClients > 0 && m_connectedClients.size() >= m_maxClients)
+	{
+	  newSocket->close();
+	  logMsg(LOG_WARNING, "Client count limit reached, closing new connection (already have %u clients)", m_connectedClients.size());
+	  continue;
+	}
+      registerDescriptor(newClientFd, 1);
+      auto_ptr<Client> newClient = m_clientFactory.createNewClient(newSocket);
+      m_connectedClients.push_back(newClient.get());
+      newClient->id = ++daemonStats.acceptedClients;
+      m_clientsByFd[newClientFd] = newClient.release();
+      daemonStats.connectedClients++;
+      logMsg(LOG_INFO, "New connection was successfully accepted and added to the list of connected clients (fd=%d)", newClientFd);
+    } //while(1);
+}
+
+bool MainLoop::readClientData(Client& client)
+{
+  const int fd = client.socket->getHandler();
+  while(1)
+    {
+      char* buf = client.input.reserve(CLIENT_READ_BLOCK_SIZE);
+      const ssize_t readBytes = client.socket->read(buf, CLIENT_READ_BLOCK_SIZE);
+      client.input.commit(readBytes > 0?(size_t)readBytes:0);
+      if (readBytes == 0)//connection closed;
+	return 0;
+      if (readBytes < 0)
+	{
+	  if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    return 1;
+	  if (errno == EINTR)
+	    continue;
+	  logMsg(LOG_ERR, "Problem reading data from client, connection will be closed (read(fd=%d) returned %s)", fd, ERRNO_MSG);
+	  return 0;
+	}
+      VM_LOG_DEBUG("Read %u bytes from client (fd=%d)", (size_t)readBytes, fd);
+      client.trace.mark(TraceStageRead);
+      daemonStats.receivedBytes += (size_t)readBytes;
+      m_clientDataHandler.processClientData(client);
+    } //while(1);
+}
+
+bool MainLoop::writeClientData(Client& client)
+{
+  const int fd = client.socket->getHandler();
+  while(!client.output.empty())
+    {
+      const ssize_t writtenBytes = client.socket->write(client.output.c_str(), client.output.length());
+      if (writtenBytes < 0)
+	{
+	  if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    break;
+	  if (errno == EINTR)
+	    continue;
+	  logMsg(LOG_ERR, "Problem writing data to client, connection will be closed (write(fd=%d) returned %s)", fd, ERRNO_MSG);
+	  return 0;
+	}
+      VM_LOG_DEBUG("Written %u bytes to client (fd=%d)", (size_t)writtenBytes, fd);
+      client.output.erase(0, (size_t)writtenBytes);
+    } //while();
+  //The rest is written when the socket becomes writable, but the client not reading its socket at all must not make buffer grow forever;
+  if (client.output.length() > MAX_CLIENT_OUTPUT_SIZE)
+    {
+      logMsg(LOG_WARNING, "Client does not read replies, connection will be closed (fd=%d, %u bytes pending)", fd, client.output.length());
+      return 0;
+    }
+  return 1;
+}
+
+void MainLoop::readSignals()
+{
+  bool wasSignals = 0;
+  struct signalfd_siginfo info;
+  while(::read(m_signalFd, &info, sizeof(struct signalfd_siginfo)) == sizeof(struct signalfd_siginfo))
+    {
+      VM_LOG_DEBUG("Signal %u was received through signalfd()", info.ssi_signo);
+      //Calling handler installed with sigaction() to let it register which signal was caught;
+      struct sigaction sa;
+      if (sigaction(info.ssi_signo, NULL, &sa) == 0 &&
+	  !(sa.sa_flags & SA_SIGINFO) &&
+	  sa.sa_handler != SIG_DFL && sa.sa_handler != SIG_IGN)
+	sa.sa_handler(info.ssi_signo);
+      wasSignals = 1;
+    }
+  if (wasSignals)
+    m_signalHandler.onSystemSignal();
+}
+
+void MainLoop::closeClient(int fd)
+{
+  FdToClientMap::iterator it = m_clientsByFd.find(fd);
+  assert(it != m_clientsByFd.end());
+  Client* client = it->second;
+  m_clientsByFd.erase(it);
+  //Closing of the descriptor removes it from epoll set automatically;
+  client->socket->close();
+  m_connectedClients.remove(client);
+  sessionCapture.writeClose(client->id);
+  delete client;
+  daemonStats.connectedClients--;
+  logMsg(LOG_INFO, "Client was closed and its data destroyed (fd=%d)", fd);
+}
@@ -21,8 +21,8 @@
 
 /**\brief The abstract interface for system signal processing classes
  *
- * This class declares method being called in cases when pselect() system
- * call is interrupted by system signal. Usual signal handlers must
+ * This class declares method being called in cases when the main loop
+ * has received system signal. Usual signal handlers must
  * contain only registration which signal was caught but real signal
  * processing must be implemented in the derived classes of this one. 
  *
@@ -36,9 +36,10 @@ public:
 
   /**\brief Notifies there was system signal and it must be handled
    *
-   * This method is called by main loop class each time when pselect()
-   * system call is interrupted with EINTR exit code. It means the process
-   * have received system signal and it must be handled.
+   * This method is called by main loop class each time when signals
+   * were read from its signalfd() descriptor or epoll_wait() system call
+   * was interrupted with EINTR exit code. It means the process have
+   * received system signal and it must be handled.
    */
   virtual void onSystemSignal() = 0;
 }; //class AbstractSignalHandler;
@@ -46,9 +47,9 @@ public:
 /**\brief The abstract class to handle client data
  *
  * This class declares an interface for objects to process data received
- * from clients. The data sent through this interface is not prepared and
- * is not checked. It is provided from MainLoop class. The strings even
- * must not be bounded to line ends.
+ * from clients. The data is read by MainLoop class directly into the
+ * input buffer of the client object and is not prepared and is not
+ * checked. It even must not be bounded to line ends.
  *
  * \sa MainLoop ClientDataHandler
  */
@@ -58,21 +59,26 @@ public:
   /**\brief Callback method to notify new data was received
    *
    * This method notifies there is new data received from client and it must
-   * be handled. The provided string is the raw data block, it can be not
-   * bounded to line end, so handler must wait next one until it will be
-   * sure the complete string is received.
+   * be handled. The data is appended to the input buffer of the client
+   * object, it can be not bounded to line end, so handler must leave the
+   * incomplete line in the buffer until it is completed by next data.
    *
    * \param [in] client The client object data was received from
-   * \param [in] data The received data
    */
-  virtual void processClientData(Client& client, const std::string& data) = 0;
+  virtual void processClientData(Client& client) = 0;
 }; //class AbstractClientDataHandler;
 
 /**\brief Main class to manage client connections
  *
  * This class manages clients connections and handles any data received
- * from clients. It contains main pselect() system call to wait new data
- * or new connections. This class uses list of currently accepted clients
+ * from clients. It contains main epoll_wait() system call to wait new data
+ * or new connections. All descriptors are registered in edge-triggered
+ * mode, so every ready descriptor is handled in one pass and read until
+ * EAGAIN. Signals blocked by the caller are received through signalfd()
+ * descriptor. The executor input pipe is watched for writability only
+ * while there are commands buffered for it. The data queued in the
+ * output buffer of a client is written after each read of its data and
+ * each time its socket becomes writable again. This class uses list of currently accepted clients
  * but all clients must be closed explicitly on this classs destruction. It is not
  * recommended to have two instances of this class because of behavior
  * may depend on process signal handling. Also this class handles system signal checking 
@@ -94,11 +100,15 @@ public:
    * \param [in] terminationFlag The reference to termination flag variable
    */
   MainLoop(const ClientFactory& clientFactory, ClientList& clients, size_t maxClients, AbstractClientDataHandler& clientDataHandler, AbstractSignalHandler& signalHandler, AbstractExecutorOutput& executorOutput, bool& terminationFlag)
-    : m_clientFactory(clientFactory), m_connectedClients(clients), m_maxClients(maxClients), m_clientDataHandler(clientDataHandler), m_signalHandler(signalHandler), m_executorOutput(executorOutput), m_terminationFlag(terminationFlag) {}
+    : m_clientFactory(clientFactory), m_connectedClients(clients), m_maxClients(maxClients), m_clientDataHandler(clientDataHandler), m_signalHandler(signalHandler), m_executorOutput(executorOutput), m_terminationFlag(terminationFlag), m_epollFd(-1), m_signalFd(-1) {}
 
   /**\brief The main method to execute loop and handle data
    *
-   * Use this method to launch main loop and start client accepting.
+   * Use this method to launch main loop and start client accepting. The
+   * signals blocked in the current process mask but not blocked in
+   * sigMask are read through signalfd() descriptor and their handlers
+   * installed with sigaction() are called before onSystemSignal()
+   * notification.
    *
    * \param [in] sockets The list of sockets objects to listen
    * \param [in] sigMask The sigmal mask to operate with
@@ -106,6 +116,17 @@ public:
   void run(const SocketList& sockets, sigset_t* sigMask);
 
 private:
+  void registerDescriptor(int fd, bool watchOutput = 0);
+  void watchExecutorStdin();
+  void acceptNewClients(int fd);
+  bool readClientData(Client& client);
+  bool writeClientData(Client& client);
+  void readSignals();
+  void closeClient(int fd);
+
+private:
+  typedef std::map<int, Client*> FdToClientMap;
+
   const ClientFactory& m_clientFactory;
   ClientList& m_connectedClients;
   const size_t m_maxClients;
@@ -113,6 +134,9 @@ private:
   AbstractSignalHandler& m_signalHandler;
   AbstractExecutorOutput& m_executorOutput;
   bool& m_terminationFlag;
+  int m_epollFd;
+  int m_signalFd;
+  FdToClientMap m_clientsByFd;
 }; //class MainLoop;
 
 #endif //__VOICEMAN_MAIN_LOOP_H__
@@ -36,15 +36,81 @@ std::string Output::preparePcspeakerPlayerCommand(const TextItem& textItem)const
   return prepareCommandLine(m_pcspeakerPlayerCommand, textItem);
 }
 
+std::string Output::prepareLibaoPlayerCommand() const
+{
+  std::ostringstream s;
+  s << m_sampleRate << " " << m_channels << " " << m_sampleFormat;
+  return s.str();
+}
+
 std::string Output::prepareText(const TextItem& textItem) const
 {
   std::wstring text = makeCaps(textItem);
-  text = insertReplacements(text);
-  std::string s = encodeUTF8(text);
+  text = m_replacements.insertReplacements(text);
+  std::string s;
+  encodeUTF8(text, s);
   s += '\n';
   return s;
 }
 
+void Output::splitToChunks(const TextItem& textItem, TextItemList& chunks) const
+{
+  const std::wstring text = textItem.getText();
+  if (m_maxChunkLength == 0 || text.length() <= m_minChunkLength)
+    {
+      chunks.push_back(textItem);
+      return;
+    }
+  std::wstring::size_type pos = 0;
+  while(pos < text.length())
+    {
+      const std::wstring::size_type end = findChunkEnd(text, pos);
+      TextItem chunk(textItem);
+      chunk.setText(text.substr(pos, end - pos));
+      for(std::wstring::size_type i = pos;i < end;i++)
+	if (textItem.isMarked(i))
+	  chunk.mark(i - pos);
+      chunks.push_back(chunk);
+      pos = end;
+      while(pos < text.length() && BLANK_CHAR(text[pos]))
+	pos++;
+    } //while();
+}
+
+static bool isSentenceEnd(wchar_t c)
+{
+  return c == '.' || c == '!' || c == '?' || c == 0x2026;
+}
+
+static bool isClauseEnd(wchar_t c)
+{
+  return c == ',' || c == ';' || c == ':';
+}
+
+size_t Output::findChunkEnd(const std::wstring& text, size_t pos) const
+{
+  assert(m_maxChunkLength > 0);
+  const std::wstring::size_type limit = text.length() - pos > m_maxChunkLength?pos + m_maxChunkLength:text.length();
+  std::wstring::size_type clauseEnd = 0, space = 0;
+  for(std::wstring::size_type i = pos + 1;i <= limit;i++)
+    {
+      //The chunk can be ended after i - 1 character;
+      const bool delimited = i == text.length() || BLANK_CHAR(text[i]);
+      if (!delimited)
+	continue;
+      if (isSentenceEnd(text[i - 1]) && i - pos >= m_minChunkLength)
+	return i;
+      if (isClauseEnd(text[i - 1]))
+	clauseEnd = i;
+      space = i;
+    } //for();
+  if (limit == text.length())
+    return limit;
+  if (clauseEnd != 0)
+    return clauseEnd;
+  return space != 0?space:limit;
+}
+
 void Output::addCapMapItem(wchar_t c, const std::wstring& value)
 {
   m_capList.insert(WCharToWStringMap::value_type(c, value));
@@ -52,26 +118,17 @@ void Output::addCapMapItem(wchar_t c, const std::wstring& value)
 
 void Output::setPitchFormat(size_t digits, double min, double aver, double max)
 {
-  m_pitchFormat.digits = digits;
-  m_pitchFormat.min = min;
-  m_pitchFormat.aver = aver;
-  m_pitchFormat.max = max;
+  prepareParamValues(digits, min, aver, max, m_pitchValues);
 }
 
 void Output::setRateFormat(size_t digits, double min, double aver, double max)
 {
-  m_rateFormat.digits = digits;
-  m_rateFormat.min = min;
-  m_rateFormat.aver = aver;
-  m_rateFormat.max = max;
+  prepareParamValues(digits, min, aver, max, m_rateValues);
 }
 
 void Output::setVolumeFormat(size_t digits, double min, double aver, double max)
 {
-  m_volumeFormat.digits = digits;
-  m_volumeFormat.min = min;
-  m_volumeFormat.aver = aver;
-  m_volumeFormat.max = max;
+  prepareParamValues(digits, min, aver, max, m_volumeValues);
 }
 
 std::wstring Output::makeCaps(const TextItem& textItem) const
@@ -97,106 +154,74 @@ std::wstring Output::makeCaps(const TextItem& textItem) const
   return trim(text);
 }
 
-std::string Output::prepareCommandLine(const std::string& pattern, const TextItem& textItem) const
+std::string Output::prepareCommandLine(const CommandTemplate& commandTemplate, const TextItem& textItem) const
 {
-  std::string volumeStr, pitchStr, rateStr;
-  volumeStr = prepareFloatValue(textItem.getVolume(), m_volumeFormat);
-  pitchStr = prepareFloatValue(textItem.getPitch(), m_pitchFormat);
-  rateStr = prepareFloatValue(textItem.getRate(), m_rateFormat);
+  assert(m_volumeValues.size() == 101 && m_pitchValues.size() == 101 && m_rateValues.size() == 101);
+  const size_t volume = textItem.getVolume().getValue(), pitch = textItem.getPitch().getValue(), rate = textItem.getRate().getValue();
   std::string s;
+  for(CommandTemplate::size_type i = 0;i < commandTemplate.size();i++)
+    {
+      const CommandSegment& segment = commandTemplate[i];
+      switch(segment.kind)
+	{
+	case SegmentVolume:
+	  s += m_volumeValues[volume <= 100?volume:100];
+	  break;
+	case SegmentPitch:
+	  s += m_pitchValues[pitch <= 100?pitch:100];
+	  break;
+	case SegmentRate:
+	  s += m_rateValues[rate <= 100?rate:100];
+	  break;
+	default:
+	  s += segment.text;
+	} //switch();
+    } //for();
+  return s;
+}
+
+void Output::compileCommandLine(const std::string& pattern, CommandTemplate& commandTemplate)
+{
+  commandTemplate.clear();
+  std::string text;
   for(std::string::size_type i = 0;i < pattern.length();i++)
     {
       if (pattern[i] != '%' || i+1 >= pattern.length())
 	{
-	  s += pattern[i];
+	  text += pattern[i];
 	  continue;
 	}
       i++;
+      int kind;
       switch(pattern[i])
 	{
 	case 'v':
-	  s += volumeStr;
+	  kind = SegmentVolume;
 	  break;
 	case 'p':
-	  s += pitchStr;
+	  kind = SegmentPitch;
 	  break;
 	case 'r':
-	  s += rateStr;
+	  kind = SegmentRate;
 	  break;
 	default:
-	  s += '%';
-	  s += pattern[i];
+	  text += '%';
+	  text += pattern[i];
+	  continue;
 	} //switch();
+      if (!text.empty())
+	commandTemplate.push_back(CommandSegment(SegmentText, text));
+      text.erase();
+      commandTemplate.push_back(CommandSegment(kind, std::string()));
     } //for();
-  return s;
+  if (!text.empty())
+    commandTemplate.push_back(CommandSegment(SegmentText, text));
 }
 
-std::string Output::prepareFloatValue(TextParam value, const FloatValueFormat& format) const
+void Output::prepareParamValues(size_t digits, double min, double aver, double max, ParamValueVector& values)
 {
-  assert(format.digits >= 0 && format.digits <= 10);
-  double floatValue = value.getValue(format.min, format.aver, format.max);
-  return makeStringFromDouble<std::string>(floatValue, format.digits);
-}
-
-bool Output::findReplacement(const std::wstring& str, std::wstring::size_type pos, OutputReplacementVector::size_type& result) const
-{
-  //Case sensitive search;
-  for(OutputReplacementVector::size_type i = 0;i < m_replacements.size();i++)
-    {
-      if (str.length() - pos < m_replacements[i].oldValue.length())
-	continue;
-      std::wstring::size_type j;
-      for(j = 0;j < m_replacements[i].oldValue.length();j++)
-	if (str[pos + j] != m_replacements[i].oldValue[j])
-	    break;
-      if (j == m_replacements[i].oldValue.length())
-	{
-	  result = i;
-	  return 1;
-	}
-    } //for(replacements);
-  if (m_lang == NULL)
-    return 0;
-  //Case insensitive search;
-  for(OutputReplacementVector::size_type i = 0;i < m_replacements.size();i++)
-    {
-      if (str.length() - pos < m_replacements[i].oldValue.length())
-	continue;
-      std::wstring::size_type j;
-      for(j = 0;j < m_replacements[i].oldValue.length();j++)
-	if (!m_lang->equalChars(str[pos + j], m_replacements[i].oldValue[j]))
-	    break;
-      if (j == m_replacements[i].oldValue.length())
-	{
-	  result = i;
-	  return 1;
-	}
-    } //for(replacements);
-  return 0;
-}
-
-std::wstring Output::insertReplacements(const std::wstring& str) const
-{
-  std::wstring newStr;
-  for(std::wstring::size_type i = 0;i < str.length();i++)
-    {
-      OutputReplacementVector::size_type k;
-      if (findReplacement(str, i, k))
-	{
-	  assert(k < m_replacements.size());
-	  const std::wstring& newValue = m_replacements[k].newValue;
-	  if (newValue.length() > 1)
-	    {
-	      if (BLANK_CHAR(newValue[0]))
-		attachSpace(newStr);
-	      newStr += trim(newValue);
-	      if (BLANK_CHAR(newValue[newValue.length() - 1]))
-		attachSpace(newStr);
-	    } else 
-	    newStr += newValue;
-	  i += m_replacements[k].oldValue.length()-1;
-	} else
-	attachCharWithoutDoubleSpaces(newStr, str[i]);
-    }
-  return newStr;
+  assert(digits >= 0 && digits <= 10);
+  values.resize(101);
+  for(size_t i = 0;i <= 100;i++)
+    values[i] = makeStringFromDouble<std::string>(TextParam(i).getValue(min, aver, max), digits);
 }
@@ -18,38 +18,7 @@
 
 #include"TextItem.h"
 #include"Lang.h"
-
-/**\brief A replacement item, associated with some output
- *
- * Each output can have set of replacements associated with it to fix
- * some text pronounciation. These replacements must not be confused with
- * replacements used for language-specific operations in TextProcessor
- * class.
- *
- * \sa Output
- */
-struct OutputReplacement 
-{
-  /**\brief The default constructor*/
-  OutputReplacement() {}
-
-  /**\brief The constructor
-   *
-   * \param [in] oldstring The string to replace
-   * \param [in] newstring The string to replace with
-   */
-  OutputReplacement(const std::wstring& oldString, const std::wstring& newString)
-    : oldValue(oldString), newValue(newString) {}
-
-  /**\brief The string to replace*/
-  std::wstring oldValue;
-
-  /**\brief The string to replace with*/
-  std::wstring newValue;
-}; //struct OutputReplacement;
-
-typedef std::vector<OutputReplacement> OutputReplacementVector;
-typedef std::list<OutputReplacement> OutputReplacementList;
+#include"ReplacementMatcher.h"
 
 /**\brief The class with complete information about valid and ready to use output
  *
@@ -70,7 +39,12 @@ class Output
 public:
   /**\brief The constructor*/
   Output()
-    : m_langId(LANG_ID_NONE), m_lang(NULL) {}
+    : m_langId(LANG_ID_NONE), m_lang(NULL), m_persistent(0), m_minChunkLength(0), m_maxChunkLength(0), m_sampleRate(22050), m_channels(1), m_sampleFormat("s16le")
+  {
+    prepareParamValues(2, 0, 0.5, 1, m_pitchValues);
+    prepareParamValues(2, 0, 0.5, 1, m_rateValues);
+    prepareParamValues(2, 0, 0.5, 1, m_volumeValues);
+  }
 
   /**\brief The destructor*/
   virtual ~Output() {}
@@ -125,6 +99,7 @@ public:
   void setLang(const Lang* lang)
   {
     m_lang = lang;
+    m_replacements.setLang(lang);
   }
 
   /**\brief Returns the name of this output
@@ -171,6 +146,61 @@ public:
     m_family = family;
   }
 
+  /**\brief Checks if this output uses long-lived synthesizer and player processes
+   *
+   * Persistent output synthesizer and player are launched by executor
+   * once and are reused for all text items with equal command lines.
+   * Synthesizer of such output must answer with framed audio data as it
+   * is described in executorCommandHeader.h.
+   *
+   * \return Non-zero if this output is persistent
+   */
+  bool isPersistent() const
+  {
+    return m_persistent;
+  }
+
+  /**\brief Sets the flag of long-lived synthesizer and player processes usage
+   *
+   * \param [in] persistent Non-zero if this output must be persistent
+   */
+  void setPersistent(bool persistent)
+  {
+    m_persistent = persistent;
+  }
+
+  /**\brief Sets the limits of text chunks sent to synthesizer separately
+   *
+   * Long text items are split into chunks at sentence ends, so the first
+   * sentence is played while the next ones are synthesized. A chunk is
+   * ended by the first sentence end after minLength characters. If there
+   * is no such place within maxLength characters, the chunk is cut after
+   * the last clause delimiter, at the last space or just at maxLength
+   * characters.
+   *
+   * \param [in] minLength The minimal length of chunk ended by sentence end
+   * \param [in] maxLength The maximum length of chunk, zero disables splitting
+   */
+  void setChunkLength(size_t minLength, size_t maxLength)
+  {
+    assert(maxLength == 0 || minLength <= maxLength);
+    m_minChunkLength = minLength;
+    m_maxChunkLength = maxLength;
+  }
+
+  /**\brief Splits text item into chunks to be synthesized separately
+   *
+   * All attributes of the text item and marks of its letters are kept
+   * in the chunks. If splitting is disabled or the text is short enough
+   * the item is added to the list as is.
+   *
+   * \param [in] textItem The text item to split
+   * \param [out] chunks The list to add chunks to
+   *
+   * \sa setChunkLength()
+   */
+  void splitToChunks(const TextItem& textItem, TextItemList& chunks) const;
+
   /**\brief Generates the command line to execute speech synthesizer 
    *
    * This method can generate command line to execute speech 
@@ -216,6 +246,33 @@ public:
    */
   std::string preparePcspeakerPlayerCommand(const TextItem& textItem)const;
 
+  /**\brief Generates audio format description for libao player
+   *
+   * If libao player is used the executor plays synthesizer output by
+   * itself. This method generates the string sent to executor instead of
+   * player command line. It contains sample rate, number of channels and
+   * sample format delimited by spaces.
+   *
+   * \return The audio format description
+   */
+  std::string prepareLibaoPlayerCommand() const;
+
+  /**\brief Sets the format of audio data produced by speech synthesizer
+   *
+   * This format is used only with libao player, the executor reads raw
+   * audio data from synthesizer output and plays it by itself.
+   *
+   * \param [in] sampleRate The number of samples per second
+   * \param [in] channels The number of channels
+   * \param [in] sampleFormat The sample format, can be "s8", "u8", "s16le" or "s16be"
+   */
+  void setAudioFormat(size_t sampleRate, size_t channels, const std::string& sampleFormat)
+  {
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    m_sampleFormat = sampleFormat;
+  }
+
   /**\brief Prepares text to send to speech synthesizer
    *
    * This method makes all necessary operations with text 
@@ -238,7 +295,7 @@ public:
    */
   void setSynthCommand(const std::string& cmdLine)
   {
-    m_synthCommand = cmdLine;
+    compileCommandLine(cmdLine, m_synthCommand);
   }
 
   /**\brief Sets new command line template to run ALSA playe 
@@ -252,7 +309,7 @@ public:
    */
   void setAlsaPlayerCommand(const std::string& cmdLine)
   {
-    m_alsaPlayerCommand = cmdLine;
+    compileCommandLine(cmdLine, m_alsaPlayerCommand);
   }
 
   /**\brief Sets new command line template to run Pulse Audio player
@@ -266,7 +323,7 @@ public:
    */
   void setPulseaudioPlayerCommand(const std::string& cmdLine)
   {
-    m_pulseaudioPlayerCommand = cmdLine;
+    compileCommandLine(cmdLine, m_pulseaudioPlayerCommand);
   }
 
   /**\brief Sets new command line template to run PC speaker player
@@ -280,7 +337,7 @@ public:
    */
   void setPcspeakerPlayerCommand(const std::string& cmdLine)
   {
-    m_pcspeakerPlayerCommand = cmdLine;
+    compileCommandLine(cmdLine, m_pcspeakerPlayerCommand);
   }
 
   /**\brief Adds new replacement to mark capitalized letter
@@ -353,27 +410,33 @@ public:
    */
   void addReplacement(const std::wstring& oldString, const std::wstring& newString)
   {
-    m_replacements.push_back(OutputReplacement(oldString, newString));
+    m_replacements.add(oldString, newString);
   }
 
 private:
-  struct FloatValueFormat
+  enum {SegmentText = 0, SegmentVolume = 1, SegmentPitch = 2, SegmentRate = 3};
+
+  struct CommandSegment
   {
-    FloatValueFormat()
-      : digits(2), min(0), aver(0.5), max(1) {}
+    CommandSegment()
+      : kind(SegmentText) {}
+
+    CommandSegment(int k, const std::string& t)
+      : kind(k), text(t) {}
+
+    int kind;
+    std::string text;
+  }; //struct CommandSegment;
 
-    size_t digits;
-    double min;
-    double aver;
-    double max;
-  }; //struct FloatValueFormat;
+  typedef std::vector<CommandSegment> CommandTemplate;
+  typedef std::vector<std::string> ParamValueVector;
 
 private:
-  bool findReplacement(const std::wstring& str, std::wstring::size_type pos, OutputReplacementVector::size_type& result) const;
-  std::wstring insertReplacements(const std::wstring& str) const;
   std::wstring makeCaps(const TextItem& textItem) const;
-  std::string prepareCommandLine(const std::string& pattern, const TextItem& textItem) const;
-  std::string prepareFloatValue(TextParam value, const FloatValueFormat& format) const;
+  size_t findChunkEnd(const std::wstring& text, size_t pos) const;
+  std::string prepareCommandLine(const CommandTemplate& commandTemplate, const TextItem& textItem) const;
+  static void compileCommandLine(const std::string& pattern, CommandTemplate& commandTemplate);
+  static void prepareParamValues(size_t digits, double min, double aver, double max, ParamValueVector& values);
 
 private:
   typedef std::map<wchar_t, std::wstring> WCharToWStringMap;
@@ -381,13 +444,17 @@ private:
   LangId m_langId;
   const Lang* m_lang;
   std::string m_name, m_family;
+  bool m_persistent;
+  size_t m_minChunkLength, m_maxChunkLength;
+  size_t m_sampleRate, m_channels;
+  std::string m_sampleFormat;
   WCharToWStringMap m_capList;
-  std::string m_synthCommand;
-  std::string m_alsaPlayerCommand, m_pulseaudioPlayerCommand, m_pcspeakerPlayerCommand;
-  FloatValueFormat m_pitchFormat;
-  FloatValueFormat m_rateFormat;
-  FloatValueFormat m_volumeFormat;
-  OutputReplacementVector m_replacements;
+  CommandTemplate m_synthCommand;
+  CommandTemplate m_alsaPlayerCommand, m_pulseaudioPlayerCommand, m_pcspeakerPlayerCommand;
+  ParamValueVector m_pitchValues;
+  ParamValueVector m_rateValues;
+  ParamValueVector m_volumeValues;
+  ReplacementMatcher m_replacements;
 }; //class Output;
 
 typedef std::vector<Output> OutputVector;
@@ -19,6 +19,7 @@
 void OutputSet::reinit(const OutputList& outputs)
 {
   m_outputs.clear();
+  m_outputsIndex.clear();
   if (outputs.empty())
     return;
   m_outputs.resize(outputs.size());
@@ -27,71 +28,75 @@ void OutputSet::reinit(const OutputList& outputs)
     {
       assert(index < m_outputs.size());
       m_outputs[index] = *it;
+      //The first output with the same family and language wins;
+      m_outputsIndex.insert(LangIdAndFamilyToOutputHandleMap::value_type(LangIdAndFamily(it->getLangId(), it->getFamily()), index));
       index++;
     } //for();
 }
 
-bool OutputSet::hasOutput(const std::string& outputName) const
+bool OutputSet::hasOutput(OutputHandle outputHandle) const
 {
-  for(OutputVector::size_type i = 0;i < m_outputs.size();i++)
-    if (m_outputs[i].getName() == outputName)
-      return 1;
-  return 0;
+  return outputHandle < m_outputs.size();
 }
 
-std::string OutputSet::prepareSynthCommand(const std::string& outputName, const TextItem& textItem) const
+std::string OutputSet::getOutputName(OutputHandle outputHandle) const
 {
-  OutputVector::size_type i;
-  for(i = 0;i < m_outputs.size();i++)
-    if (m_outputs[i].getName() == outputName)
-      break;
-  assert(i < m_outputs.size());
-  return m_outputs[i].prepareSynthCommand(textItem);
+  assert(outputHandle < m_outputs.size());
+  return m_outputs[outputHandle].getName();
 }
 
-std::string OutputSet::preparePlayerCommand(const std::string& outputName, PlayerType playerType, const TextItem& textItem) const
+bool OutputSet::isPersistent(OutputHandle outputHandle) const
 {
-  OutputVector::size_type i;
-  for(i = 0;i < m_outputs.size();i++)
-    if (m_outputs[i].getName() == outputName)
-      break;
-  assert(i < m_outputs.size());
+  assert(outputHandle < m_outputs.size());
+  return m_outputs[outputHandle].isPersistent();
+}
+
+void OutputSet::splitToChunks(OutputHandle outputHandle, const TextItem& textItem, TextItemList& chunks) const
+{
+  assert(outputHandle < m_outputs.size());
+  m_outputs[outputHandle].splitToChunks(textItem, chunks);
+}
+
+std::string OutputSet::prepareSynthCommand(OutputHandle outputHandle, const TextItem& textItem) const
+{
+  assert(outputHandle < m_outputs.size());
+  return m_outputs[outputHandle].prepareSynthCommand(textItem);
+}
+
+std::string OutputSet::preparePlayerCommand(OutputHandle outputHandle, PlayerType playerType, const TextItem& textItem) const
+{
+  assert(outputHandle < m_outputs.size());
+  const Output& output = m_outputs[outputHandle];
   switch(playerType)
     {
     case PlayerTypeAlsa:
-      return m_outputs[i].prepareAlsaPlayerCommand(textItem);
+      return output.prepareAlsaPlayerCommand(textItem);
     case PlayerTypePulseaudio:
-      return m_outputs[i].preparePulseaudioPlayerCommand(textItem);
+      return output.preparePulseaudioPlayerCommand(textItem);
     case PlayerTypePcspeaker:
-      return m_outputs[i].preparePcspeakerPlayerCommand(textItem);
+      return output.preparePcspeakerPlayerCommand(textItem);
+    case PlayerTypeLibao:
+      return output.prepareLibaoPlayerCommand();
     } //switch();
   assert(0);
   return "";//just to reduce compilation warnings;
 }
 
-std::string OutputSet::prepareText(const std::string& outputName, const TextItem& textItem) const
+std::string OutputSet::prepareText(OutputHandle outputHandle, const TextItem& textItem) const
 {
-  OutputVector::size_type i;
-  for(i = 0;i < m_outputs.size();i++)
-    if (m_outputs[i].getName() == outputName)
-      break;
-  assert(i < m_outputs.size());
-  return m_outputs[i].prepareText(textItem);
+  assert(outputHandle < m_outputs.size());
+  return m_outputs[outputHandle].prepareText(textItem);
 }
 
-std::string OutputSet::getOutputNameByFamilyAndLangId(const std::string& familyName, LangId langId) const
+OutputHandle OutputSet::findOutput(const std::string& familyName, LangId langId) const
 {
-  for(OutputVector::size_type i = 0;i < m_outputs.size();i++)
-    if (m_outputs[i].getFamily() == familyName && m_outputs[i].getLangId() == langId)
-      return m_outputs[i].getName();
-  assert(0);
-  return "";//just to reduce compilation warnings;
+  LangIdAndFamilyToOutputHandleMap::const_iterator it = m_outputsIndex.find(LangIdAndFamily(langId, familyName));
+  if (it == m_outputsIndex.end())
+    return OUTPUT_HANDLE_NONE;
+  return it->second;
 }
 
 bool OutputSet::isValidFamilyName(LangId langId, const std::string& familyName) const
 {
-  for(OutputVector::size_type i = 0;i < m_outputs.size();i++)
-    if (m_outputs[i].getFamily() == familyName && m_outputs[i].getLangId() == langId)
-      return 1;
-  return 0;
+  return findOutput(familyName, langId) != OUTPUT_HANDLE_NONE;
 }
@@ -22,7 +22,8 @@
  *
  * This class is designed to store outputs prepared for functioning. It
  * allows silent reloading of the output set and hide any reference to
- * them from other classes.
+ * them from other classes. Outputs are referred by integer handles,
+ * resolved once for each text item by voice family and language.
  *
  * \sa Output
  */
@@ -45,16 +46,44 @@ class OutputSet
    */
   void reinit(const OutputList& outputs);
 
-  /**\brief Checks output availability by its name
+  /**\brief Checks output handle validity
    *
    * This method allows you to be sure the output set contains an output
-   * specified by its name.
+   * specified by its handle.
    *
-   * \param [in] outputName The name of the output to check
+   * \param [in] outputHandle The handle of the output to check
    *
    * \return Non-zero if specified output exists
    */
-  bool hasOutput(const std::string& outputName) const;
+  bool hasOutput(OutputHandle outputHandle) const;
+
+  /**\brief Returns the name of the output
+   *
+   * \param [in] outputHandle The handle of the output to get name of
+   *
+   * \return The name of the output
+   */
+  std::string getOutputName(OutputHandle outputHandle) const;
+
+  /**\brief Checks if specified output uses long-lived synthesizer and player processes
+   *
+   * \param [in] outputHandle The handle of the output to check
+   *
+   * \return Non-zero if specified output is persistent
+   *
+   * \sa Output::isPersistent()
+   */
+  bool isPersistent(OutputHandle outputHandle) const;
+
+  /**\brief Splits text item into chunks to be synthesized separately by specified output
+   *
+   * \param [in] outputHandle The handle of the output the text item is assigned to
+   * \param [in] textItem The text item to split
+   * \param [out] chunks The list to add chunks to
+   *
+   * \sa Output::splitToChunks()
+   */
+  void splitToChunks(OutputHandle outputHandle, const TextItem& textItem, TextItemList& chunks) const;
 
   /**\brief Prepares the command line to invoke speech synthesizer of specified output
    *
@@ -63,12 +92,12 @@ class OutputSet
    * TextItem object. Synthesizer command line can contain various
    * parameters as speech volume, pitch and rate.
    *
-   * \param [in] outputName The name of the output to generate command line by
+   * \param [in] outputHandle The handle of the output to generate command line by
    * \param [in] textItem The text item to generate command line for
    *
    * \return Generated synthesizer command line
    */
-  std::string prepareSynthCommand(const std::string& outputName, const TextItem& textItem) const;
+  std::string prepareSynthCommand(OutputHandle outputHandle, const TextItem& textItem) const;
 
   /**\brief Generates command line to play portion of synthesized speech
    *
@@ -78,13 +107,13 @@ class OutputSet
    * three audio subsystems: alsa, pulseaudio and pc speaker. One of the
    * parameters chooses which one of them must be used.
    *
-   *  \param [in] outputName The output name to generate command line with
-   * \param [in] playerType The type of player to use, can be PlayerTypeAlsa, PlayerTypePulseaudio or PlayerTypePcspeaker
+   *  \param [in] outputHandle The handle of the output to generate command line with
+   * \param [in] playerType The type of player to use, can be PlayerTypeAlsa, PlayerTypePulseaudio, PlayerTypePcspeaker or PlayerTypeLibao
    * \param [in] textItem The text item to generate command line for
    *
    * \return The generated command line to execute player process
    */
-  std::string preparePlayerCommand(const std::string& outputName, PlayerType playerType, const TextItem& textItem) const;
+  std::string preparePlayerCommand(OutputHandle outputHandle, PlayerType playerType, const TextItem& textItem) const;
 
   /**\brief Prepares text to send to speech synthesizer
    *
@@ -92,26 +121,26 @@ class OutputSet
    * send it to speech synthesizer. It can be any escaping or marks to
    * speak some characters phonetically.
    *
-   * \param [in] outputName The name of the output to prepare text with
+   * \param [in] outputHandle The handle of the output to prepare text with
    * \param [in] textItem The text item to prepare text for
    *
    * \return The prepared text
    */
-  std::string prepareText(const std::string& outputName, const TextItem& textItem) const;
+  std::string prepareText(OutputHandle outputHandle, const TextItem& textItem) const;
 
-  /**\brief Returns the output name corresponding to some voice family and language 
+  /**\brief Finds the output corresponding to some voice family and language 
    *
-   * This method looks through stored set of outputs and returns one with
-   * corresponding voice family and language properties. It returns the
-   * first one as it be found during the search, but this output must
-   * exists. Use isValidFamily Name() method to be sure such output exists.
+   * This method looks up the output with corresponding voice family and
+   * language properties in the index built on reinit() call. If there
+   * are several such outputs, the first one of them is returned. The
+   * returned handle remains valid until next reinit() call.
    *
    * \param [in] familyName The voice family of requested output
    * \param [in] langId The language identifier of requested output
    *
-   * \return The name of requested output
+   * \return The handle of requested output or OUTPUT_HANDLE_NONE if there is no such output
    */
-  std::string getOutputNameByFamilyAndLangId(const std::string& familyName, LangId langId) const;
+  OutputHandle findOutput(const std::string& familyName, LangId langId) const;
 
   /**\brief Checks if some family name is valid for some language
    *
@@ -126,7 +155,11 @@ class OutputSet
   bool isValidFamilyName(LangId langId, const std::string& familyName) const;
 
 private:
+  typedef std::pair<LangId, std::string> LangIdAndFamily;
+  typedef std::map<LangIdAndFamily, OutputHandle> LangIdAndFamilyToOutputHandleMap;
+
   OutputVector m_outputs;
+  LangIdAndFamilyToOutputHandleMap m_outputsIndex;
 }; //class OutputSet;
 
 #endif //__VOICEMAN_OUTPUT_SET_H__;
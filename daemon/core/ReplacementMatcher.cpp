@@ -0,0 +1,117 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"ReplacementMatcher.h"
+
+void ReplacementMatcher::setLang(const Lang* lang)
+{
+  m_lang = lang;
+  m_exact.clear();
+  m_folded.clear();
+  for(ReplacementVector::size_type i = 0;i < m_replacements.size();i++)
+    compile(i);
+}
+
+void ReplacementMatcher::add(const std::wstring& oldValue, const std::wstring& newValue)
+{
+  if (oldValue.empty())
+    return;
+  m_replacements.push_back(Replacement(oldValue, newValue));
+  compile(m_replacements.size() - 1);
+}
+
+bool ReplacementMatcher::find(const std::wstring& str, std::wstring::size_type pos, ReplacementVector::size_type& result) const
+{
+  size_t exactNode = m_exact.getRoot(), foldedNode = m_lang != NULL?m_folded.getRoot():WStringTrie::NoNode;
+  bool exactFound = 0, foldedFound = 0;
+  size_t exactValue = 0, foldedValue = 0;
+  for(std::wstring::size_type i = pos;i < str.length();i++)
+    {
+      if (exactNode == WStringTrie::NoNode && foldedNode == WStringTrie::NoNode)
+	break;
+      if (exactNode != WStringTrie::NoNode)
+	{
+	  exactNode = m_exact.getChild(exactNode, str[i]);
+	  if (exactNode != WStringTrie::NoNode)
+	    {
+	      const size_t v = m_exact.getValue(exactNode);
+	      if (v != WStringTrie::NoValue && (!exactFound || v < exactValue))
+		{
+		  exactValue = v;
+		  exactFound = 1;
+		}
+	    }
+	}
+      if (foldedNode != WStringTrie::NoNode)
+	{
+	  foldedNode = m_folded.getChild(foldedNode, m_lang->toLower(str[i]));
+	  if (foldedNode != WStringTrie::NoNode)
+	    {
+	      const size_t v = m_folded.getValue(foldedNode);
+	      if (v != WStringTrie::NoValue && (!foldedFound || v < foldedValue))
+		{
+		  foldedValue = v;
+		  foldedFound = 1;
+		}
+	    }
+	}
+    } //for();
+  if (exactFound)
+    {
+      result = exactValue;
+      return 1;
+    }
+  if (foldedFound)
+    {
+      result = foldedValue;
+      return 1;
+    }
+  return 0;
+}
+
+std::wstring ReplacementMatcher::insertReplacements(const std::wstring& str) const
+{
+  std::wstring newStr;
+  for(std::wstring::size_type i = 0;i < str.length();i++)
+    {
+      ReplacementVector::size_type k;
+      if (find(str, i, k))
+	{
+	  assert(k < m_replacements.size());
+	  const std::wstring& newValue = m_replacements[k].newValue;
+	  if (newValue.length() > 1)
+	    {
+	      if (BLANK_CHAR(newValue[0]))
+		attachSpace(newStr);
+	      newStr += trim(newValue);
+	      if (BLANK_CHAR(newValue[newValue.length() - 1]))
+		attachSpace(newStr);
+	    } else 
+	    newStr += newValue;
+	  i += m_replacements[k].oldValue.length()-1;
+	} else
+	attachCharWithoutDoubleSpaces(newStr, str[i]);
+    }
+  return newStr;
+}
+
+void ReplacementMatcher::compile(ReplacementVector::size_type index)
+{
+  assert(index < m_replacements.size());
+  m_exact.add(m_replacements[index].oldValue, index);
+  if (m_lang != NULL)
+    m_folded.add(m_lang->toLower(m_replacements[index].oldValue), index);
+}
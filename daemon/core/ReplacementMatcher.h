@@ -0,0 +1,143 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_REPLACEMENT_MATCHER_H__
+#define __VOICEMAN_REPLACEMENT_MATCHER_H__
+
+#include"Lang.h"
+#include"WStringTrie.h"
+
+/**\brief Stores all information about a replacement item
+ *
+ * Replacements can be used for punctuation processing, pronunciation
+ * fixing or any other purpose. This struct contains all necessary
+ * information about one replacement. String fields must store exact
+ * values, no pattern or expressions are allowed.
+ *
+ * \sa ReplacementMatcher
+ */
+struct Replacement 
+{
+  /**\brief The default constructor*/
+  Replacement() {}
+
+  /**\brief The constructor
+   *
+   * \param [in] oldstring The string to replace
+   * \param [in] newstring The string to replace with
+   */
+  Replacement(const std::wstring& oldString, const std::wstring& newString)
+    : oldValue(oldString), newValue(newString) {}
+
+  /**\brief The string to replace*/
+  std::wstring oldValue;
+
+  /**\brief The string to replace with*/
+  std::wstring newValue;
+}; //struct Replacement;
+
+typedef std::vector<Replacement> ReplacementVector;
+typedef std::list<Replacement> ReplacementList;
+
+/**\brief The precompiled set of replacements
+ *
+ * This class is used by both TextProcessor and Output classes to
+ * insert replacements into the text. Replacements are compiled into
+ * prefix trees as they are added, one for exact strings and one for
+ * strings in lower case for language-aware case insensitive
+ * matching. Both trees are walked together in one pass from each text
+ * position. Exact matches have priority over case insensitive ones and
+ * the replacement added earlier wins among matches of the same kind.
+ *
+ * \sa TextProcessor Output
+ */
+class ReplacementMatcher
+{
+public:
+  /**\brief The default constructor*/
+  ReplacementMatcher()
+    : m_lang(NULL) {}
+
+  /**\brief The destructor*/
+  virtual ~ReplacementMatcher() {}
+
+  /**\brief Sets the language for case insensitive matching
+   *
+   * Case insensitive matching is performed only if language object is
+   * set. Already added replacements are compiled again.
+   *
+   * \param [in] lang The language object to fold characters case with (may be NULL)
+   */
+  void setLang(const Lang* lang);
+
+  /**\brief Adds new replacement
+   *
+   * \param [in] oldValue The string to replace (empty strings are ignored)
+   * \param [in] newValue The string to replace with
+   */
+  void add(const std::wstring& oldValue, const std::wstring& newValue);
+
+  /**\brief Finds replacement at specified position of a text
+   *
+   * \param [in] str The text to search replacement in
+   * \param [in] pos The position in the text to search replacement at
+   * \param [out] result The index of found replacement
+   *
+   * \return Non-zero if replacement was found or zero otherwise
+   */
+  bool find(const std::wstring& str, std::wstring::size_type pos, ReplacementVector::size_type& result) const;
+
+  /**\brief Inserts replacements into the text
+   *
+   * This method replaces all found strings by their new values. Spaces
+   * around new values are attached without doubling.
+   *
+   * \param [in] str The text to process
+   *
+   * \return The text with inserted replacements
+   */
+  std::wstring insertReplacements(const std::wstring& str) const;
+
+  /**\brief Returns the replacement by index
+   *
+   * \param [in] index The index of the replacement to return
+   *
+   * \return The requested replacement
+   */
+  const Replacement& getReplacement(ReplacementVector::size_type index) const
+  {
+    assert(index < m_replacements.size());
+    return m_replacements[index];
+  }
+
+  /**\brief Returns the number of stored replacements
+   *
+   * \return The number of stored replacements
+   */
+  ReplacementVector::size_type getReplacementCount() const
+  {
+    return m_replacements.size();
+  }
+
+private:
+  void compile(ReplacementVector::size_type index);
+
+private:
+  const Lang* m_lang;
+  ReplacementVector m_replacements;
+  WStringTrie m_exact, m_folded;
+}; //class ReplacementMatcher;
+
+#endif //__VOICEMAN_REPLACEMENT_MATCHER_H__
@@ -0,0 +1,141 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"SessionCapture.h"
+#include"UtteranceTrace.h"
+
+#define CAPTURE_BUF_SIZE 65536
+#define MAX_NUMBER_LEN 10
+
+SessionCapture sessionCapture;
+
+bool SessionCapture::open(const std::string& fileName)
+{
+  if (m_file != NULL && fileName == m_fileName)
+    return 1;
+  close();
+  //Connection IDs and timing start from scratch, records of previous runs must not be mixed with new ones;
+  m_file = fopen(fileName.c_str(), "wb");
+  if (m_file == NULL)
+    return 0;
+  setvbuf(m_file, NULL, _IOFBF, CAPTURE_BUF_SIZE);
+  m_fileName = fileName;
+  m_lastTime = getMonotonicTime();
+  fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, m_file);
+  return 1;
+}
+
+void SessionCapture::close()
+{
+  if (m_file == NULL)
+    return;
+  if (fclose(m_file) != 0)
+    logMsg(LOG_ERR, "Could not finish capture file \'%s\' (fclose() returned %s)", m_fileName.c_str(), ERRNO_MSG);
+  m_file = NULL;
+}
+
+void SessionCapture::writeLine(size_t connection, const char* data, size_t length)
+{
+  if (m_file != NULL)
+    writeRecord(connection, length + 1, data, length);
+}
+
+void SessionCapture::writeClose(size_t connection)
+{
+  if (m_file == NULL)
+    return;
+  writeRecord(connection, 0, NULL, 0);
+  flush();
+}
+
+void SessionCapture::flush()
+{
+  if (m_file != NULL && fflush(m_file) != 0)
+    {
+      logMsg(LOG_ERR, "Could not write capture file \'%s\', capture is stopped (fflush() returned %s)", m_fileName.c_str(), ERRNO_MSG);
+      close();
+    }
+}
+
+void SessionCapture::writeRecord(size_t connection, size_t lengthCode, const char* data, size_t length)
+{
+  assert(m_file != NULL);
+  const double now = getMonotonicTime();
+  const double delta = now > m_lastTime?now - m_lastTime:0;
+  const size_t micros = (size_t)(delta * 1000000);
+  //The rest of the interval is carried to the next record, so the error does not accumulate;
+  m_lastTime += (double)micros / 1000000;
+  writeNumber(micros);
+  writeNumber(connection);
+  writeNumber(lengthCode);
+  if (length > 0 && fwrite(data, 1, length, m_file) != length)
+    {
+      logMsg(LOG_ERR, "Could not write capture file \'%s\', capture is stopped (fwrite() returned %s)", m_fileName.c_str(), ERRNO_MSG);
+      close();
+    }
+}
+
+void SessionCapture::writeNumber(size_t value)
+{
+  unsigned char buf[MAX_NUMBER_LEN];
+  size_t len = 0;
+  while(value >= 0x80)
+    {
+      buf[len++] = (unsigned char)(value & 0x7f) | 0x80;
+      value >>= 7;
+    }
+  buf[len++] = (unsigned char)value;
+  fwrite(buf, 1, len, m_file);
+}
+
+bool SessionCaptureReader::open(const std::string& fileName)
+{
+  m_file = fopen(fileName.c_str(), "rb");
+  if (m_file == NULL)
+    return 0;
+  char magic[CAPTURE_MAGIC_LEN];
+  return fread(magic, 1, CAPTURE_MAGIC_LEN, m_file) == CAPTURE_MAGIC_LEN && memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) == 0;
+}
+
+bool SessionCaptureReader::read(CaptureRecord& record)
+{
+  assert(m_file != NULL);
+  size_t micros, lengthCode;
+  if (!readNumber(micros) || !readNumber(record.connection) || !readNumber(lengthCode))
+    return 0;
+  m_time += (double)micros / 1000000;
+  record.time = m_time;
+  record.closed = lengthCode == 0;
+  record.line.resize(lengthCode > 0?lengthCode - 1:0);
+  if (!record.line.empty() && fread(&record.line[0], 1, record.line.size(), m_file) != record.line.size())
+    return 0;
+  return 1;
+}
+
+bool SessionCaptureReader::readNumber(size_t& value)
+{
+  value = 0;
+  for(size_t shift = 0;shift < 7 * MAX_NUMBER_LEN;shift += 7)
+    {
+      const int c = fgetc(m_file);
+      if (c == EOF)
+	return 0;
+      value |= (size_t)(c & 0x7f) << shift;
+      if (!(c & 0x80))
+	return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_SESSION_CAPTURE_H__
+#define __VOICEMAN_SESSION_CAPTURE_H__
+
+/*
+ * The capture file starts with CAPTURE_MAGIC signature followed by
+ * records without any alignment. Each record consists of three unsigned
+ * integers in variable-length encoding (seven bits per byte, the least
+ * significant first, the high bit set in all bytes except the last one)
+ * and optional line data. The integers are the time since the previous
+ * record in microseconds, the connection ID and the line length
+ * increased by one. Zero value instead of line length means the
+ * connection was closed. The line is stored as it was received from the
+ * client, without the trailing new line character.
+ */
+
+#define CAPTURE_MAGIC "VMCAPT01"
+#define CAPTURE_MAGIC_LEN 8
+
+/**\brief The recorder of client sessions
+ *
+ * This class writes every line received from clients to a capture file
+ * with a timestamp and an ID of the connection, so the sessions can be
+ * played back later against the daemon with the same timing. The file
+ * is written through a large buffer and flushed after each portion of
+ * received data, when a connection is closed and when the capture is
+ * finished.
+ *
+ * \sa SessionCaptureReader
+ */
+class SessionCapture
+{
+public:
+  /**\brief The default constructor*/
+  SessionCapture()
+    : m_file(NULL), m_lastTime(0) {}
+
+  /**\brief The destructor*/
+  virtual ~SessionCapture()
+  {
+    close();
+  }
+
+public:
+  /**\brief Starts new capture
+   *
+   * The previous capture is finished if it was started, but the capture
+   * to the same file just goes on, so reloading of the configuration
+   * does not lose records. A new capture truncates the file.
+   *
+   * \param [in] fileName The name of the file to write capture to
+   *
+   * \return Non-zero if the file was opened successfully
+   */
+  bool open(const std::string& fileName);
+
+  /**\brief Finishes the capture flushing all buffered data*/
+  void close();
+
+  /**\brief Checks if capture is started
+   *
+   * \return Non-zero if capture is started
+   */
+  bool isOpen() const
+  {
+    return m_file != NULL;
+  }
+
+  /**\brief Records the line received from the client
+   *
+   * \param [in] connection The ID of client connection
+   * \param [in] data The line data without new line character
+   * \param [in] length The length of the line
+   */
+  void writeLine(size_t connection, const char* data, size_t length);
+
+  /**\brief Records closing of client connection
+   *
+   * \param [in] connection The ID of client connection
+   */
+  void writeClose(size_t connection);
+
+  /**\brief Writes all buffered records to the capture file
+   *
+   * The capture is stopped on write error.
+   */
+  void flush();
+
+private:
+  void writeRecord(size_t connection, size_t lengthCode, const char* data, size_t length);
+  void writeNumber(size_t value);
+
+private:
+  FILE* m_file;
+  std::string m_fileName;
+  double m_lastTime;
+}; //class SessionCapture;
+
+/**\brief The record of session capture*/
+struct CaptureRecord
+{
+  /**\brief The default constructor*/
+  CaptureRecord()
+    : time(0), connection(0), closed(0) {}
+
+  /**\brief The time since the capture start in seconds*/
+  double time;
+
+  /**\brief The ID of client connection*/
+  size_t connection;
+
+  /**\brief Is this record about connection closing*/
+  bool closed;
+
+  /**\brief The line received from the client*/
+  std::string line;
+}; //struct CaptureRecord;
+
+/**\brief The reader of capture files
+ *
+ * \sa SessionCapture
+ */
+class SessionCaptureReader
+{
+public:
+  /**\brief The default constructor*/
+  SessionCaptureReader()
+    : m_file(NULL), m_time(0) {}
+
+  /**\brief The destructor*/
+  virtual ~SessionCaptureReader()
+  {
+    if (m_file != NULL)
+      fclose(m_file);
+  }
+
+public:
+  /**\brief Opens capture file and checks its signature
+   *
+   * \param [in] fileName The name of the file to read
+   *
+   * \return Non-zero if the file is opened and it has valid signature
+   */
+  bool open(const std::string& fileName);
+
+  /**\brief Reads the next record
+   *
+   * \param [out] record The place to put read record to
+   *
+   * \return Non-zero if the record was read or zero at the end of file or on error
+   */
+  bool read(CaptureRecord& record);
+
+private:
+  bool readNumber(size_t& value);
+
+private:
+  FILE* m_file;
+  double m_time;
+}; //class SessionCaptureReader;
+
+/**\brief The capture of client sessions enabled by the configuration*/
+extern SessionCapture sessionCapture;
+
+#endif //__VOICEMAN_SESSION_CAPTURE_H__
@@ -85,14 +85,14 @@ void TextItem::setRate(TextParam rate)
   m_rate = rate;
 }
 
-std::string TextItem::getOutputName() const
+OutputHandle TextItem::getOutputHandle() const
 {
-  return m_outputName;
+  return m_outputHandle;
 }
 
-void TextItem::setOutputName(const std::string& outputName)
+void TextItem::setOutputHandle(OutputHandle outputHandle)
 {
-  m_outputName = outputName;
+  m_outputHandle = outputHandle;
 }
 
 LangId TextItem::getLangId() const
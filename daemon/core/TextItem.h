@@ -37,14 +37,14 @@ class TextItem
 public:
   /**\brief The default constructor*/
   TextItem()
-    : m_langId(LANG_ID_NONE) {}
+    : m_outputHandle(OUTPUT_HANDLE_NONE), m_langId(LANG_ID_NONE) {}
 
   /**\brief The constructor with text specification
    *
    * \param [in] text The text string for the new text item
    */
   TextItem(const std::wstring& text)
-    : m_text(text), m_langId(LANG_ID_NONE) {}
+    : m_outputHandle(OUTPUT_HANDLE_NONE), m_text(text), m_langId(LANG_ID_NONE) {}
 
   /**\brief The constructor with language and text specification
    *
@@ -52,15 +52,7 @@ public:
    * \param [in] text The text string for the new text item
    */
  TextItem(LangId langId, const std::wstring& text)
-    : m_text(text), m_langId(langId) {}
-
-  /**\brief The constructor with output name and text string specification
-   *
-   * \param [in] outputName The name of a output new item will be associated with
-   * \param [in] text The text string for the new item
-   */
-  TextItem(const std::string& outputName, const std::wstring& text)
-    : m_outputName(outputName), m_text(text), m_langId(LANG_ID_NONE) {}
+    : m_outputHandle(OUTPUT_HANDLE_NONE), m_text(text), m_langId(langId) {}
 
   /**\brief The constructor with text and parameters specification
    *
@@ -70,18 +62,7 @@ public:
    * \param [in] rate The rate value for the new item
    */
   TextItem(const std::wstring& text, TextParam volume, TextParam pitch, TextParam rate)
-    : m_text(text), m_volume(volume), m_pitch(pitch), m_rate(rate), m_langId(LANG_ID_NONE) {}
-
-  /**\brief The constructor with output name, text and parameters specification
-   *
-   * \param [in] outputName The name of the output new item will be associated with
-   * \param [in] text The text string for the new item
-   * \param [in] volume The volume value for the new item
-   * \param [in] pitch The pitch value for the new item
-   * \param [in] rate The rate value for the new item
-   */
-  TextItem(const std::string& outputName, const std::wstring& text, TextParam volume, TextParam pitch, TextParam rate)
-    : m_outputName(outputName), m_text(text), m_volume(volume), m_pitch(pitch), m_rate(rate), m_langId(LANG_ID_NONE) {}
+    : m_outputHandle(OUTPUT_HANDLE_NONE), m_text(text), m_volume(volume), m_pitch(pitch), m_rate(rate), m_langId(LANG_ID_NONE) {}
 
   /**\brief The constructor with language , text and parameters specification
    *
@@ -92,7 +73,7 @@ public:
    * \param [in] rate The rate value for the new item
    */
   TextItem(LangId langId, const std::wstring& text, TextParam volume, TextParam pitch, TextParam rate)
-    : m_text(text), m_volume(volume), m_pitch(pitch), m_rate(rate), m_langId(langId) {}
+    : m_outputHandle(OUTPUT_HANDLE_NONE), m_text(text), m_volume(volume), m_pitch(pitch), m_rate(rate), m_langId(langId) {}
 
   /**\brief Returns the text string of current text item
    *
@@ -195,23 +176,26 @@ public:
    */
   void setRate(TextParam rate);
 
-  /**\brief Returns output name for this text item
+  /**\brief Returns output handle for this text item
    *
-   * Use this method to retrieve name of the associated output. The output
-   * name can by an empty string. It is a valid case, the output name can
-   * be set later during further processing of this text item.
+   * Use this method to retrieve handle of the associated output in
+   * OutputSet. The handle can be OUTPUT_HANDLE_NONE. It is a valid case,
+   * the output can be assigned later during further processing of this
+   * text item.
    *
-   * \return The output name associated with this text item
+   * \return The handle of the output associated with this text item
 */
-  std::string getOutputName() const;
+  OutputHandle getOutputHandle() const;
 
-  /**\brief Sets new value of output name
+  /**\brief Sets new value of output handle
+   *
+   * This method sets new handle of associated output
    *
-   * This method sets new name of associated output
+   * \param [in] outputHandle The value to set
    *
-   * \param [in] outputName The value to set
+   * \sa OutputSet::findOutput()
    */
-  void setOutputName(const std::string& outputName);
+  void setOutputHandle(OutputHandle outputHandle);
 
   /**\brief Returns language of this text item
    *
@@ -233,7 +217,7 @@ private:
   void ensureMarksSize(size_t index);
 
 private:
-  std::string m_outputName;
+  OutputHandle m_outputHandle;
   std::wstring m_text;
   BoolVector m_marks;
   TextParam m_volume, m_pitch, m_rate;
@@ -32,7 +32,7 @@ void TextParam::reset()
   m_value = 50;
 }
 
-size_t TextParam::getValue()
+size_t TextParam::getValue() const
 {
   return m_value;
 }
@@ -54,7 +54,7 @@ public:
    *
    * \return The native parameter value
    */
-  size_t getValue();
+  size_t getValue() const;
 
   /**\brief Returns the value mapped  into specified interval
    *
@@ -34,10 +34,10 @@ void TextProcessor::split(const std::wstring& text, TextItemList& items) const
 	  attachSpace(currentText);
 	  continue;
 	} // space;
-      WCharToLangIdMap::const_iterator it = m_charsTable.find(let);
-      if (it == m_charsTable.end())
+      const LangId* charLangId = m_charsTable.find(let);
+      if (charLangId == NULL)
 	continue;//character is not present in characters table and can be silently skipped;
-      if (it->second == LANG_ID_NONE)//the default language must be used for this letter;
+      if (*charLangId == LANG_ID_NONE)//the default language must be used for this letter;
 	{
 	  if (hasCurrentLangId)
 	    {
@@ -51,7 +51,7 @@ void TextProcessor::split(const std::wstring& text, TextItemList& items) const
 	  currentText += let;
 	  continue;
 	} //char of the default language;for the default output;
-      const LangId langId = it->second;
+      const LangId langId = *charLangId;
       if (hasCurrentLangId && currentLangId != langId)
 	{
 	  items.push_back(TextItem(currentLangId, currentText));
@@ -71,28 +71,28 @@ void TextProcessor::split(const std::wstring& text, TextItemList& items) const
 void TextProcessor::processLetter(wchar_t c, TextParam volume, TextParam pitch, TextParam rate, TextItemList& items) const
 {
   LangId langId = LANG_ID_NONE;
-  WCharToLangIdMap::const_iterator it = m_charsTable.find(c);
-  if (it != m_charsTable.end())
+  const LangId* charLangId = m_charsTable.find(c);
+  if (charLangId != NULL)
     {
-      if (it->second == LANG_ID_NONE)//it is letter for defautl language;
+      if (*charLangId == LANG_ID_NONE)//it is letter for defautl language;
     langId = m_defaultLangId; else
-	langId = it->second;
+	langId = *charLangId;
     } //there is entry in characters table;
   if (langId == LANG_ID_NONE)//we cannot determine the language for this letter, probable it has special value;
     {
-      WCharToWStringMap::const_iterator specialValueIt=m_specialValues.find(c);
-      if (specialValueIt != m_specialValues.end())
-	process(TextItem(specialValueIt->second, volume, pitch, rate), items);
+      const std::wstring* specialValue = m_specialValues.find(c);
+      if (specialValue != NULL)
+	process(TextItem(*specialValue, volume, pitch, rate), items);
       return;
     }
   const Lang* lang = getLangById(langId);
   TextParam p = pitch;
   if (lang != NULL && lang->getCharType(c) == Lang::UpCase)
     p+=CAP_OVERHEAD;
-  WCharToWStringMap::const_iterator specialValueIt=m_specialValues.find(c);
-  if (specialValueIt != m_specialValues.end())
+  const std::wstring* specialValue = m_specialValues.find(c);
+  if (specialValue != NULL)
     {
-      process(TextItem(specialValueIt->second, volume, p, rate), items);
+      process(TextItem(*specialValue, volume, p, rate), items);
       return;
     }
   std::wstring s;
@@ -106,7 +106,7 @@ void TextProcessor::processLetter(wchar_t c, TextParam volume, TextParam pitch,
 void TextProcessor::process(const TextItem& text, TextItemList& items) const
 {
   split(text.getText(), items);
-  logMsg(LOG_DEBUG, "Splitter produced %u item(s)", items.size());
+  VM_LOG_DEBUG("Splitter produced %u item(s)", items.size());
   TextItemList::iterator it;
   for(it = items.begin();it != items.end();it++)
     {
@@ -129,15 +129,15 @@ void TextProcessor::processItem(TextItem& text) const
       switch(m_digitsMode)
 	{
 	case DigitsModeNormal:
-	  logMsg(LOG_DEBUG, "Performing normal digits processing");
+	  VM_LOG_DEBUG("Performing normal digits processing");
 	  lang->expandNumbers(toSend, 0);
 	  break;
 	case DigitsModeSingle:
-	  logMsg(LOG_DEBUG, "Performing digits processing in single-digits mode");
+	  VM_LOG_DEBUG("Performing digits processing in single-digits mode");
 	  lang->expandNumbers(toSend, 1);
 	  break;
 	case DigitsModeNone:
-	  logMsg(LOG_DEBUG, "Skipping digits processing because of none mode");
+	  VM_LOG_DEBUG("Skipping digits processing because of none mode");
 	  break;
 	default:
 	  logMsg(LOG_WARNING, "Found unexpected digits mode (%d)", m_digitsMode);
@@ -156,77 +156,29 @@ void TextProcessor::processItem(TextItem& text) const
       text.mark(i);
 }
 
-bool TextProcessor::findReplacement(const std::wstring& str, std::wstring::size_type pos, LangId langId, ReplacementVector::size_type& result) const
-{
-  const Lang* lang = getLangById(langId);
-  if (!lang)
-    return 0;
-  //Case sensitive search;
-  for(ReplacementVector::size_type i = 0;i < m_replacements.size();i++)
-    {
-      if (m_replacements[i].langId != langId)
-	continue;
-      if (str.length() - pos < m_replacements[i].oldValue.length())
-	continue;
-      std::wstring::size_type j;
-      for(j = 0;j < m_replacements[i].oldValue.length();j++)
-	if (str[pos + j] != m_replacements[i].oldValue[j])
-	    break;
-      if (j == m_replacements[i].oldValue.length())
-	{
-	  result = i;
-	  return 1;
-	}
-    } //for(replacements);
-  //Case insensitive search;
-  for(ReplacementVector::size_type i = 0;i < m_replacements.size();i++)
-    {
-      if (m_replacements[i].langId != langId)
-	continue;
-      if (str.length() - pos < m_replacements[i].oldValue.length())
-	continue;
-      std::wstring::size_type j;
-      for(j = 0;j < m_replacements[i].oldValue.length();j++)
-	if (!lang->equalChars(str[pos + j], m_replacements[i].oldValue[j]))
-	    break;
-      if (j == m_replacements[i].oldValue.length())
-	{
-	  result = i;
-	  return 1;
-	}
-    } //for(replacements);
-  return 0;
-}
-
 std::wstring TextProcessor::insertReplacements(const std::wstring& str, LangId langId) const
 {
+  LangIdToReplacementMatcherMap::const_iterator it = m_replacements.find(langId);
+  if (it != m_replacements.end())
+    return it->second.insertReplacements(str);
   std::wstring newStr;
   for(std::wstring::size_type i = 0;i < str.length();i++)
-    {
-      ReplacementVector::size_type k;
-      if (findReplacement(str, i, langId, k))
-	{
-	  assert(k < m_replacements.size());
-	  const std::wstring& newValue = m_replacements[k].newValue;
-	  if (newValue.length() > 1)
-	    {
-	      if (BLANK_CHAR(newValue[0]))
-		attachSpace(newStr);
-	      newStr += trim(newValue);
-	      if (BLANK_CHAR(newValue[newValue.length() - 1]))
-		attachSpace(newStr);
-	    } else 
-	    newStr += newValue;
-	  i += m_replacements[k].oldValue.length()-1;
-	} else
-	attachCharWithoutDoubleSpaces(newStr, str[i]);
-    }
+    attachCharWithoutDoubleSpaces(newStr, str[i]);
   return newStr;
 }
 
 void TextProcessor::addReplacement(LangId langId, const std::wstring& oldValue, const std::wstring& newValue)
 {
-  m_replacements.push_back(Replacement(langId, oldValue, newValue));
+  const Lang* lang = getLangById(langId);
+  if (lang == NULL)
+    return;
+  LangIdToReplacementMatcherMap::iterator it = m_replacements.find(langId);
+  if (it == m_replacements.end())
+    {
+      it = m_replacements.insert(LangIdToReplacementMatcherMap::value_type(langId, ReplacementMatcher())).first;
+      it->second.setLang(lang);
+    }
+  it->second.add(oldValue, newValue);
 }
 
 void TextProcessor::setMode(int digitsMode, bool capitalization, bool separation)
@@ -249,13 +201,13 @@ void TextProcessor::setDefaultLangId(LangId langId)
 
 void TextProcessor::setSpecialValueFor(wchar_t c, const std::wstring& value)
 {
-  m_specialValues[c] = trim(value);
+  m_specialValues.set(c, trim(value));
 }
 
 void TextProcessor::associate(const std::wstring& str, LangId langId)
 {
   for(std::wstring::size_type i=0;i<str.length();i++)
-    m_charsTable[str[i]] = langId;
+    m_charsTable.set(str[i], langId);
 }
 
 auto_ptr<AbstractTextProcessor> createNewTextProcessor(const AbstractLangIdResolver& langIdResolver, int digitsMode, bool capitalization, bool separation)
@@ -18,42 +18,8 @@
 
 #include"TextItem.h"
 #include"AbstractTextProcessor.h"
-
-/**\brief Stores all information about a replacement item
- *
- * There are lists of replacements associated with each
- * language. Replacements can be used for punctuation processing or any
- * other purpose. This struct contains all necessary information about
- * one replacement. String fields must store exact values, no pattern or
- * expressions are allowed.
- */
-struct Replacement 
-{
-  /**\brief The default constructor*/
-  Replacement()
-    : langId(LANG_ID_NONE) {}
-
-  /**\brief The constructor
-   *
-   * \param [in] lang The ID of the language this replacement is associated with
-   * \param [in] oldstring The string to replace
-   * \param [in] newstring The string to replace with
-   */
-  Replacement(LangId lang, const std::wstring& oldString, const std::wstring& newString)
-    : langId(lang),oldValue(oldString), newValue(newString) {}
-
-  /**\brief The language this replacement is associated with*/
-  LangId langId;
-
-  /**\brief The string to replace*/
-  std::wstring oldValue;
-
-  /**\brief The string to replace with*/
-  std::wstring newValue;
-}; //struct Replacement;
-
-typedef std::vector<Replacement> ReplacementVector;
-typedef std::list<Replacement> ReplacementList;
+#include"ReplacementMatcher.h"
+#include"CharTable.h"
 
 /**\brief makes general text processing
  *
@@ -123,13 +89,16 @@ public:
 
   /**\brief Adds new text replacement
    *
-   * This method adds new replacement, associated with some language.
+   * This method adds new replacement, associated with some language. The
+   * replacement is compiled into per-language ReplacementMatcher object at
+   * once, so text processing does not need to check all replacements at
+   * each position. Replacements added earlier have priority.
    *
    * \param [in] langId The ID of a language to add replacement for
    * \param [in] oldValue The text to be replaced
    * \param [in] newValue The text to replace with
    *
-   * \sa Replacement
+   * \sa ReplacementMatcher
    */
   void addReplacement(LangId langId, const std::wstring& oldValue, const std::wstring& newValue);
 
@@ -168,21 +137,20 @@ public:
 
 private:
   const Lang* getLangById(LangId langId) const;
-  bool findReplacement(const std::wstring& str, std::wstring::size_type pos, LangId langId, ReplacementVector::size_type& result) const;
   std::wstring insertReplacements(const std::wstring& str, LangId langId) const;
   void processItem(TextItem& text) const;
   void split(const std::wstring& text, TextItemList& items) const;
 
 private:
-  typedef std::map<wchar_t, LangId> WCharToLangIdMap;
+  typedef std::map<LangId, ReplacementMatcher> LangIdToReplacementMatcherMap;
 
   const AbstractLangIdResolver& m_langIdResolver;
   LangId m_defaultLangId;
   int m_digitsMode;
   bool m_capitalization, m_separation;
-  WCharToLangIdMap m_charsTable;
-  WCharToWStringMap m_specialValues;
-  ReplacementVector m_replacements;
+  CharTable<LangId> m_charsTable;
+  CharTable<std::wstring> m_specialValues;
+  LangIdToReplacementMatcherMap m_replacements;
 }; //class TextProcessor;
 
 #endif //__VOICEMAN_TEXT_PROCESSOR_H__
@@ -0,0 +1,125 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"UtteranceTrace.h"
+
+bool utteranceTracing = 0;
+
+//Names of events reported by executor have the same order as stages;
+static const char* stageNames[TraceStageCount] = {
+  "read",
+  "parse",
+  "process",
+  "assign",
+  "write",
+  "received",
+  "synthstart",
+  "playerstart",
+  "firstpcm",
+  "playerexit"
+};
+
+//Orders passed stages by time, launch order of synthesizer and player depends on the executor mode;
+struct StageTimeLess
+{
+  StageTimeLess(const double* s)
+    : stamps(s) {}
+
+  bool operator()(int a, int b) const
+  {
+    return stamps[a] < stamps[b] || (stamps[a] == stamps[b] && a < b);
+  }
+
+  const double* stamps;
+}; //struct StageTimeLess;
+
+double getMonotonicTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+int UtteranceTrace::getFirstStage() const
+{
+  const StageTimeLess less(stamps);
+  int first = TraceStageNone;
+  for(int i = 0;i < TraceStageCount;i++)
+    if (stamps[i] != 0 && (first == TraceStageNone || less(i, first)))
+      first = i;
+  return first;
+}
+
+double UtteranceTrace::getDuration(int stage) const
+{
+  assert(stage >= 0 && stage < TraceStageCount);
+  if (stamps[stage] == 0)
+    return -1;
+  const StageTimeLess less(stamps);
+  int prev = TraceStageNone;
+  for(int i = 0;i < TraceStageCount;i++)
+    if (stamps[i] != 0 && less(i, stage) && (prev == TraceStageNone || less(prev, i)))
+      prev = i;
+  if (prev == TraceStageNone)
+    return -1;
+  return stamps[stage] - stamps[prev];
+}
+
+double UtteranceTrace::getAudioStartLatency() const
+{
+  const int first = getFirstStage();
+  if (first == TraceStageNone)
+    return -1;
+  if (stamps[TraceStageFirstPcm] != 0)
+    return stamps[TraceStageFirstPcm] - stamps[first];
+  if (stamps[TraceStagePlayerStart] != 0)
+    return stamps[TraceStagePlayerStart] - stamps[first];
+  return -1;
+}
+
+std::string UtteranceTrace::format() const
+{
+  std::ostringstream s;
+  s.setf(std::ios::fixed);
+  s.precision(3);
+  std::vector<int> passed;
+  for(int i = 0;i < TraceStageCount;i++)
+    if (stamps[i] != 0)
+      passed.push_back(i);
+  if (passed.empty())
+    return "";
+  std::sort(passed.begin(), passed.end(), StageTimeLess(stamps));
+  for(size_t i = 1;i < passed.size();i++)
+    s << (i > 1?", ":"") << getStageName(passed[i]) << " +" << getDuration(passed[i]) * 1000 << " ms";
+  const double audioStart = getAudioStartLatency();
+  if (audioStart >= 0)
+    s << "; " << getStageName(passed.front()) << " to audio start " << audioStart * 1000 << " ms";
+  return s.str();
+}
+
+const char* getStageName(int stage)
+{
+  assert(stage >= 0 && stage < TraceStageCount);
+  return stageNames[stage];
+}
+
+int traceStageByEventName(const std::string& name)
+{
+  for(int i = TraceStageReceived;i < TraceStageCount;i++)
+    if (name == stageNames[i])
+      return i;
+  return TraceStageNone;
+}
@@ -0,0 +1,135 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_UTTERANCE_TRACE_H__
+#define __VOICEMAN_UTTERANCE_TRACE_H__
+
+enum {
+  TraceStageRead = 0,
+  TraceStageParse,
+  TraceStageProcess,
+  TraceStageAssign,
+  TraceStageWrite,
+  TraceStageReceived,
+  TraceStageSynthStart,
+  TraceStagePlayerStart,
+  TraceStageFirstPcm,
+  TraceStagePlayerExit,
+  TraceStageCount
+};
+
+enum {TraceStageNone = -1};
+
+/**\brief Is latency tracing of text blocks enabled*/
+extern bool utteranceTracing;
+
+/**\brief Returns the time of CLOCK_MONOTONIC clock in seconds*/
+double getMonotonicTime();
+
+/**\brief Timestamps of stages a text block passes through
+ *
+ * This structure keeps the time when a text block has finished each
+ * stage of its processing, from reading of client data up to the end of
+ * its playback. The daemon stages are marked in the daemon itself, the
+ * executor stages are reported by executor process (see
+ * executorCommandHeader.h). Both processes use CLOCK_MONOTONIC clock, so
+ * the timestamps can be compared with each other. Zero value means the
+ * stage was not passed. Stages are marked only if tracing is enabled by
+ * the configuration.
+ *
+ * \sa ExecutorInterface
+ */
+struct UtteranceTrace
+{
+  /**\brief The default constructor*/
+  UtteranceTrace()
+  {
+    clear();
+  }
+
+  /**\brief Resets all timestamps*/
+  void clear()
+  {
+    for(size_t i = 0;i < TraceStageCount;i++)
+      stamps[i] = 0;
+  }
+
+  /**\brief Saves current time as the end of the stage
+   *
+   * \param [in] stage The stage to mark
+   */
+  void mark(int stage)
+  {
+    assert(stage >= 0 && stage < TraceStageCount);
+    if (utteranceTracing)
+      stamps[stage] = getMonotonicTime();
+  }
+
+  /**\brief Returns the first passed stage
+   *
+   * \return The stage identifier or TraceStageNone if no stages were passed
+   */
+  int getFirstStage() const;
+
+  /**\brief Returns the duration of the stage
+   *
+   * The duration is counted from the end of the previous passed stage in
+   * time order.
+   *
+   * \param [in] stage The stage to get duration of
+   *
+   * \return The duration in seconds or negative value if the stage is not passed or it is the first one
+   */
+  double getDuration(int stage) const;
+
+  /**\brief Returns the time from the first passed stage to the start of audio
+   *
+   * The start of audio is the first audio data or the player launch if
+   * there is no information about audio data.
+   *
+   * \return The time in seconds or negative value if audio start is unknown
+   */
+  double getAudioStartLatency() const;
+
+  /**\brief Prepares human-readable latency breakdown
+   *
+   * Passed stages are ordered by time and followed by their durations
+   * and the time to the start of audio.
+   *
+   * \return The string with the durations of stages in milliseconds
+   */
+  std::string format() const;
+
+  /**\brief The stage end times in seconds*/
+  double stamps[TraceStageCount];
+}; //struct UtteranceTrace;
+
+/**\brief Returns the name of the stage
+ *
+ * \param [in] stage The stage identifier
+ *
+ * \return The stage name, the same as executor event name for executor stages
+ */
+const char* getStageName(int stage);
+
+/**\brief Finds the executor stage by the name of its event
+ *
+ * \param [in] name The event name reported by executor
+ *
+ * \return The stage identifier or TraceStageNone if the name is unknown
+ */
+int traceStageByEventName(const std::string& name);
+
+#endif //__VOICEMAN_UTTERANCE_TRACE_H__
@@ -18,9 +18,7 @@
 
 void VoicemanProtocol::process(const std::wstring& s, Client& client)
 {
-  std::string infoStr = encodeUTF8(s);
-  removeNewLineChars(infoStr);
-  logMsg(LOG_DEBUG, "Protocol parser is parsing string \'%s\'", infoStr.c_str());
+  VM_LOG_DEBUG("Protocol parser is parsing string \'%s\'", encodeUTF8(s).c_str());
   wchar_t cmd;
   std::wstring arg;//probably argument must be parsed as std:;string;
   if (!split(s, cmd, arg))
@@ -31,6 +29,7 @@ void VoicemanProtocol::process(const std::wstring& s, Client& client)
   switch(cmd)
     {
     case 'T':
+      client.trace.mark(TraceStageParse);
       m_handler.onText(client, arg);
       break;
     case 'L':
@@ -57,6 +56,9 @@ void VoicemanProtocol::process(const std::wstring& s, Client& client)
     case 'M':
       m_handler.onProcMode(client, encodeUTF8(arg));
       break;
+    case 'I':
+      m_handler.onStats(client);
+      break;
     default:
       logMsg(LOG_WARNING, "Rejecting client command with unknown command code %d (line=\'%s\')", cmd, WString2IO(s).c_str());
     } //switch(cmd);
@@ -82,6 +84,7 @@ void VoicemanProtocol::parseLetter(const std::wstring& value, Client& client)
       logMsg(LOG_WARNING, "Argument of LETTER command has an invalid length. (arg=%s), ignoring...", WString2IO(value).c_str());
       return;
     }
+  client.trace.mark(TraceStageParse);
   m_handler.onLetter(client, value[0]);
 }
 
@@ -86,6 +86,16 @@ public:
    */
   virtual void onTone(Client& client, size_t freq, size_t duration) = 0;
 
+  /**\brief Notifies the command to send runtime statistics was received
+   *
+   * This method is called by protocol implementation object each time when
+   * a client asks for the daemon statistics. The statistics report must
+   * be sent back to this client.
+   *
+   * \param [in] client The client object this command was received from
+   */
+  virtual void onStats(Client& client) = 0;
+
   /**\brief Notifies the command to select another processing mode was received
    *
    * This method is called by protocol implementation class on each command
@@ -0,0 +1,54 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include"voiceman.h"
+#include"WStringTrie.h"
+
+void WStringTrie::add(const std::wstring& str, size_t value)
+{
+  if (str.empty())
+    return;
+  size_t node = 0;
+  for(std::wstring::size_type i = 0;i < str.length();i++)
+    {
+      size_t next = getChild(node, str[i]);
+      if (next == NoNode)
+	{
+	  next = m_nodes.size();
+	  m_nodes.push_back(Node());
+	  EdgeVector& edges = m_nodes[node].edges;
+	  edges.insert(std::upper_bound(edges.begin(), edges.end(), Edge(str[i], 0)), Edge(str[i], next));
+	}
+      node = next;
+    } //for();
+  if (m_nodes[node].value == NoValue || value < m_nodes[node].value)
+    m_nodes[node].value = value;
+}
+
+void WStringTrie::clear()
+{
+  m_nodes.clear();
+  m_nodes.push_back(Node());
+}
+
+size_t WStringTrie::getChild(size_t node, wchar_t c) const
+{
+  assert(node < m_nodes.size());
+  const EdgeVector& edges = m_nodes[node].edges;
+  EdgeVector::const_iterator it = std::lower_bound(edges.begin(), edges.end(), Edge(c, 0));
+  if (it == edges.end() || it->ch != c)
+    return NoNode;
+  return it->node;
+}
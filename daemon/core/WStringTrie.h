@@ -0,0 +1,131 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_WSTRING_TRIE_H__
+#define __VOICEMAN_WSTRING_TRIE_H__
+
+/**\brief The prefix tree of strings for fast multi-pattern matching
+ *
+ * This class stores a set of strings with associated numeric values and
+ * lets find all of them starting at given position of a text in one
+ * pass over the text characters instead of comparing each string
+ * separately. Values are usually indices of the items in some ordered
+ * rule list, if the same string is added several times the smallest
+ * value is kept.
+ *
+ * \sa ReplacementMatcher
+ */
+class WStringTrie
+{
+public:
+  enum {NoNode = (size_t)-1, NoValue = (size_t)-1};
+
+  /**\brief The default constructor*/
+  WStringTrie()
+  {
+    clear();
+  }
+
+  /**\brief The destructor*/
+  virtual ~WStringTrie() {}
+
+  /**\brief Adds new string to the tree
+   *
+   * If the same string was already added, the smaller value is kept.
+   * Empty strings are ignored.
+   *
+   * \param [in] str The string to add
+   * \param [in] value The value associated with the string
+   */
+  void add(const std::wstring& str, size_t value);
+
+  /**\brief Returns the root node of the tree
+   *
+   * \return The root node of the tree
+   */
+  size_t getRoot() const
+  {
+    return 0;
+  }
+
+  /**\brief Returns the child node by character
+   *
+   * Walking over the text is performed by consecutive calls of this
+   * method starting from the root node, until NoNode is returned.
+   *
+   * \param [in] node The node to get child of
+   * \param [in] c The character of the edge to the child
+   *
+   * \return The child node or NoNode if there is no such child
+   */
+  size_t getChild(size_t node, wchar_t c) const;
+
+  /**\brief Returns the value of the string ending at the node
+   *
+   * \param [in] node The node to get value of
+   *
+   * \return The value of the string or NoValue if there is no string ending at this node
+   */
+  size_t getValue(size_t node) const
+  {
+    assert(node < m_nodes.size());
+    return m_nodes[node].value;
+  }
+
+  /**\brief Removes all strings from the tree*/
+  void clear();
+
+  /**\brief Checks if there are no strings in the tree
+   *
+   * \return Non-zero if the tree is empty or zero otherwise
+   */
+  bool isEmpty() const
+  {
+    return m_nodes.size() == 1;
+  }
+
+private:
+  struct Edge
+  {
+    Edge(wchar_t c, size_t n)
+      : ch(c), node(n) {}
+
+    bool operator <(const Edge& e) const
+    {
+      return ch < e.ch;
+    }
+
+    wchar_t ch;
+    size_t node;
+  }; //struct Edge;
+
+  typedef std::vector<Edge> EdgeVector;
+
+  struct Node
+  {
+    Node()
+      : value(NoValue) {}
+
+    size_t value;
+    EdgeVector edges;//sorted by characters;
+  }; //struct Node;
+
+  typedef std::vector<Node> NodeVector;
+
+private:
+  NodeVector m_nodes;
+}; //class WStringTrie;
+
+#endif //__VOICEMAN_WSTRING_TRIE_H__
@@ -18,6 +18,9 @@
 
 #include"TextParam.h"
 #include"TextItem.h"
+#include"UtteranceTrace.h"
+#include"DaemonStats.h"
+#include"SessionCapture.h"
 #include"Output.h"
 #include"OutputSet.h"
 #include"AbstractTextProcessor.h"
@@ -37,7 +37,7 @@ static void addVectorItem(const std::string& str, WStringVector& items)
 
 void RusLang::load(const std::string& fileName)
 {
-  logMsg(LOG_DEBUG, "Loading Russian language constants from %s", fileName.c_str());
+  VM_LOG_DEBUG("Loading Russian language constants from %s", fileName.c_str());
   std::string fileText = readTextFile(fileName);
   fileText = cutComments(fileText);
   StringList lines;
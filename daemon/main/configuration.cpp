@@ -35,6 +35,8 @@ VOICEMAN_BEGIN_PARAM_TABLE(VoicemanConfigFile)
 VOICEMAN_DECLARE_PARAM("global", "startupmessage");
 VOICEMAN_DECLARE_STRING_PARAM("global", "loglevel");
 VOICEMAN_DECLARE_STRING_PARAM("global", "logfile");
+VOICEMAN_DECLARE_BOOLEAN_PARAM("global", "tracelatency");
+VOICEMAN_DECLARE_STRING_PARAM("global", "capturefile");
 
 VOICEMAN_DECLARE_STRING_PARAM("global", "socket");
 VOICEMAN_DECLARE_UINT_PARAM("global", "inetsocketport");
@@ -71,10 +73,18 @@ VOICEMAN_DECLARE_DOUBLE_PARAM("output", "volumemax");
 VOICEMAN_DECLARE_DOUBLE_PARAM("output", "volumeaver");
 VOICEMAN_DECLARE_UINT_PARAM("output", "volumenumdigitsafterdot");
 VOICEMAN_DECLARE_STRING_PARAM("output", "caplist");
+VOICEMAN_DECLARE_BOOLEAN_PARAM("output", "persistent");
+VOICEMAN_DECLARE_UINT_PARAM("output", "minchunklength");
+VOICEMAN_DECLARE_UINT_PARAM("output", "maxchunklength");
+VOICEMAN_DECLARE_UINT_PARAM("output", "samplerate");
+VOICEMAN_DECLARE_UINT_PARAM("output", "channels");
+VOICEMAN_DECLARE_STRING_PARAM("output", "sampleformat");
 
 //Playback;
 VOICEMAN_DECLARE_STRING_PARAM("playback", "executor");
 VOICEMAN_DECLARE_STRING_PARAM("playback", "player");
+VOICEMAN_DECLARE_STRING_PARAM("playback", "libaodriver");
+VOICEMAN_DECLARE_UINT_PARAM("playback", "lookahead");
 
 VOICEMAN_RELAX_SECTION("characters");
 VOICEMAN_RELAX_SECTION("families");
@@ -85,6 +95,7 @@ void initConfigData(Configuration& c)
 {
   c.logLevel = LOG_WARNING;
   c.logFileName = "syslog";
+  c.traceLatency = 0;
   c.unixDomainSocketFileName = "";
   c.useInetSocket = 0;
   c.inetSocketPort = VOICEMAN_DEFAULT_PORT;
@@ -103,6 +114,8 @@ void initConfigData(Configuration& c)
   c.testConfiguration = 0;
   c.executor = VOICEMAN_DEFAULT_EXECUTOR;
   c.playerType = PlayerTypeAlsa;
+  c.libaoDriver = "";
+  c.lookahead = 0;
   c.outputs.clear();
   c.characters.clear();
 }
@@ -186,6 +199,27 @@ static void processOutputsConfiguration(const LangManager& langs, const Voiceman
 	outputConfiguration.pulseaudioPlayerCommand = trim(section["pulseaudioplayercommand"]);
       if (section.has("pcspeakerplayercommand"))
 	outputConfiguration.pcspeakerPlayerCommand = trim(section["pcspeakerplayercommand"]);
+      if (section.has("persistent"))
+	outputConfiguration.persistent = parseAsBool(section["persistent"]);
+      //splitting of long text items;
+      processUnsignedIntParameter(section, outputConfiguration.minChunkLength, "minchunklength", "min chunk length", outputConfiguration.name);
+      processUnsignedIntParameter(section, outputConfiguration.maxChunkLength, "maxchunklength", "max chunk length", outputConfiguration.name);
+      if (outputConfiguration.maxChunkLength != 0 && outputConfiguration.minChunkLength > outputConfiguration.maxChunkLength)
+	VMC_STOP("Output '" + outputConfiguration.name + "' has 'min chunk length' parameter greater than 'max chunk length'");
+      //audio format for libao player;
+      processUnsignedIntParameter(section, outputConfiguration.sampleRate, "samplerate", "sample rate", outputConfiguration.name);
+      if (outputConfiguration.sampleRate == 0)
+	VMC_STOP("Output '" + outputConfiguration.name + "' has zero 'sample rate' parameter");
+      processUnsignedIntParameter(section, outputConfiguration.channels, "channels", "channels", outputConfiguration.name);
+      if (outputConfiguration.channels < 1 || outputConfiguration.channels > 8)
+	VMC_STOP("Parameter 'channels' must be integer number in range from 1 to 8; Value '" + section["channels"] + "' for output '" + outputConfiguration.name + "' is illegal;");
+      if (section.has("sampleformat"))
+	{
+	  const std::string value = trim(toLower(section["sampleformat"]));
+	  if (value != "s8" && value != "u8" && value != "s16le" && value != "s16be")
+	    VMC_STOP("Output '" + outputConfiguration.name + "' has unsupported sample format '" + value + "' (can be 's8', 'u8', 's16le' or 's16be')");
+	  outputConfiguration.sampleFormat = value;
+	}
       //pitch;
       processDoubleParameter(section, outputConfiguration.pitch.min, "pitchmin", "pitch min", outputConfiguration.name);
       processDoubleParameter(section, outputConfiguration.pitch.max, "pitchmax", "pitch max", outputConfiguration.name);
@@ -331,6 +365,10 @@ static void processPlaybackConfiguration(const CmdArgsParser& cmdLine, const Voi
 	executor = sec["executor"];
       if (sec.has("player"))
 	player = sec["player"];
+      if (sec.has("libaodriver"))
+	c.libaoDriver = trim(sec["libaodriver"]);
+      if (sec.has("lookahead"))
+	c.lookahead = parseAsUnsignedInt(sec["lookahead"]);
     }
   if (cmdLine.used("executor"))
     executor = cmdLine["executor"];
@@ -347,6 +385,8 @@ static void processPlaybackConfiguration(const CmdArgsParser& cmdLine, const Voi
 	c.playerType = PlayerTypePulseaudio; else
       if (player == "pcspeaker")
 	c.playerType = PlayerTypePcspeaker; else
+      if (player == "libao")
+	c.playerType = PlayerTypeLibao; else
 	VMC_STOP("Unknown player type \'" + player + "\'");
     }
 }
@@ -423,7 +463,12 @@ void prepareConfiguration(const LangManager& langs, const CmdArgsParser& cmdLine
   if (c.useInetSocket && c.inetSocketPort >= 65536)
     VMC_STOP("Inet socket port too large (" + trim(global["inetsocketport"]) + " >= 65536)");
   if (global.has("logfile"))
-    c.logFileName = global["logfile"];  if (global.has("maxclients"))
+    c.logFileName = global["logfile"];
+  if (global.has("tracelatency"))
+    c.traceLatency = parseAsBool(global["tracelatency"]);
+  if (global.has("capturefile"))
+    c.captureFileName = trim(global["capturefile"]);
+  if (global.has("maxclients"))
     c.maxClients = parseAsUnsignedInt(global["maxclients"]);
   if (global.has("maxinputline"))
     c.maxInputLine = parseAsUnsignedInt(global["maxinputline"]);
@@ -505,6 +550,12 @@ static void printOutputsConfiguration(const LangManager& langs, const Configurat
       std::cout << "alsa player command = " << o.alsaPlayerCommand << std::endl;
       std::cout << "pulseaudio player command = " << o.pulseaudioPlayerCommand << std::endl;
       std::cout << "pc speaker player command = " << o.pcspeakerPlayerCommand << std::endl;
+      std::cout << "persistent = " << boolToString(o.persistent) << std::endl;
+      std::cout << "min chunk length = " << o.minChunkLength << std::endl;
+      std::cout << "max chunk length = " << o.maxChunkLength << (o.maxChunkLength != 0?"":" (not split)") << std::endl;
+      std::cout << "sample rate = " << o.sampleRate << std::endl;
+      std::cout << "channels = " << o.channels << std::endl;
+      std::cout << "sample format = " << o.sampleFormat << std::endl;
       std::cout << "replacements = " << o.replacementsFileName << std::endl;
       printOutputParamConfiguration(o.pitch, "pitch");
       printOutputParamConfiguration(o.rate, "rate");
@@ -535,6 +586,8 @@ void printConfiguration(const LangManager& langs, const Configuration& c)
   std::cout << "Global attributes:" << std::endl;
   std::cout << "log level = " << logLevelToString(c.logLevel) << std::endl;
   std::cout << "log file = " << c.logFileName << std::endl;
+  std::cout << "trace latency = " << boolToString(c.traceLatency) << std::endl;
+  std::cout << "capture file = " << (c.captureFileName.empty()?"(not used)":c.captureFileName) << std::endl;
   std::cout << "socket = " << c.unixDomainSocketFileName << std::endl;
   std::cout << "use inet socket = " << boolToString(c.useInetSocket) << std::endl;
   std::cout << "inet socket port = " << c.inetSocketPort << std::endl;
@@ -577,10 +630,16 @@ void printConfiguration(const LangManager& langs, const Configuration& c)
     case PlayerTypePcspeaker:
       std::cout << "pcspeaker" << std::endl;
       break;
+    case PlayerTypeLibao:
+      std::cout << "libao" << std::endl;
+      break;
     default:
       assert(0);
       std::cout << std::endl;
     }; //switch(c.playerType);
+  if (c.playerType == PlayerTypeLibao)
+    std::cout << "libao driver = " << (c.libaoDriver.empty()?"default":c.libaoDriver) << std::endl;
+  std::cout << "lookahead = " << c.lookahead << (c.lookahead != 0?"":" (disabled)") << std::endl;
   if (!c.characters.empty())
     {
       std::cout << std::endl;
@@ -32,10 +32,14 @@ struct OutputParamConfiguration
 struct OutputConfiguration
 {
   OutputConfiguration()
-    : langId(LANG_ID_NONE) {}
+    : langId(LANG_ID_NONE), persistent(0), minChunkLength(0), maxChunkLength(0), sampleRate(22050), channels(1), sampleFormat("s16le") {}
 
   std::string name, family;
   LangId langId;
+  bool persistent;
+  size_t minChunkLength, maxChunkLength;//zero maximum means no splitting of text items;
+  size_t sampleRate, channels;
+  std::string sampleFormat;
   std::string synthCommand, alsaPlayerCommand, pulseaudioPlayerCommand, pcspeakerPlayerCommand;
   std::string replacementsFileName;
   WCharToWStringMap capList;
@@ -50,6 +54,8 @@ struct Configuration
   //logging;
   int logLevel;
   std::string logFileName;
+  bool traceLatency;
+  std::string captureFileName; //empty means not used;
 
   //sockets;
   std::string unixDomainSocketFileName; //empty means not used;
@@ -72,6 +78,8 @@ struct Configuration
   //Playback;
   std::string executor;
   PlayerType playerType;
+  std::string libaoDriver;//empty means default driver;
+  size_t lookahead;//number of queued text blocks synthesized while the current one is played, zero disables it;
 
   //startup;
   bool daemonMode;
@@ -19,7 +19,7 @@
 #include"configuration.h"
 #include"system/sockets.h"
 #include"core/AbstractTextProcessor.h"
-#include"DelimitedFile.h"
+#include"system/DelimitedFile.h"
 
 #define CHARS_TABLE_FILE_NAME "chars-table"
 #define REPLACEMENTS_ALL_FILE_NAME "replacements.all"
@@ -40,7 +40,7 @@ CmdArg cmdLineParams[] = {
   {'m', "message", "TEXT", "set startup message text;"},
   {'o', "port", "NUMBER", "enable inet socket at port NUMBER;"},
   {'p', "pidfile", "FILE_NAME", "put pid of server process to FILE_NAME;"},
-  {'P', "player", "TYPE", "use specified player type (can be \'alsa\', \'pulseaudio\' or \'pcspeaker\');"},
+  {'P', "player", "TYPE", "use specified player type (can be \'alsa\', \'pulseaudio\', \'pcspeaker\' or \'libao\');"},
   {'s', "socket", "FILE_NAME", "enable UNIX domain socket at path FILE_NAME;"},
   {'S', "say", "TEXT", "say TEXT and exit;"},
   {'t', "test", "", "only load and show configuration information."},
@@ -61,6 +61,12 @@ void sigPipeHandler(int r)
   wasSigPipe = 1;
 }
 
+volatile sig_atomic_t wasSigTerm = 0;
+void sigTermHandler(int r)
+{
+  wasSigTerm = 1;
+}
+
 void fillOutputListByConfiguration(const OutputConfigurationVector& outputConfigurations, OutputList& outputList)
 {
   outputList.clear();
@@ -76,6 +82,9 @@ void fillOutputListByConfiguration(const OutputConfigurationVector& outputConfig
       o.setAlsaPlayerCommand(oc.alsaPlayerCommand);
       o.setPulseaudioPlayerCommand(oc.pulseaudioPlayerCommand);
       o.setPcspeakerPlayerCommand(oc.pcspeakerPlayerCommand);
+      o.setPersistent(oc.persistent);
+      o.setChunkLength(oc.minChunkLength, oc.maxChunkLength);
+      o.setAudioFormat(oc.sampleRate, oc.channels, oc.sampleFormat);
       o.setPitchFormat(oc.pitch.numDigitsAfterDot, oc.pitch.min, oc.pitch.aver, oc.pitch.max);
       o.setRateFormat(oc.rate.numDigitsAfterDot, oc.rate.min, oc.rate.aver, oc.rate.max);
       o.setVolumeFormat(oc.volume.numDigitsAfterDot, oc.volume.min, oc.volume.aver, oc.volume.max);
@@ -83,7 +92,7 @@ void fillOutputListByConfiguration(const OutputConfigurationVector& outputConfig
 	{
 	  DelimitedFile f;
 	  f.read(oc.replacementsFileName);
-	  logMsg(LOG_DEBUG, "Read %u records from %s", f.getLineCount(), oc.replacementsFileName.c_str());
+	  VM_LOG_DEBUG("Read %u records from %s", f.getLineCount(), oc.replacementsFileName.c_str());
 	  for(size_t i = 0;i < f.getLineCount();i++)
 	    {
 	      if (f.getItemCountInLine(i) != 2)
@@ -103,11 +112,23 @@ void fillOutputListByConfiguration(const OutputConfigurationVector& outputConfig
 	} //replacements reading;
       for(WCharToWStringMap::const_iterator it = oc.capList.begin();it != oc.capList.end();it++)
 	o.addCapMapItem(it->first, it->second);
-      logMsg(LOG_DEBUG, "Adding output \'%s\' to output set", outputConfigurations[i].name.c_str());
+      VM_LOG_DEBUG("Adding output \'%s\' to output set", outputConfigurations[i].name.c_str());
       outputList.push_back(o);
     } //for(m_configuration.outputs);
 }
 
+void startCapture(const std::string& fileName)
+{
+  if (fileName.empty())
+    {
+      sessionCapture.close();
+      return;
+    }
+  if (sessionCapture.open(fileName))
+    logMsg(LOG_INFO, "Capturing client sessions to '%s'", fileName.c_str()); else
+    logMsg(LOG_ERR, "Could not open capture file '%s' (%s), client sessions are not captured", fileName.c_str(), ERRNO_MSG);
+}
+
 /**\brief Processes all client commands
  *
  * ProtocolHandler class processes all commands received from all
@@ -183,7 +204,7 @@ bool lettersAtMinRate)
     const AbstractTextProcessor* textProc = selectTextProc(client.selectedTextProcessor);
     if (textProc == NULL)
       return;//all log messages must be in selectTextProc();
-    logMsg(LOG_DEBUG, "Processing \'TEXT\' command with processor \'%s\'", client.selectedTextProcessor.c_str());
+    VM_LOG_DEBUG("Processing \'TEXT\' command with processor \'%s\'", client.selectedTextProcessor.c_str());
     //Preparing text item to provide into text processor;
     TextItem textItem(t);
     textItem.setPitch(client.pitch);
@@ -191,12 +212,24 @@ bool lettersAtMinRate)
     textItem.setVolume(client.volume);
     TextItemList textItemList;
     textProc->process(textItem, textItemList);
-    logMsg(LOG_DEBUG, "Text processor generated %u text item(s)", textItemList.size());
+    client.trace.mark(TraceStageProcess);
+    daemonStats.textProcessorItems[client.selectedTextProcessor] += textItemList.size();
+    VM_LOG_DEBUG("Text processor generated %u text item(s)", textItemList.size());
     //OK, now we have the set of splitted items, but output information is omitted in it, only language specifications;
     TextItemList preparedTextItems;
     assignOutput(client, textItemList, preparedTextItems);
+    client.trace.mark(TraceStageAssign);
+    //Long items are split by outputs, so the first chunk is played while the next ones are synthesized;
     for(TextItemList::const_iterator it = preparedTextItems.begin();it != preparedTextItems.end();it++)
-      m_executorInterface.sayOrEnqueue(*it);
+      {
+	TextItemList chunks;
+	m_outputSet.splitToChunks(it->getOutputHandle(), *it, chunks);
+	if (chunks.size() > 1)
+	  VM_LOG_DEBUG("Text item was split into %u chunks", chunks.size());
+	//Only the first chunk is checked against executor queue limit, the rest follows it;
+	for(TextItemList::const_iterator chunkIt = chunks.begin();chunkIt != chunks.end();chunkIt++)
+	  m_executorInterface.sayOrEnqueue(*chunkIt, client.trace, chunkIt != chunks.begin());
+      }
   }
 
   /**\brief Notifies the command to say one letter was received from client
@@ -213,16 +246,19 @@ bool lettersAtMinRate)
     const AbstractTextProcessor* textProc = selectTextProc(client.selectedTextProcessor);
     if (textProc == NULL)
       return;//all log messages must be in selectTextProc();
-    logMsg(LOG_DEBUG, "Processing \'LETTER\' command with processor \'%s\'", client.selectedTextProcessor.c_str());
+    VM_LOG_DEBUG("Processing \'LETTER\' command with processor \'%s\'", client.selectedTextProcessor.c_str());
     //Preparing text item to provide into text processor;
     TextItemList textItemList;
     textProc->processLetter(c, client.volume, client.pitch, m_lettersAtMinRate?0:client.rate, textItemList);
-    logMsg(LOG_DEBUG, "Text processor generated %u text items", textItemList.size());
+    client.trace.mark(TraceStageProcess);
+    daemonStats.textProcessorItems[client.selectedTextProcessor] += textItemList.size();
+    VM_LOG_DEBUG("Text processor generated %u text items", textItemList.size());
     //OK, now we have the set of splitted items, but output information is omitted in it, only language specifications;
     TextItemList preparedTextItems;
     assignOutput(client, textItemList, preparedTextItems);
+    client.trace.mark(TraceStageAssign);
     for(TextItemList::const_iterator it = preparedTextItems.begin();it != preparedTextItems.end();it++)
-      m_executorInterface.sayOrEnqueue(*it);
+      m_executorInterface.sayOrEnqueue(*it, client.trace);
   }
 
   /**\brief Notifies new command to stop playback was received from client
@@ -235,7 +271,7 @@ bool lettersAtMinRate)
    */
   void onStop(Client& client)
   {
-    logMsg(LOG_DEBUG, "Processing \'STOP\' command");
+    VM_LOG_DEBUG("Processing \'STOP\' command");
     m_executorInterface.stop();
   }
 
@@ -254,15 +290,15 @@ bool lettersAtMinRate)
     switch(paramType)
       {
       case ParamVolume:
-	logMsg(LOG_DEBUG, "Setting volume value to %u", value.getValue());
+	VM_LOG_DEBUG("Setting volume value to %u", value.getValue());
 	client.volume = value;
 	break;
       case ParamPitch:
-	logMsg(LOG_DEBUG, "Setting pitch value to %u", value.getValue());
+	VM_LOG_DEBUG("Setting pitch value to %u", value.getValue());
 	client.pitch = value;
 	break;
       case ParamRate:
-	logMsg(LOG_DEBUG, "Setting rate value to %u", value.getValue());
+	VM_LOG_DEBUG("Setting rate value to %u", value.getValue());
 	client.rate = value;
 	break;
       default:
@@ -292,10 +328,26 @@ bool lettersAtMinRate)
 	logMsg(LOG_WARNING, "Tone command has illegal duration value %u", duration);
 	return;
       }
-    logMsg(LOG_DEBUG, "Sending \'TONE\' command with frequency %u and duration %u", freq, duration);
+    VM_LOG_DEBUG("Sending \'TONE\' command with frequency %u and duration %u", freq, duration);
     m_executorInterface.tone(freq, duration);
   }
 
+  /**\brief Notifies the command to send runtime statistics was received
+   *
+   * This method puts the statistics report to the output buffer of the
+   * client. The main loop writes it to the socket as soon as the client
+   * is able to receive it.
+   *
+   * \param [in] client The client object this command was received from
+   */
+  void onStats(Client& client)
+  {
+    VM_LOG_DEBUG("Processing \'STATS\' command");
+    if (client.socket.get() == NULL)
+      return;
+    client.output += daemonStats.format();
+  }
+
   /**\brief Notifies the command to select another processing mode was received
    *
    * This method is called by protocol implementation class on each command
@@ -314,7 +366,7 @@ bool lettersAtMinRate)
 	logMsg(LOG_WARNING, "Unknown text processing mode \'%s\', rejecting client command", procMode.c_str());
 	return;
       }
-    logMsg(LOG_DEBUG, "Selecting text processing mode \'%s\'", value.c_str());
+    VM_LOG_DEBUG("Selecting text processing mode \'%s\'", value.c_str());
     client.selectedTextProcessor = value;
   }
 
@@ -360,7 +412,7 @@ bool lettersAtMinRate)
 	      clientIt->second = family; else 
 	      client.selectedFamilies.insert(LangIdToStringMap::value_type(it->first, family));
 	  } //for(m_defaultFamilies);
-	logMsg(LOG_DEBUG, "Selecting family \'%s\' for all languages with corresponding output", family.c_str());
+	VM_LOG_DEBUG("Selecting family \'%s\' for all languages with corresponding output", family.c_str());
 	return;
       }
     if (!m_outputSet.isValidFamilyName(langId, family))
@@ -372,7 +424,7 @@ bool lettersAtMinRate)
     if (it != client.selectedFamilies.end())
       it->second = family; else 
       client.selectedFamilies.insert(LangIdToStringMap::value_type(langId, family));
-    logMsg(LOG_DEBUG, "Selected family \'%s\' for language \'%s\'", family.c_str(), lang.c_str());
+    VM_LOG_DEBUG("Selected family \'%s\' for language \'%s\'", family.c_str(), lang.c_str());
   }
 
 private:
@@ -396,12 +448,13 @@ private:
 	    logMsg(LOG_WARNING, "Could not find proper voice family for text item, skipping...");
 	    continue;
 	  }
-	if (!m_outputSet.isValidFamilyName(langId, familyName))
+	const OutputHandle outputHandle = m_outputSet.findOutput(familyName, langId);
+	if (outputHandle == OUTPUT_HANDLE_NONE)
 	  {
 	    logMsg(LOG_ERR, "Output set had rejected family name \'%s\', skipping text item...", familyName.c_str());
 	    continue;
 	  }
-	it->setOutputName(m_outputSet.getOutputNameByFamilyAndLangId(familyName, langId));
+	it->setOutputHandle(outputHandle);
 	preparedItems.push_back(*it);
       } //for(items);
   }
@@ -424,7 +477,7 @@ private:
 
   auto_ptr<AbstractTextProcessor> prepareTextProcessor(const std::string& name, const Configuration& c, const std::string& replacementsFileName, const std::string& charsTableFileName)
   {
-    logMsg(LOG_DEBUG, "Creating \'%s\' text processor (replacementsFileName =%s, charsTableFIleName=%s)", name.c_str(), replacementsFileName.c_str(), charsTableFileName.c_str());
+    VM_LOG_DEBUG("Creating \'%s\' text processor (replacementsFileName =%s, charsTableFIleName=%s)", name.c_str(), replacementsFileName.c_str(), charsTableFileName.c_str());
     auto_ptr<AbstractTextProcessor> textProc = createNewTextProcessor(langManager, c.digitsMode, c.capitalization, c.separation);
     LangIdSet langIdSet;
     //Using only really required languages;
@@ -432,7 +485,7 @@ private:
       langIdSet.insert(c.outputs[i].langId);
     for(LangIdSet::const_iterator it = langIdSet.begin();it != langIdSet.end();it++)
       {
-	logMsg(LOG_DEBUG, "Adding \'%s\' language support to text processor \'%s\'", langManager.getLangName(*it).c_str(), name.c_str());
+	VM_LOG_DEBUG("Adding \'%s\' language support to text processor \'%s\'", langManager.getLangName(*it).c_str(), name.c_str());
 	const Lang* lang = langManager.getLangById(*it);
 	assert(lang != NULL);
 	std::wstring characters = lang->getAllChars();
@@ -445,7 +498,7 @@ private:
       {
 	if (langIdSet.find(c.defaultLangId) != langIdSet.end())
 	  {
-	    logMsg(LOG_DEBUG, "Default language is \'%s\'", langManager.getLangName(c.defaultLangId).c_str());
+	    VM_LOG_DEBUG("Default language is \'%s\'", langManager.getLangName(c.defaultLangId).c_str());
 	    textProc->setDefaultLangId(c.defaultLangId);
 	    LangIdToWStringMap::const_iterator defaultLangCharactersIt = c.characters.find(LANG_ID_NONE);
 	    if (defaultLangCharactersIt != c.characters.end())
@@ -456,7 +509,7 @@ private:
     //processing replacements file;
     DelimitedFile f;
     f.read(replacementsFileName);
-    logMsg(LOG_DEBUG, "Read %u records from %s", f.getLineCount(), replacementsFileName.c_str());
+    VM_LOG_DEBUG("Read %u records from %s", f.getLineCount(), replacementsFileName.c_str());
     for(size_t i = 0;i < f.getLineCount();i++)
       {
 	if (f.getItemCountInLine(i) != 3)
@@ -483,7 +536,7 @@ private:
       } //for(lines in replacements file);
     //processing characters table file;
     f.read(charsTableFileName);
-    logMsg(LOG_DEBUG, "Read %u records from \'%s\'", f.getLineCount(), charsTableFileName.c_str());
+    VM_LOG_DEBUG("Read %u records from \'%s\'", f.getLineCount(), charsTableFileName.c_str());
     for(size_t i = 0;i < f.getLineCount();i++)
       {
 	if (f.getItemCountInLine(i) != 2)
@@ -547,21 +600,28 @@ public:
    * \param [in] outputSet The reference to used output set object
    * \param [in] protocolHandler The reference to used protocol handler object
    * \param [in] executorInterface The reference to executor interface object
+   * \param [in] terminationFlag The reference to main loop termination flag
    */
-  SystemSignalHandler(ClientList& clients, OutputSet& outputSet, ProtocolHandler& protocolHandler, ExecutorInterface& executorInterface)
-    : m_clients(clients), m_outputSet(outputSet), m_protocolHandler(protocolHandler), m_executorInterface(executorInterface) {}
+  SystemSignalHandler(ClientList& clients, OutputSet& outputSet, ProtocolHandler& protocolHandler, ExecutorInterface& executorInterface, bool& terminationFlag)
+    : m_clients(clients), m_outputSet(outputSet), m_protocolHandler(protocolHandler), m_executorInterface(executorInterface), m_terminationFlag(terminationFlag) {}
 
   /**\brief The destructor*/
   virtual ~SystemSignalHandler() {}
 
   /**\brief Notifies there was system signal and it must be handled
    *
-   * This method is called by main loop class each time when pselect()
-   * system call is interrupted with EINTR exit code. It means the process
-   * have received system signal and it must be handled.
+   * This method is called by main loop class each time when it has
+   * received system signal and it must be handled.
    */
   void onSystemSignal()
   {
+    if (wasSigTerm)
+      {
+	wasSigTerm = 0;
+	logMsg(LOG_INFO, "Termination signal registered, shutting down");
+	m_terminationFlag = 1;
+	return;
+      }
     if (wasSigPipe)
       {
 	wasSigPipe = 0;
@@ -571,7 +631,8 @@ public:
     if (wasSigHup)
       {
 	wasSigHup = 0;
-	logMsg(LOG_DEBUG, "SIGHUP registered, reloading configuration");
+	reopenLogging();
+	VM_LOG_DEBUG("SIGHUP registered, reopening log file and reloading configuration");
 	Configuration c;
 	initConfigData(c);
 	try {
@@ -591,7 +652,9 @@ public:
 	fillOutputListByConfiguration(c.outputs, outputList);
 	m_outputSet.reinit(outputList);
 	m_protocolHandler.reinit(c);
-	logMsg(LOG_DEBUG, "resetting families preferences for %u clients", m_clients.size());
+	utteranceTracing = c.traceLatency;
+	startCapture(c.captureFileName);
+	VM_LOG_DEBUG("resetting families preferences for %u clients", m_clients.size());
 	for(ClientList::iterator it = m_clients.begin();it != m_clients.end();it++)
 	  (*it)->selectedFamilies.clear();
 	logMsg(LOG_INFO, "New configuration was successfully reloaded!");
@@ -603,6 +666,7 @@ private:
   OutputSet& m_outputSet;
   ProtocolHandler& m_protocolHandler;
   ExecutorInterface& m_executorInterface;
+  bool& m_terminationFlag;
 }; //class SystemSignalHandler;
 
 
@@ -627,48 +691,65 @@ public:
 
   /**\brief Processes new part of data from the client
    *
-   * This method receives new portion of data as single line of text,
-   * splits it to the proper line set, processes it with protocol object
-   * and controls incomplete line part.
+   * This method takes complete lines from the input buffer of the
+   * client, processes them with protocol object and controls incomplete
+   * line part. Lines are decoded directly from the buffer. If the line
+   * length reaches the limit, its beginning is processed and the rest is
+   * skipped until the line end.
    *
    * \param [in] client The reference to client object to handle data for
-   * \param [in] data The data to process
    */
-  void processClientData(Client& client, const std::string& data)
+  void processClientData(Client& client)
   {
-    std::string& buf = client.buf;
-    buf.reserve(m_maxInputLine);
-
-    for (std::string::size_type i = 0; i < data.length(); i++)
+    LineReader& input = client.input;
+    LineRef line;
+    while(input.next(line))
       {
-	char ch = data[i];
-	if (ch == '\r') continue;
-	if (ch == '\n')
+	if (client.rejecting)
 	  {
-	    if (!client.rejecting)
-	      m_protocol.process(readUTF8(buf), client);
 	    client.rejecting = 0;
-	    buf.clear();
 	    continue;
-	  } //'\n';
-	if (client.rejecting)
-	  continue;
-	buf += ch;
-	if (m_maxInputLine > 0 && buf.length() >= m_maxInputLine )
+	  }
+	if (m_maxInputLine > 0 && line.length >= m_maxInputLine)
+	  {
+	    VM_LOG_DEBUG("Input line exceeds input line length limit "
+		   "%u bytes. Truncating...", (unsigned)m_maxInputLine);
+	    line.length = m_maxInputLine;
+	  }
+	sessionCapture.writeLine(client.id, line.data, line.length);
+	readUTF8(line.data, line.length, m_line);
+	daemonStats.receivedLines++;
+	m_protocol.process(m_line, client);
+      } //while();
+    if (client.rejecting)
+      {
+	input.dropPending();
+	sessionCapture.flush();
+	return;
+      }
+    if (m_maxInputLine > 0 && input.getPendingSize() >= m_maxInputLine)
+      {
+	const LineRef pending = input.pending();
+	if (pending.length >= m_maxInputLine)
 	  {
-	    logMsg(LOG_DEBUG, "Input line exceeds input line length limit "
+	    VM_LOG_DEBUG("Input line exceeds input line length limit "
 		   "%u bytes. Truncating...", (unsigned)m_maxInputLine);
 	    client.rejecting = 1;
-	    m_protocol.process(readUTF8(buf), client);
-	    buf.clear();
+	    sessionCapture.writeLine(client.id, pending.data, m_maxInputLine);
+	    readUTF8(pending.data, m_maxInputLine, m_line);
+	    daemonStats.receivedLines++;
+	    m_protocol.process(m_line, client);
+	    input.dropPending();
 	  }
-      } //for();
-    logMsg(LOG_DEBUG, "Stored %u bytes in buffer", (unsigned)buf.length());
+      }
+    sessionCapture.flush();
+    VM_LOG_DEBUG("Stored %u bytes in buffer", (unsigned)input.getPendingSize());
   }
 
 private:
   VoicemanProtocol& m_protocol;
   const size_t m_maxInputLine;
+  std::wstring m_line;
 }; //class ClientDataHandler;
 
 /**\brief The central class of server point
@@ -702,32 +783,42 @@ public:
    */
   void run()
   {
-    logMsg(LOG_DEBUG, "Installing signal handlers");
+    VM_LOG_DEBUG("Installing signal handlers");
     installSignalProcessing();
-    logMsg(LOG_DEBUG, "Starting server initialization: charset for I/O operation: %s", transcoding.getIOCharset().c_str());
-    logMsg(LOG_DEBUG, "Initializing languages with datadir=%s", VOICEMAN_DATADIR);
+    utteranceTracing = m_configuration.traceLatency;
+    startCapture(m_configuration.captureFileName);
+    VM_LOG_DEBUG("Starting server initialization: charset for I/O operation: %s", transcoding.getIOCharset().c_str());
+    VM_LOG_DEBUG("Initializing languages with datadir=%s", VOICEMAN_DATADIR);
     langManager.load(VOICEMAN_DATADIR);
-    logMsg(LOG_DEBUG, "Language set was initialized, preparing executor interface (%s)", m_configuration.executor.c_str());
+    VM_LOG_DEBUG("Language set was initialized, preparing executor interface (%s)", m_configuration.executor.c_str());
+    if (!m_configuration.libaoDriver.empty())
+      setenv("VOICEMAN_LIBAO_DRIVER", m_configuration.libaoDriver.c_str(), 1);//executor reads it at startup;
+    if (m_configuration.lookahead != 0)
+      {
+	std::ostringstream ss;
+	ss << m_configuration.lookahead;
+	setenv("VOICEMAN_LOOKAHEAD", ss.str().c_str(), 1);
+      }
     OutputSet outputSet;
-    ExecutorInterface executorInterface(*this, outputSet, m_configuration.maxQueueSize, m_configuration.executor, m_configuration.playerType);
-    logMsg(LOG_DEBUG, "Executor was prepared successfully, filling set of outputs and protocol handler");
+    ExecutorInterface executorInterface(*this, outputSet, m_configuration.maxQueueSize, m_configuration.executor, m_configuration.playerType, m_origMask);
+    VM_LOG_DEBUG("Executor was prepared successfully, filling set of outputs and protocol handler");
     //Filling set of outputs;
     OutputList outputList;
     fillOutputListByConfiguration(m_configuration.outputs, outputList);
     outputSet.reinit(outputList);
-    logMsg(LOG_DEBUG, "Initializing protocol handler");
+    VM_LOG_DEBUG("Initializing protocol handler");
     ProtocolHandler protocolHandler(outputSet, executorInterface, m_configuration.lettersAtMinRate);
-    logMsg(LOG_DEBUG, "Initializing text processing");
+    VM_LOG_DEBUG("Initializing text processing");
     protocolHandler.reinit(m_configuration);
-    logMsg(LOG_DEBUG, "Text processing initialized");
+    VM_LOG_DEBUG("Text processing initialized");
     VoicemanProtocol protocol(protocolHandler);
     ClientFactory clientFactory;
     ClientDataHandler clientDataHandler(protocol, m_configuration.maxInputLine);
-    SystemSignalHandler systemSignalHandler(m_clients, outputSet, protocolHandler, executorInterface);
+    SystemSignalHandler systemSignalHandler(m_clients, outputSet, protocolHandler, executorInterface, m_terminationFlag);
     MainLoop mainLoop(clientFactory, m_clients, m_configuration.maxClients, clientDataHandler, systemSignalHandler, executorInterface, m_terminationFlag);
     if (!m_sayMode)
       {
-	logMsg(LOG_DEBUG, "Initializing sockets...");
+	VM_LOG_DEBUG("Initializing sockets...");
 	initSockets(trim(m_configuration.unixDomainSocketFileName), m_configuration.useInetSocket, m_configuration.inetSocketPort);
       }
     if (!m_sayMode && !trim(m_configuration.startUpMessage).empty())
@@ -737,7 +828,7 @@ public:
       }
     if (m_sayMode)
       {
-	logMsg(LOG_INFO, "Speaking text \'%s\'", WString2IO(m_configuration.sayModeText).c_str());
+	VM_LOG(LOG_INFO, "Speaking text \'%s\'", WString2IO(m_configuration.sayModeText).c_str());
 	auto_ptr<Client> client = clientFactory.createFakeClient();
 	protocolHandler.onText(*client.get(), m_configuration.sayModeText);
       }
@@ -747,13 +838,16 @@ public:
 	if (f)
 	  {
 	    f << getpid() << std::endl;
-	    logMsg(LOG_DEBUG, "Writing pid %d to \'%s\'", getpid(), m_configuration.pidFileName.c_str());
+	    VM_LOG_DEBUG("Writing pid %d to \'%s\'", getpid(), m_configuration.pidFileName.c_str());
 	  } else
 	  logMsg(LOG_ERR, "Could not save pid to \'%s\'", m_configuration.pidFileName.c_str());
       } //server pid saving;
     if (!m_sayMode)
       logMsg(LOG_INFO, "VoiceMan server is ready, welcome new connections!");
     mainLoop.run(m_sockets, &m_origMask);
+    for(ClientList::const_iterator it = m_clients.begin();it != m_clients.end();it++)
+      sessionCapture.writeClose((*it)->id);
+    sessionCapture.close();
     closeSockets();
   }
 
@@ -762,7 +856,7 @@ private://AbstractExecutorCallback;
   {
     if (m_sayMode && event == AbstractExecutorCallback::Silence)
       {
-	logMsg(LOG_DEBUG, "Registering silence command in say mode, terminationFlag=1");
+	VM_LOG_DEBUG("Registering silence command in say mode, terminationFlag=1");
 	m_terminationFlag = 1;
       }
   }
@@ -781,10 +875,18 @@ private:
     sa.sa_handler = sigPipeHandler;
     sa.sa_flags |= SA_RESTART;
     sigaction(SIGPIPE, &sa, NULL);
+    //SIGTERM and SIGINT handler installation, the main loop is finished gracefully;
+    sigaction(SIGTERM, NULL, &sa);
+    sa.sa_handler = sigTermHandler;
+    sa.sa_flags |= SA_RESTART;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
     sigset_t blockedMask;
     sigemptyset(&blockedMask);
     sigaddset(&blockedMask, SIGHUP);
     sigaddset(&blockedMask, SIGPIPE);
+    sigaddset(&blockedMask, SIGTERM);
+    sigaddset(&blockedMask, SIGINT);
     sigprocmask(SIG_BLOCK, &blockedMask, &m_origMask);
   }
 
@@ -804,7 +906,7 @@ private:
 	socket->open(trim(unixSocketPath));
 	m_sockets.push_back(socket.get());
 	socket.release();
-	logMsg(LOG_DEBUG, "Unix domain socket was successfully opened as \'%s\'", trim(unixSocketPath).c_str());
+	VM_LOG_DEBUG("Unix domain socket was successfully opened as \'%s\'", trim(unixSocketPath).c_str());
       } //UNIX domain socket initialization;
     if (useInetSocket)
       {
@@ -813,7 +915,7 @@ private:
 	socket->open(inetSocketPort);
 	m_sockets.push_back(socket.get());
 	socket.release();
-	logMsg(LOG_DEBUG, "Accepting TCP/IP connections at port %d", inetSocketPort);
+	VM_LOG_DEBUG("Accepting TCP/IP connections at port %d", inetSocketPort);
       } //inet socket initialization;
   }
 
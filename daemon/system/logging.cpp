@@ -20,22 +20,73 @@
 #define FILENAME_SYSLOG "syslog"
 #define VOICEMAN_LOGGER "voiceman"
 
+#define LOG_LINE_SIZE 4096
+#define LOG_RING_SIZE 1048576
+#define LOG_WRITER_PERIOD_NS 20000000
+
+/*
+ * Messages to be saved in log file or sent to syslog are put by the
+ * daemon thread into the ring buffer as a record header followed by the
+ * message text. The background writer takes them, formats and writes
+ * all available records at once to the file kept open. The buffer has
+ * the only producer and the only consumer, so the positions are just
+ * read and written with acquire and release semantics. If there is no
+ * space for new record, it is dropped and counted, logging never blocks
+ * the daemon. Messages on the console are printed immediately.
+ */
+
+struct LogRecordHeader
+{
+  int level;
+  time_t time;
+  size_t length;
+}; //struct LogRecordHeader;
+
 static std::string configLogFileName;
 static bool configLogConsole=1;
-static int configLogLevel=LOG_WARNING;
+int logLevelLimit=LOG_WARNING;
+
+static FILE* logFile = NULL;
+static char logRing[LOG_RING_SIZE];
+static size_t logRingHead = 0, logRingTail = 0;
+static size_t logDroppedCount = 0;
+static int logReopenFlag = 0, logStopFlag = 0;
+static bool logAsync = 0;
+static pthread_t logWriterThread;
+
+/**\brief Generates string representation of the given time
+ *
+ * The result of the last call is cached, since the most of consequent
+ * messages are made during the same second.
+ */
+static const char* formatTime(time_t t)
+{
+  static time_t lastTime = (time_t)-1;
+  static char buf[64];
+  if (t == lastTime)
+    return buf;
+  if (ctime_r(&t, buf) == NULL)
+    buf[0] = '\0';
+  size_t k = 0;
+  for(size_t i = 0;buf[i] != '\0';i++)
+    if (buf[i] != 10 && buf[i] != 13)
+      buf[k++] = buf[i];
+  buf[k] = '\0';
+  lastTime = t;
+  return buf;
+}
 
-/**\brief Generates string representation of current system time*/
-static std::string getCurrentTime()
+static const char* levelPrefix(int level)
 {
-  std::string s;
-  time_t t;
-  time(&t);
-  s=ctime(&t);
-  std::string ss;
-  for(std::string::size_type i = 0;i < s.length();i++)
-    if (s[i] != 10 && s[i] != 13)
-      ss += s[i];
-  return ss;
+  if (level <= LOG_CRIT)
+    return "FATAL:";
+  if (level <= LOG_ERR)
+    return "ERROR:";
+  if (level <= LOG_WARNING)
+    return "WARNING:";
+  if (level <= LOG_INFO)
+    return "INFO:";
+  return "TRACE:";
 }
 
 /**\brief Prints log line on the system console
@@ -68,12 +119,23 @@ static void printLogLine(int level, const char* line)
   std::cout << line << std::endl;
 }
 
+static void openLogFile()
+{
+  if (logFile != NULL)
+    fclose(logFile);
+  logFile = fopen(configLogFileName.c_str(), "a");
+}
+
 /**\brief Saves the log message in log file or sends it to syslog
+ *
+ * The file is opened once and is kept open until reopenLogging() call.
+ * Written data is not flushed, it is the caller responsibility.
  *
  * \param [in] level The error level of the message
+ * \param [in] t The time the message was made at
  * \param [in] line The error text
  */
-static void saveLogLine(int level, const char* line)
+static void saveLogLine(int level, time_t t, const char* line)
 {
   assert(line != NULL);
   if (configLogFileName.empty())
@@ -83,20 +145,92 @@ static void saveLogLine(int level, const char* line)
       syslog(level, "%s", line);
       return;
     }
-  std::ofstream f(configLogFileName.c_str(), std::ios_base::out | std::ios_base::app);
-  if (!f)
+  if (logFile == NULL)
+    openLogFile();
+  if (logFile == NULL)
     return;
-  f << getCurrentTime() << ':';
-  if (level <= LOG_CRIT)
-    f << "FATAL:";  else
-  if (level <= LOG_ERR)
-    f << "ERROR:"; else
-  if (level <= LOG_WARNING)
-    f << "WARNING:"; else
-  if (level <= LOG_INFO)
-    f << "INFO:"; else
-    f << "TRACE:";
-  f << line << std::endl;
+  fprintf(logFile, "%s:%s%s\n", formatTime(t), levelPrefix(level), line);
+}
+
+static void copyFromRing(size_t pos, void* dest, size_t size)
+{
+  const size_t offset = pos % LOG_RING_SIZE;
+  const size_t first = LOG_RING_SIZE - offset < size?LOG_RING_SIZE - offset:size;
+  memcpy(dest, logRing + offset, first);
+  memcpy((char*)dest + first, logRing, size - first);
+}
+
+static void copyToRing(size_t pos, const void* src, size_t size)
+{
+  const size_t offset = pos % LOG_RING_SIZE;
+  const size_t first = LOG_RING_SIZE - offset < size?LOG_RING_SIZE - offset:size;
+  memcpy(logRing + offset, src, first);
+  memcpy(logRing, (const char*)src + first, size - first);
+}
+
+/**\brief Puts the message into the ring buffer for background writer
+ *
+ * \return Non-zero if the message was queued or zero if there was no space
+ */
+static bool pushLogRecord(int level, const char* line)
+{
+  LogRecordHeader header;
+  header.level = level;
+  header.time = time(NULL);
+  header.length = strlen(line);
+  const size_t head = logRingHead;
+  const size_t tail = __atomic_load_n(&logRingTail, __ATOMIC_ACQUIRE);
+  if (LOG_RING_SIZE - (head - tail) < sizeof(LogRecordHeader) + header.length)
+    return 0;
+  copyToRing(head, &header, sizeof(LogRecordHeader));
+  copyToRing(head + sizeof(LogRecordHeader), line, header.length);
+  __atomic_store_n(&logRingHead, head + sizeof(LogRecordHeader) + header.length, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/**\brief Writes all records available in the ring buffer*/
+static void drainLogRecords()
+{
+  const size_t head = __atomic_load_n(&logRingHead, __ATOMIC_ACQUIRE);
+  size_t tail = logRingTail;
+  if (tail == head)
+    return;
+  char line[LOG_LINE_SIZE];
+  while(tail != head)
+    {
+      LogRecordHeader header;
+      copyFromRing(tail, &header, sizeof(LogRecordHeader));
+      assert(header.length < LOG_LINE_SIZE);
+      copyFromRing(tail + sizeof(LogRecordHeader), line, header.length);
+      line[header.length] = '\0';
+      tail += sizeof(LogRecordHeader) + header.length;
+      __atomic_store_n(&logRingTail, tail, __ATOMIC_RELEASE);
+      saveLogLine(header.level, header.time, line);
+    } //while();
+  const size_t dropped = __atomic_exchange_n(&logDroppedCount, 0, __ATOMIC_ACQ_REL);
+  if (dropped > 0)
+    {
+      snprintf(line, sizeof(line), "%lu log messages were dropped due to log buffer overflow", (unsigned long)dropped);
+      saveLogLine(LOG_WARNING, time(NULL), line);
+    }
+  if (logFile != NULL)
+    fflush(logFile);
+}
+
+static void* logWriterProc(void*)
+{
+  while(!__atomic_load_n(&logStopFlag, __ATOMIC_ACQUIRE))
+    {
+      if (__atomic_exchange_n(&logReopenFlag, 0, __ATOMIC_ACQ_REL) && configLogFileName != FILENAME_SYSLOG)
+	openLogFile();
+      drainLogRecords();
+      struct timespec ts;
+      ts.tv_sec = 0;
+      ts.tv_nsec = LOG_WRITER_PERIOD_NS;
+      nanosleep(&ts, NULL);
+    } //while();
+  drainLogRecords();
+  return NULL;
 }
 
 /**\brief Processes constructed log message
@@ -106,34 +240,94 @@ static void saveLogLine(int level, const char* line)
  */
 static void logLine(int level, const char* line)
 {
-#ifndef VOICEMAN_DEBUG
-  if (level > configLogLevel)
-    return;
-#endif //VOICEMAN_DEBUG
   printLogLine(level, line);
-  saveLogLine(level, line);
+  if (configLogFileName.empty())
+    return;
+  if (logAsync)
+    {
+      if (!pushLogRecord(level, line))
+	__atomic_add_fetch(&logDroppedCount, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  saveLogLine(level, time(NULL), line);
+  if (logFile != NULL)
+    fflush(logFile);
 }
 
 void logMsg(int level, const char* format, ...)
 {
-  if (!format)
+  if (!format || !logLevelEnabled(level))
     return;
   va_list args;
   va_start(args, format);
-  char buf[4096];
+  char buf[LOG_LINE_SIZE];
   vsnprintf(buf, sizeof(buf), format, args);
   buf[sizeof(buf)-1]='\0';
   va_end(args);
-  std::string str(buf);
-  removeNewLineChars(str);
-  logLine(level, str.c_str());
+  //Removing new line characters in place;
+  size_t k = 0;
+  for(size_t i = 0;buf[i] != '\0';i++)
+    if (buf[i] != '\n' && buf[i] != '\r')
+      buf[k++] = buf[i];
+  buf[k] = '\0';
+  logLine(level, buf);
+}
+
+/**\brief Turns off background writing in child processes
+ *
+ * The writer thread does not exist in the child process after fork(), so
+ * its messages are saved directly.
+ */
+static void logAfterFork()
+{
+  logAsync = 0;
 }
 
 void initLogging(const std::string& logFileName, bool logConsole, int logLevel)
 {
   configLogFileName = logFileName;
   configLogConsole = logConsole;
-  configLogLevel = logLevel;
+  logLevelLimit = logLevel;
+  if (configLogFileName.empty())
+    return;
   if (configLogFileName == FILENAME_SYSLOG)
-    openlog(VOICEMAN_LOGGER, LOG_PID, LOG_DAEMON);
+    openlog(VOICEMAN_LOGGER, LOG_PID, LOG_DAEMON); else
+    openLogFile();
+  //The writer thread must not take signals, only the main loop waits for them;
+  sigset_t allSignals, origMask;
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &origMask);
+  const int res = pthread_create(&logWriterThread, NULL, logWriterProc, NULL);
+  pthread_sigmask(SIG_SETMASK, &origMask, NULL);
+  if (res != 0)
+    return;//Messages will be saved directly;
+  logAsync = 1;
+  pthread_atfork(NULL, NULL, logAfterFork);
+  atexit(closeLogging);
+}
+
+void reopenLogging()
+{
+  if (configLogFileName.empty() || configLogFileName == FILENAME_SYSLOG)
+    return;
+  if (logAsync)
+    {
+      __atomic_store_n(&logReopenFlag, 1, __ATOMIC_RELEASE);
+      return;
+    }
+  openLogFile();
+}
+
+void closeLogging()
+{
+  if (!logAsync)
+    return;
+  __atomic_store_n(&logStopFlag, 1, __ATOMIC_RELEASE);
+  pthread_join(logWriterThread, NULL);
+  logAsync = 0;
+  if (logFile != NULL)
+    {
+      fclose(logFile);
+      logFile = NULL;
+    }
 }
@@ -23,7 +23,9 @@
  * in syslog constants as they used in Linux applications. The name of a
  * file to save log messages in can be "syslog" and it means to translate
  * all messages to usual syslog mechanism. Also it can be empty and in
- * this case messages will not be saved at all.
+ * this case messages will not be saved at all. Messages to be saved are
+ * queued and written by background thread, so logging never blocks the
+ * caller, if there are too many of them some can be dropped.
  * 
  * \param [in] logFileName The name of a file to save logging information in
  * \param [in] logConsole Print logging messages on system console
@@ -31,6 +33,21 @@
  */
 void initLogging(const std::string& logFileName, bool logConsole, int logLevel); 
 
+/**\brief Reopens log file
+ *
+ * Messages are saved in log file kept open all the time. Call this
+ * function to reopen it after the file was rotated. The file is reopened
+ * by the background writer before saving next messages.
+ */
+void reopenLogging();
+
+/**\brief Saves all queued messages and stops background writer
+ *
+ * This function is registered with atexit() by initLogging(), so
+ * usually it should not be called explicitly.
+ */
+void closeLogging();
+
 /**\brief Processes log message
  *
  * This is the main function to make one log message. The message text
@@ -42,4 +59,43 @@ void initLogging(const std::string& logFileName, bool logConsole, int logLevel);
  */
 void logMsg(int level, const char* format,... );
 
+extern int logLevelLimit;
+
+/**\brief Checks if messages of the given level are logged
+ *
+ * Use this function to skip preparing of values needed only for log
+ * message when this message is filtered out anyway. When the daemon is
+ * built with VOICEMAN_DEBUG all messages are logged.
+ *
+ * \param [in] level The error level to check
+ *
+ * \return Non-zero if messages of this level are logged or zero otherwise
+ */
+inline bool logLevelEnabled(int level)
+{
+#ifdef VOICEMAN_DEBUG
+  return 1;
+#else
+  return level <= logLevelLimit;
+#endif //VOICEMAN_DEBUG
+}
+
+/*
+ * Debug messages can be removed from the daemon at compile time with
+ * VOICEMAN_NO_DEBUG_LOG (configure --disable-debug-log). The arguments
+ * of removed messages are still checked by the compiler but never
+ * evaluated.
+ */
+#ifdef VOICEMAN_NO_DEBUG_LOG
+#define LOG_DEBUG_ENABLED 0
+#else
+#define LOG_DEBUG_ENABLED logLevelEnabled(LOG_DEBUG)
+#endif //VOICEMAN_NO_DEBUG_LOG
+
+/**\brief Makes log message evaluating its arguments only if the level is enabled*/
+#define VM_LOG(level, ...) do { if (logLevelEnabled(level)) logMsg((level), __VA_ARGS__); } while(0)
+
+/**\brief Makes debug message evaluating its arguments only if debug messages are enabled*/
+#define VM_LOG_DEBUG(...) do { if (LOG_DEBUG_ENABLED) logMsg(LOG_DEBUG, __VA_ARGS__); } while(0)
+
 #endif //__VOICEMAN_LOGGING_H__
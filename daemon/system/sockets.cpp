@@ -33,7 +33,8 @@ ssize_t Socket::read(void* buf, size_t s) const
 ssize_t Socket::write(const void *buf, size_t s) const
 {
   assert(m_opened);
-  return ::write(m_sock, buf, s);
+  //Closed connection must not raise SIGPIPE, the daemon takes it as executor death;
+  return ::send(m_sock, buf, s, MSG_NOSIGNAL);
 }
 
 int Socket::getHandler() const
@@ -54,8 +55,7 @@ ssize_t Socket::read(std::string &s) const
   const ssize_t c=read(buf, sizeof(buf));
   if (c <= 0)
     return c;
-  for(ssize_t i=0;i<c;i++)
-    s+=buf[i];
+  s.assign(buf, c);
   return c;
 }
 
@@ -27,6 +27,7 @@
 #include<list>
 #include<set>
 #include<map>
+#include<deque>
 //KILLME:#include<unordered_set>
 //KILLME:#include<unordered_map>
 #include<sstream>
@@ -48,6 +49,9 @@
 #include<arpa/inet.h>
 #include<resolv.h>
 #include<sys/un.h>
+#include<sys/epoll.h>
+#include<sys/signalfd.h>
+#include<sys/uio.h>
 #include<pthread.h>
 #include<fcntl.h>
 #include<iconv.h>
@@ -19,6 +19,7 @@
 #include"system/system.h"
 #include"vmstrings.h"
 #include"Transcoding.h"
+#include"LineReader.h"
 #include"system/logging.h"
 #include"system/SystemException.h"
 #include"system/files.h"
@@ -33,6 +34,7 @@ typedef std::list<std::wstring> WStringList;
 typedef std::map<std::string, std::string> StringToStringMap;
 typedef std::map<std::wstring, std::wstring> WStringToWStringMap;
 typedef std::map<std::string, std::wstring> StringToWStringMap;
+typedef std::map<std::string, size_t> StringToSizeMap;
 
 typedef std::set<char> CharSet;
 typedef std::set<wchar_t> WCharSet;
@@ -44,7 +46,10 @@ typedef std::set<LangId> LangIdSet;
 typedef std::map<LangId, std::string> LangIdToStringMap;
 typedef std::map<LangId, std::wstring> LangIdToWStringMap;
 
+#define OUTPUT_HANDLE_NONE ((OutputHandle)-1)
+typedef size_t OutputHandle;
+
 typedef int PlayerType;
-enum {PlayerTypeAlsa = 0, PlayerTypePulseaudio = 1, PlayerTypePcspeaker = 2};
+enum {PlayerTypeAlsa = 0, PlayerTypePulseaudio = 1, PlayerTypePcspeaker = 2, PlayerTypeLibao = 3};
 
 #endif //__VOICEMAN_H__
@@ -32,12 +32,13 @@ void Connection::text(const std::string& t)
 {
   if (!connectionAvailable())
     return;
-  if (trim(IO2WString(t)).length() == 1)//Just for Orca hack!!!
+  const std::wstring w = IO2WString(t);
+  if (trim(w).length() == 1)//Just for Orca hack!!!
     {
       letter(trim(t));
       return;
     }
-  const std::string s=encodeUTF8(IO2WString(t));
+  const std::string s=encodeUTF8(w);
   vm_text(m_con, (char*)s.c_str());
 }
 
@@ -19,6 +19,7 @@
 #include<assert.h>
 #include<stdlib.h>
 #include<stdio.h>
+#include<errno.h>
 #include<string>
 #include<list>
 #include<vector>
@@ -30,6 +31,7 @@
 #include"vmstrings.h"
 #include<iconv.h>
 #include"Transcoding.h"
+#include"LineReader.h"
 #include"vmclient.h"
 
 typedef std::vector<std::string> StringVector;
@@ -190,6 +190,7 @@ void handleLine(const std::string& line, LineParser& parser)
 
 int readInput(int file, LineParser& parser)
 {
+  LineReader reader;
   std::string line;
   while(1)
     {
@@ -197,23 +198,16 @@ int readInput(int file, LineParser& parser)
       const ssize_t readCount = read(file, buf, sizeof(buf));
       if (readCount < 0)
 	{
+	  if (errno == EINTR)
+	    continue;
 	  perror("read()");
 	  return EXIT_FAILURE;
 	}
       if (readCount == 0)
 	return EXIT_SUCCESS;
-      for(size_t i = 0;i < (size_t)readCount;i++)
-	{
-	  if (buf[i] == '\n')
-	    {
-	      handleLine(line, parser);
-	      line.erase();
-	      continue;
-	    }
-	  if (buf[i] == '\r')
-	    continue;
-	  line += buf[i];
-	} //for(buf);
+      reader.append(buf, (size_t)readCount);
+      while(reader.next(line))
+	handleLine(line, parser);
     } //while(1);
 }
 
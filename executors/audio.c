@@ -0,0 +1,386 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * In-process playback of raw audio produced by synthesizers. Data is
+ * put into the ring buffer by the main loop and is played by separate
+ * thread through one libao device which stays open while audio format
+ * is not changed. The thread notifies the main loop through the pipe
+ * when text block playback is finished or when there is free space in
+ * the ring buffer again. Tone signals are generated by the same thread
+ * with the format of the last played speech, so switching between
+ * speech and tones does not reopen the device.
+ */
+
+#include<assert.h>
+#include<stdlib.h>
+#include<stdio.h>
+#include<string.h>
+#include<strings.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<pthread.h>
+#include<ao/ao.h>
+#include"executor.h"
+
+#define AUDIO_RING_SIZE 65536
+#define AUDIO_CHUNK_SIZE 4096
+
+#define SAMPLE_FORMAT_S8 1
+#define SAMPLE_FORMAT_U8 2
+#define SAMPLE_FORMAT_S16LE 3
+#define SAMPLE_FORMAT_S16BE 4
+
+#define TONE_DEFAULT_RATE 44100
+#define TONE_DEFAULT_CHANNELS 2
+
+typedef struct AudioFormat_
+{
+  int rate;
+  int channels;
+  int sampleFormat;
+} AudioFormat;
+
+static pthread_t audioThread;
+static pthread_mutex_t audioMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t audioCond = PTHREAD_COND_INITIALIZER;
+static int notifyPipe[2] = {-1, -1};
+static char* libAoDriver = NULL;
+
+/*Protected by audioMutex*/
+static char ring[AUDIO_RING_SIZE];
+static size_t ringHead = 0;
+static size_t ringSize = 0;
+static AudioFormat format;
+static AudioFormat toneFormat;
+static char busy = 0;
+static char tone = 0;
+static char finishing = 0;
+static char done = 0;
+static char waitingSpace = 0;
+static char quit = 0;
+
+/*Used only by audio thread*/
+static ao_device* device = NULL;
+static AudioFormat deviceFormat;
+
+static void notifyMainLoop()
+{
+  char c = 0;
+  if (write(notifyPipe[1], &c, 1) == -1)
+    {
+      /*Pipe is full, the main loop will be woken up in any case*/
+    }
+}
+
+static size_t sampleSize(int sampleFormat)
+{
+  return sampleFormat == SAMPLE_FORMAT_S16LE || sampleFormat == SAMPLE_FORMAT_S16BE?2:1;
+}
+
+/*Opens libao device if it is closed or has another format, returns zero on error*/
+static char prepareDevice(const AudioFormat* f)
+{
+  ao_sample_format aoFormat;
+  int driver;
+  if (device != NULL && deviceFormat.rate == f->rate && deviceFormat.channels == f->channels)
+    return 1;
+  if (device != NULL)
+    ao_close(device);
+  bzero(&aoFormat, sizeof(ao_sample_format));
+  aoFormat.bits = 16;
+  aoFormat.channels = f->channels;
+  aoFormat.rate = f->rate;
+  aoFormat.byte_format = AO_FMT_NATIVE;
+  driver = libAoDriver != NULL?ao_driver_id(libAoDriver):ao_default_driver_id();
+  device = ao_open_live(driver, &aoFormat, NULL);
+  if (device == NULL)
+    {
+      fprintf(stderr, "%scould not open libao device\n", ERROR_PREFIX);
+      fflush(stderr);
+      return 0;
+    }
+  deviceFormat = *f;
+  return 1;
+}
+
+/*Converts samples of any supported format to 16-bit samples in native byte order*/
+static size_t convertSamples(const unsigned char* src, size_t len, int sampleFormat, short* dest)
+{
+  size_t i;
+  switch(sampleFormat)
+    {
+    case SAMPLE_FORMAT_S8:
+      for(i = 0;i < len;i++)
+	dest[i] = (short)((signed char)src[i] * 256);
+      return len;
+    case SAMPLE_FORMAT_U8:
+      for(i = 0;i < len;i++)
+	dest[i] = (short)(((int)src[i] - 128) * 256);
+      return len;
+    case SAMPLE_FORMAT_S16LE:
+      for(i = 0;i < len / 2;i++)
+	dest[i] = (short)(src[2 * i] | (src[2 * i + 1] << 8));
+      return len / 2;
+    case SAMPLE_FORMAT_S16BE:
+      for(i = 0;i < len / 2;i++)
+	dest[i] = (short)((src[2 * i] << 8) | src[2 * i + 1]);
+      return len / 2;
+    } /*switch()*/
+  assert(0);
+  return 0;
+}
+
+static void* audioThreadProc(void* arg)
+{
+  unsigned char chunk[AUDIO_CHUNK_SIZE];
+  short samples[AUDIO_CHUNK_SIZE];
+  pthread_mutex_lock(&audioMutex);
+  while(1)
+    {
+      AudioFormat f;
+      size_t frameSize, len, i, count;
+      while(!quit && ringSize == 0 && !finishing && !tone)
+	pthread_cond_wait(&audioCond, &audioMutex);
+      if (quit)
+	break;
+      if (tone)
+	{
+	  f = toneFormat;
+	  count = toneGenerate(samples, AUDIO_CHUNK_SIZE / f.channels, f.channels) * f.channels;
+	  if (count == 0)
+	    {
+	      tone = 0;
+	      busy = 0;
+	      done = 1;
+	      notifyMainLoop();
+	      continue;
+	    }
+	  pthread_mutex_unlock(&audioMutex);
+	  if (prepareDevice(&f))
+	    ao_play(device, (char*)samples, (unsigned int)(count * sizeof(short)));
+	  pthread_mutex_lock(&audioMutex);
+	  continue;
+	} /*tone*/
+      f = format;
+      frameSize = sampleSize(f.sampleFormat) * f.channels;
+      len = ringSize < AUDIO_CHUNK_SIZE?ringSize:AUDIO_CHUNK_SIZE;
+      len -= len % frameSize;
+      if (len == 0)
+	{
+	  if (!finishing)/*Incomplete frame, waiting for more data*/
+	    {
+	      pthread_cond_wait(&audioCond, &audioMutex);
+	      continue;
+	    }
+	  /*Text block is completely played, incomplete frame is dropped*/
+	  ringHead = 0;
+	  ringSize = 0;
+	  finishing = 0;
+	  busy = 0;
+	  done = 1;
+	  notifyMainLoop();
+	  continue;
+	}
+      for(i = 0;i < len;i++)
+	chunk[i] = ring[(ringHead + i) % AUDIO_RING_SIZE];
+      ringHead = (ringHead + len) % AUDIO_RING_SIZE;
+      ringSize -= len;
+      if (waitingSpace)
+	{
+	  waitingSpace = 0;
+	  notifyMainLoop();
+	}
+      pthread_mutex_unlock(&audioMutex);
+      count = convertSamples(chunk, len, f.sampleFormat, samples);
+      if (prepareDevice(&f))
+	ao_play(device, (char*)samples, (unsigned int)(count * sizeof(short)));
+      pthread_mutex_lock(&audioMutex);
+    } /*while(1)*/
+  pthread_mutex_unlock(&audioMutex);
+  if (device != NULL)
+    ao_close(device);
+  device = NULL;
+  return NULL;
+}
+
+/*Returns file descriptor the main loop must wait notifications on*/
+int audioInit()
+{
+  libAoDriver = getenv("VOICEMAN_LIBAO_DRIVER");
+  if (libAoDriver != NULL && strlen(libAoDriver) < 1)
+    libAoDriver = NULL;
+  ao_initialize();
+  toneFormat.rate = TONE_DEFAULT_RATE;
+  toneFormat.channels = TONE_DEFAULT_CHANNELS;
+  toneFormat.sampleFormat = SAMPLE_FORMAT_S16LE;
+  if (pipe(notifyPipe) == -1)
+    {
+      perror("pipe()");
+      fflush(stderr);
+      exit(EXIT_FAILURE);
+    }
+  fcntl(notifyPipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl(notifyPipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl(notifyPipe[0], F_SETFL, fcntl(notifyPipe[0], F_GETFL) | O_NONBLOCK);
+  fcntl(notifyPipe[1], F_SETFL, fcntl(notifyPipe[1], F_GETFL) | O_NONBLOCK);
+  if (pthread_create(&audioThread, NULL, audioThreadProc, NULL) != 0)
+    {
+      fprintf(stderr, "%scould not create audio thread\n", ERROR_PREFIX);
+      fflush(stderr);
+      exit(EXIT_FAILURE);
+    }
+  return notifyPipe[0];
+}
+
+void audioClose()
+{
+  pthread_mutex_lock(&audioMutex);
+  quit = 1;
+  pthread_cond_signal(&audioCond);
+  pthread_mutex_unlock(&audioMutex);
+  pthread_join(audioThread, NULL);
+  close(notifyPipe[0]);
+  close(notifyPipe[1]);
+  ao_shutdown();
+}
+
+/*Starts new text block playback, format is given as "RATE CHANNELS FORMAT", returns zero if format is invalid*/
+char audioStart(const char* formatSpec)
+{
+  AudioFormat f;
+  char sampleFormat[16];
+  assert(formatSpec);
+  if (sscanf(formatSpec, "%d %d %15s", &f.rate, &f.channels, sampleFormat) != 3 || f.rate <= 0 || f.channels <= 0 || f.channels > 8)
+    {
+      fprintf(stderr, "%sinvalid audio format \'%s\'\n", ERROR_PREFIX, formatSpec);
+      fflush(stderr);
+      return 0;
+    }
+  if (strcasecmp(sampleFormat, "s8") == 0)
+    f.sampleFormat = SAMPLE_FORMAT_S8; else
+    if (strcasecmp(sampleFormat, "u8") == 0)
+      f.sampleFormat = SAMPLE_FORMAT_U8; else
+      if (strcasecmp(sampleFormat, "s16le") == 0)
+	f.sampleFormat = SAMPLE_FORMAT_S16LE; else
+	if (strcasecmp(sampleFormat, "s16be") == 0)
+	  f.sampleFormat = SAMPLE_FORMAT_S16BE; else
+	  {
+	    fprintf(stderr, "%sunsupported sample format \'%s\'\n", ERROR_PREFIX, sampleFormat);
+	    fflush(stderr);
+	    return 0;
+	  }
+  pthread_mutex_lock(&audioMutex);
+  assert(!busy);
+  format = f;
+  toneFormat = f;
+  ringHead = 0;
+  ringSize = 0;
+  finishing = 0;
+  done = 0;
+  busy = 1;
+  pthread_mutex_unlock(&audioMutex);
+  return 1;
+}
+
+/*Starts tone signal playback, it is played without blocking the caller*/
+void audioTone(size_t freq, size_t lengthMs)
+{
+  pthread_mutex_lock(&audioMutex);
+  assert(!busy);
+  toneStart(freq, lengthMs, toneFormat.rate);
+  tone = 1;
+  busy = 1;
+  done = 0;
+  pthread_cond_signal(&audioCond);
+  pthread_mutex_unlock(&audioMutex);
+}
+
+/*Puts audio data to the ring buffer, returns the number of bytes taken*/
+size_t audioWrite(const void* buf, size_t len)
+{
+  const char* b = (const char*)buf;
+  size_t i, toWrite;
+  pthread_mutex_lock(&audioMutex);
+  toWrite = AUDIO_RING_SIZE - ringSize;
+  if (toWrite > len)
+    toWrite = len;
+  for(i = 0;i < toWrite;i++)
+    ring[(ringHead + ringSize + i) % AUDIO_RING_SIZE] = b[i];
+  ringSize += toWrite;
+  if (toWrite < len)
+    waitingSpace = 1;
+  pthread_cond_signal(&audioCond);
+  pthread_mutex_unlock(&audioMutex);
+  return toWrite;
+}
+
+size_t audioFreeSpace()
+{
+  size_t res;
+  pthread_mutex_lock(&audioMutex);
+  res = AUDIO_RING_SIZE - ringSize;
+  if (res == 0)
+    waitingSpace = 1;
+  pthread_mutex_unlock(&audioMutex);
+  return res;
+}
+
+/*Notifies there will be no more data for current text block*/
+void audioFinish()
+{
+  pthread_mutex_lock(&audioMutex);
+  if (busy)
+    finishing = 1;
+  pthread_cond_signal(&audioCond);
+  pthread_mutex_unlock(&audioMutex);
+}
+
+/*Drops all audio data not yet given to libao*/
+void audioStop()
+{
+  pthread_mutex_lock(&audioMutex);
+  ringHead = 0;
+  ringSize = 0;
+  finishing = 0;
+  busy = 0;
+  done = 0;
+  waitingSpace = 0;
+  tone = 0;
+  toneCancel();
+  pthread_mutex_unlock(&audioMutex);
+}
+
+char isAudioBusy()
+{
+  char res;
+  pthread_mutex_lock(&audioMutex);
+  res = busy;
+  pthread_mutex_unlock(&audioMutex);
+  return res;
+}
+
+/*Reads notifications sent by audio thread, returns non-zero if text block playback is finished*/
+char audioProcessNotification()
+{
+  char buf[64];
+  char res;
+  while(read(notifyPipe[0], buf, sizeof(buf)) > 0);
+  pthread_mutex_lock(&audioMutex);
+  res = done;
+  done = 0;
+  pthread_mutex_unlock(&audioMutex);
+  return res;
+}
@@ -13,6 +13,7 @@
    General Public License for more details.
 */
 
+#define _GNU_SOURCE
 #include<assert.h>
 #include<stdlib.h>
 #include<stdio.h>
@@ -26,19 +27,20 @@
 #include<signal.h>
 #include<errno.h>
 #include<locale.h>
+#include<time.h>
 #include"executorCommandHeader.h"
+#include"executor.h"
 
-#define ERROR_PREFIX "voiceman-executor:"
-
-#define NULL_DEVICE "/dev/null"
 #define IO_BUF_SIZE 2048
 
+/*Capacity requested for the pipe keeping output of synthesizer launched in advance*/
+#define LOOKAHEAD_PIPE_SIZE 1048576
+/*Longer texts are not synthesized in advance, writing them could block executor*/
+#define LOOKAHEAD_MAX_TEXT 16384
+
 #define QUEUE_ITEM_TEXT 1
 #define QUEUE_ITEM_TONE 2
-
-void toneInit();
-void playTone(size_t freq, size_t lengthMs);
-void toneClose();
+#define QUEUE_ITEM_PERSISTENT_TEXT 3
 
 typedef struct QueueItem_  
 {
@@ -46,17 +48,28 @@ typedef struct QueueItem_
   char* synthCommand;
   char* playerCommand;
   char* text;
+  char libaoPlayer;
   size_t freq;
   size_t duration;
+  size_t utterance;
+  pid_t prefetchPid;/*synthesizer launched in advance, zero if there is no such process*/
+  int prefetchOutput;/*stdout of the synthesizer launched in advance*/
   struct QueueItem_* next;
 } QueueItem;
 
 pid_t pid = 0;
 pid_t playerPid = 0;
+int synthOutput = -1;/*stdout of synthesizer played with libao*/
+int audioNotify = -1;
 QueueItem* queueHead = NULL;
 QueueItem* queueTail = NULL;
 size_t queueSize = 0;
 size_t maxQueueSize = 0;
+char lastTextDropped = 0;/*continuation of the text block dropped by queue limit is dropped too*/
+size_t lookahead = 0;/*number of queue items to synthesize while the current one is played*/
+char itemPlaying = 0;
+size_t playingUtterance = 0;/*zero if there is no traced text block in playback*/
+char firstPcmTraced = 0;
 volatile sig_atomic_t wasSigChld = 0;
 
 void sigChldHandler(int n)
@@ -146,6 +159,39 @@ void onNoMemError()
   exit(EXIT_FAILURE);
 }
 
+/*Reports event of text block playback to daemon, see executorCommandHeader.h*/
+void traceEvent(size_t utterance, const char* event)
+{
+  struct timespec ts;
+  assert(event);
+  if (utterance == 0)
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  printf("trace %zu %s %ld.%09ld\n", utterance, event, (long)ts.tv_sec, (long)ts.tv_nsec);
+  fflush(stdout);
+}
+
+/*Called on each block of audio data passing through executor*/
+void traceFirstPcm()
+{
+  if (firstPcmTraced)
+    return;
+  firstPcmTraced = 1;
+  traceEvent(playingUtterance, "firstpcm");
+}
+
+/*Marks the queue item being played as finished, daemon counts played items to know queue depth*/
+void itemFinished()
+{
+  if (!itemPlaying)
+    return;
+  itemPlaying = 0;
+  traceEvent(playingUtterance, "playerexit");
+  playingUtterance = 0;
+  printf("played\n");
+  fflush(stdout);
+}
+
 void onSystemCallError(const char* descr, int errorCode)
 {
   assert(descr != NULL);
@@ -154,30 +200,42 @@ void onSystemCallError(const char* descr, int errorCode)
   exit(EXIT_FAILURE);
 }
 
-void putTextItemToQueue(char* synthCommand, char* playerCommand, char* text)
+/*This function frees provided string buffers*/
+void dropTextItem(char* synthCommand, char* playerCommand, char* text)
+{
+  lastTextDropped = 1;
+  printf("queuelimit\n");
+  fflush(stdout);
+  free(synthCommand);
+  free(playerCommand);
+  free(text);
+}
+
+void putTextItemToQueue(char* synthCommand, char* playerCommand, char* text, char persistent, char libaoPlayer, size_t utterance, char continuation)
 {
   QueueItem* newItem = NULL;
   assert(synthCommand);
   assert(playerCommand);
   assert(text);
-  if (maxQueueSize > 0 && queueSize >= maxQueueSize)
+  if (continuation?lastTextDropped:(maxQueueSize > 0 && queueSize >= maxQueueSize))
     {
-      printf("queuelimit\n");
-      fflush(stdout);
-      free(synthCommand);
-      free(playerCommand);
-      free(text);
+      dropTextItem(synthCommand, playerCommand, text);
       return;
     }
+  lastTextDropped = 0;
   newItem = (QueueItem*)malloc(sizeof(QueueItem));
   if (!newItem)
     onNoMemError();
-  newItem->type = QUEUE_ITEM_TEXT;
+  newItem->type = persistent?QUEUE_ITEM_PERSISTENT_TEXT:QUEUE_ITEM_TEXT;
   newItem->synthCommand = synthCommand;
   newItem->playerCommand = playerCommand;
   newItem->text = text;
+  newItem->libaoPlayer = libaoPlayer;
   newItem->freq = 0;
   newItem->duration = 0;
+  newItem->utterance = utterance;
+  newItem->prefetchPid = 0;
+  newItem->prefetchOutput = -1;
   newItem->next = NULL;
   queueSize++;
   if (!queueHead)/*there are no items in queue at all*/
@@ -207,8 +265,12 @@ void putToneItemToQueue(size_t freq, size_t duration)
   newItem->synthCommand = NULL;
   newItem->playerCommand = NULL;
   newItem->text = NULL;
+  newItem->libaoPlayer = 0;
   newItem->freq = freq;
   newItem->duration = duration;
+  newItem->utterance = 0;
+  newItem->prefetchPid = 0;
+  newItem->prefetchOutput = -1;
   newItem->next = NULL;
   queueSize++;
   if (!queueHead)/*there are no items in queue at all*/
@@ -222,6 +284,47 @@ void putToneItemToQueue(size_t freq, size_t duration)
   queueTail = newItem;
 }
 
+/*Kills process group and collects all its zombies*/
+void killGroup(pid_t groupPid)
+{
+  assert(groupPid != (pid_t)0);
+  kill(groupPid, SIGKILL);
+  killpg(groupPid, SIGKILL);
+  waitpid(groupPid, NULL, 0);
+  while(waitpid(-1 * groupPid, NULL, 0) >= 0);
+}
+
+/*Collects zombies of process group, returns non-zero if the group has finished*/
+char waitGroup(pid_t groupPid)
+{
+  pid_t pp = 0;
+  pid_t p = waitpid(groupPid, NULL, WNOHANG);
+  while(1)
+    {
+      pp = waitpid(-1 * groupPid, NULL, WNOHANG);
+      if (pp <= (pid_t)0)/*All zombies are collected, but there can be live processes*/
+	break;
+      /*yes, we have picked up real zombie and must try new waitpid(), there can be more*/
+    } /*while()*/
+  return p != (pid_t)0 && pp != (pid_t)0;
+}
+
+/*Drops synthesizer launched in advance for the queue item, if there is any*/
+void cancelPrefetch(QueueItem* item)
+{
+  assert(item);
+  if (item->prefetchOutput != -1)
+    {
+      close(item->prefetchOutput);
+      item->prefetchOutput = -1;
+    }
+  if (item->prefetchPid != (pid_t)0)
+    {
+      killGroup(item->prefetchPid);
+      item->prefetchPid = 0;
+    }
+}
+
 void popQueueFront()
 {
   if (!queueHead)
@@ -230,6 +333,7 @@ void popQueueFront()
       return;
     }
   assert(queueSize > 0);
+  cancelPrefetch(queueHead);
   if (queueHead->synthCommand)
     free(queueHead->synthCommand);
   if (queueHead->playerCommand)
@@ -259,36 +363,24 @@ void eraseQueue()
 
 char isPlaying()
 {
-  return pid != (pid_t)0 || playerPid != (pid_t)0;
+  return pid != (pid_t)0 || playerPid != (pid_t)0 || synthOutput != -1 || isWorkerBusy() || isAudioBusy();
 }
 
-void execute(char* synthCommand, char* playerCommand, char* text)
+/*Creates pipe closed on exec, children get the ends they need with dup2()*/
+int openPipe(int* pp)
 {
-  int pp[2];
-  int interPp[2];
-  size_t textLen = strlen(text);
-  ssize_t res;
-  assert(synthCommand);
-  assert(playerCommand);
-  assert(text);
-  assert(pid == (pid_t)0);
-  assert(playerPid == (pid_t)0);
   if (pipe(pp) == -1)
-    {
-      perror("pipe()");
-      fflush(stderr);
-      return;
-    }
-  if (pipe(interPp) == -1)
-    {
-      perror("pipe()");
-      fflush(stderr);
-      close(pp[0]);
-      close(pp[1]);
-      return;
-    }
-  pid = fork();
-  if (pid == (pid_t)-1)
+    return -1;
+  fcntl(pp[0], F_SETFD, FD_CLOEXEC);
+  fcntl(pp[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+}
+
+/*Launches synthesizer process group reading pp and writing interPp, returns zero if all pipes were closed due to an error*/
+pid_t executeSynth(char* synthCommand, int* pp, int* interPp)
+{
+  pid_t p = fork();
+  if (p == (pid_t)-1)
     {
       perror("fork()");
       fflush(stderr);
@@ -296,15 +388,15 @@ void execute(char* synthCommand, char* playerCommand, char* text)
       close(pp[1]);
       close(interPp[0]);
       close(interPp[1]);
-      pid = 0;
-      return;
+      return 0;
     }
-  if (pid == (pid_t)0)/*The child process*/
+  if (p == (pid_t)0)/*The child process*/
     {
       int fd = open(NULL_DEVICE, O_WRONLY);
       if (fd == -1)
 	exit(EXIT_FAILURE);
       setpgrp();
+      signal(SIGPIPE, SIG_DFL);
       close(pp[1]);/*Closing pipe input end*/
       close(interPp[0]);/*Closing pipe output end*/
       dup2(pp[0], STDIN_FILENO);
@@ -313,20 +405,43 @@ void execute(char* synthCommand, char* playerCommand, char* text)
       if (execlp("/bin/sh", "/bin/sh", "-c", synthCommand, NULL) == -1)
 	exit(EXIT_FAILURE);
     } /* child process*/
+  close(pp[0]);/*Closing output side of pipe*/
+  close(interPp[1]);
+  return p;
+}
+
+/*Writes text block to synthesizer stdin and closes it*/
+void writeText(int fd, char* text)
+{
+  size_t textLen = strlen(text);
+  ssize_t res = writeBuffer(fd, text, textLen);
+  if (res < 0)
+    {
+      perror("write()");
+      fflush(stderr);
+      close(fd);
+      return;
+    }
+  assert(res == (ssize_t)textLen);
+  if (writeBlock(fd, "\n", 1) == -1)
+    {
+      perror("write()");
+      fflush(stderr);
+    }
+  close(fd);
+}
+
+/*Launches player process reading synthesizer output, the descriptor is closed in any case, returns zero on error*/
+char executePlayer(char* playerCommand, int input)
+{
   playerPid = fork();
   if (playerPid == (pid_t)-1)
     {
       perror("fork()");
       fflush(stderr);
-      /*We cannot create new child process for player, closing all pipes and wait synth process*/
-      close(pp[0]);
-      close(pp[1]);
-      close(interPp[0]);
-      close(interPp[1]);
-      waitpid(pid, NULL, 0);
-      pid = 0;
+      close(input);
       playerPid = 0;
-      return;
+      return 0;
     }
   if (playerPid == (pid_t)0)/*player child process*/
     {
@@ -334,65 +449,224 @@ void execute(char* synthCommand, char* playerCommand, char* text)
       if (fd == -1)
 	exit(EXIT_FAILURE);
       setpgrp();
-      close(pp[0]);
-      close(pp[1]);
-      close(interPp[1]);/*Closing pipe input end*/
-      dup2(interPp[0], STDIN_FILENO);
+      signal(SIGPIPE, SIG_DFL);
+      dup2(input, STDIN_FILENO);
       dup2(fd, STDOUT_FILENO);
       dup2(fd, STDERR_FILENO);
       if (execlp("/bin/sh", "/bin/sh", "-c", playerCommand, NULL) == -1)
 	exit(EXIT_FAILURE);
     } /*player child process*/
-  close(interPp[0]);
-  close(interPp[1]);
-  close(pp[0]);/*Closing output side of pipe*/
-  res = writeBuffer(pp[1], text, textLen);
-  if (res < 0)
+  traceEvent(playingUtterance, "playerstart");
+  close(input);
+  return 1;
+}
+
+/*Makes synthesizer output to be read and played by executor itself through libao*/
+void setSynthOutput(int output)
+{
+  assert(synthOutput == -1);
+  synthOutput = output;
+  fcntl(synthOutput, F_SETFL, fcntl(synthOutput, F_GETFL) | O_NONBLOCK);
+}
+
+void execute(char* synthCommand, char* playerCommand, char* text, char libaoPlayer)
+{
+  int pp[2];
+  int interPp[2];
+  assert(synthCommand);
+  assert(playerCommand);
+  assert(text);
+  assert(pid == (pid_t)0);
+  assert(playerPid == (pid_t)0);
+  assert(synthOutput == -1);
+  /*With libao player command contains audio format*/
+  if (libaoPlayer && !audioStart(playerCommand))
+    return;
+  if (openPipe(pp) == -1)
     {
-      perror("write()");
+      perror("pipe()");
       fflush(stderr);
-      close(pp[1]);
+      if (libaoPlayer)
+	audioStop();
       return;
     }
-  assert(res == (ssize_t)textLen);
-  if (writeBlock(pp[1], "\n", 1) == -1)
+  if (openPipe(interPp) == -1)
     {
-      perror("write()");
+      perror("pipe()");
       fflush(stderr);
+      close(pp[0]);
+      close(pp[1]);
+      if (libaoPlayer)
+	audioStop();
+      return;
+    }
+  pid = executeSynth(synthCommand, pp, interPp);
+  if (pid == (pid_t)0)
+    {
+      if (libaoPlayer)
+	audioStop();
+      return;
     }
-  close(pp[1]);
+  traceEvent(playingUtterance, "synthstart");
+  if (libaoPlayer)/*Synthesizer output is read and played by executor itself*/
+    setSynthOutput(interPp[0]); else
+    if (!executePlayer(playerCommand, interPp[0]))
+      {
+	/*We cannot create new child process for player, closing text pipe and waiting synth process*/
+	close(pp[1]);
+	waitpid(pid, NULL, 0);
+	pid = 0;
+	return;
+      }
+  writeText(pp[1], text);
 }
 
-void playNext()
+/*Launches synthesizer of the queue item in advance, its output waits in the pipe until the item is played*/
+void prefetchItem(QueueItem* item)
 {
-  while(queueHead && queueHead->type == QUEUE_ITEM_TONE)
+  int pp[2];
+  int interPp[2];
+  assert(item);
+  assert(item->type == QUEUE_ITEM_TEXT);
+  assert(item->prefetchPid == (pid_t)0 && item->prefetchOutput == -1);
+  if (openPipe(pp) == -1)
+    return;
+  if (openPipe(interPp) == -1)
     {
-      playTone(queueHead->freq, queueHead->duration);
-      popQueueFront();
+      close(pp[0]);
+      close(pp[1]);
+      return;
     }
-  if (queueHead == NULL)/*No more queue items to play*/
+  /*Failure is not fatal, synthesizer just waits for the player with full pipe*/
+  fcntl(interPp[0], F_SETPIPE_SZ, LOOKAHEAD_PIPE_SIZE);
+  item->prefetchPid = executeSynth(item->synthCommand, pp, interPp);
+  if (item->prefetchPid == (pid_t)0)
+    return;
+  item->prefetchOutput = interPp[0];
+  traceEvent(item->utterance, "synthstart");
+  writeText(pp[1], item->text);
+}
+
+/*Launches synthesizers of the first lookahead queue items*/
+void prefetchQueue()
+{
+  QueueItem* item = queueHead;
+  size_t i;
+  for(i = 0;i < lookahead && item != NULL;i++, item = item->next)
+    if (item->type == QUEUE_ITEM_TEXT && item->prefetchOutput == -1 && item->prefetchPid == (pid_t)0 &&
+	strlen(item->text) < LOOKAHEAD_MAX_TEXT)
+      prefetchItem(item);
+}
+
+/*Collects synthesizers launched in advance which have finished their work*/
+void waitPrefetched()
+{
+  QueueItem* item = queueHead;
+  size_t i;
+  for(i = 0;i < lookahead && item != NULL;i++, item = item->next)
+    if (item->prefetchPid != (pid_t)0 && waitGroup(item->prefetchPid))
+      item->prefetchPid = 0;
+}
+
+/*
+ * Starts playback of the queue item synthesized in advance, audio already
+ * waiting in the pipe goes to player at once. It is gapless only with
+ * libao, command player is still launched here and opens the device.
+ */
+void executePrefetched(QueueItem* item)
+{
+  int output;
+  assert(item);
+  assert(item->prefetchOutput != -1);
+  assert(pid == (pid_t)0);
+  assert(playerPid == (pid_t)0);
+  assert(synthOutput == -1);
+  if (item->libaoPlayer && !audioStart(item->playerCommand))
+    return;/*synthesizer is cancelled with the queue item*/
+  output = item->prefetchOutput;
+  item->prefetchOutput = -1;
+  pid = item->prefetchPid;/*zero if synthesizer has already finished*/
+  item->prefetchPid = 0;
+  if (item->libaoPlayer)
     {
-      /*we must notify, there are no more items to play*/
-      printf("silence\n");
-      fflush(stdout);
+      setSynthOutput(output);
       return;
     }
-  execute(queueHead->synthCommand, queueHead->playerCommand, queueHead->text);
+  if (!executePlayer(item->playerCommand, output) && pid != (pid_t)0)
+    {
+      killGroup(pid);
+      pid = 0;
+    }
+}
+
+/*Registers the queue item to be launched, utterance is zero for tones*/
+void startItem(size_t utterance)
+{
+  itemPlaying = 1;
+  playingUtterance = utterance;
+  firstPcmTraced = 0;
+}
+
+void playNext()
+{
+  while(1)
+    {
+      if (queueHead == NULL)/*No more queue items to play*/
+	{
+	  /*we must notify, there are no more items to play*/
+	  printf("silence\n");
+	  fflush(stdout);
+	  return;
+	}
+      startItem(queueHead->utterance);
+      if (queueHead->type == QUEUE_ITEM_TONE)/*Tones are played by audio thread without blocking*/
+	{
+	  audioTone(queueHead->freq, queueHead->duration);
+	  popQueueFront();
+	  prefetchQueue();
+	  return;
+	}
+      if (queueHead->type != QUEUE_ITEM_PERSISTENT_TEXT)
+	break;
+      /*Persistent processes could fail to take text block, trying the next one in this case*/
+      if (workerSay(queueHead->synthCommand, queueHead->playerCommand, queueHead->text, queueHead->libaoPlayer, queueHead->utterance))
+	{
+	  popQueueFront();
+	  prefetchQueue();
+	  return;
+	}
+      popQueueFront();
+    } /*while(1)*/
+  if (queueHead->prefetchOutput != -1)
+    executePrefetched(queueHead); else
+    execute(queueHead->synthCommand, queueHead->playerCommand, queueHead->text, queueHead->libaoPlayer);
   popQueueFront();
+  prefetchQueue();
 }
 
 /*This function frees provided string buffers if necessary*/
-void play(char* synthCommand, char* playerCommand, char* text)
+void play(char* synthCommand, char* playerCommand, char* text, char persistent, char libaoPlayer, size_t utterance, char continuation)
 {
   assert(synthCommand);
   assert(playerCommand);
   assert(text);
   if (isPlaying())/*playback in progress now*/
     {
-      putTextItemToQueue(synthCommand, playerCommand, text);
+      putTextItemToQueue(synthCommand, playerCommand, text, persistent, libaoPlayer, utterance, continuation);
+      prefetchQueue();
+      return;
+    }
+  /*The first chunk of this text was dropped while the queue was full, the rest of it must not be spoken*/
+  if (continuation && lastTextDropped)
+    {
+      dropTextItem(synthCommand, playerCommand, text);
       return;
     }
-  execute(synthCommand, playerCommand, text);
+  lastTextDropped = 0;
+  startItem(utterance);
+  if (persistent)
+    workerSay(synthCommand, playerCommand, text, libaoPlayer, utterance); else
+    execute(synthCommand, playerCommand, text, libaoPlayer);
   free(synthCommand);
   free(playerCommand);
   free(text);
@@ -400,8 +674,20 @@ void play(char* synthCommand, char* playerCommand, char* text)
 
 void stop()
 {
-  eraseQueue();
-  if (!isPlaying())/*There is no playback now*/
+  char wasPlaying = isPlaying();
+  itemPlaying = 0;
+  playingUtterance = 0;
+  lastTextDropped = 0;
+  eraseQueue();/*synthesizers launched in advance are killed here*/
+  /*Persistent player can have buffered audio even if there is no text block in progress*/
+  workerStop();
+  audioStop();
+  if (synthOutput != -1)
+    {
+      close(synthOutput);
+      synthOutput = -1;
+    }
+  if (!wasPlaying)/*There is no playback now*/
     return;
   if (playerPid != (pid_t)0)
     {
@@ -415,10 +701,7 @@ void stop()
     }
   if (pid != (pid_t)0)
     {
-      kill(pid, SIGKILL);
-      killpg(pid, SIGKILL);
-      waitpid(pid, NULL, 0);
-      while(waitpid(-1 * pid, NULL, 0) >= 0);
+      killGroup(pid);
       pid = 0;
     }
   printf("stopped\n");
@@ -430,17 +713,21 @@ char processInputCommand(int fd)
 {
   CommandHeader header;
   ssize_t res;
+  char libaoPlayer, continuation;
   res = readBlock(fd, &header, sizeof(header));
   if (res < 0)
     onSystemCallError("read()", errno);
   if (res < sizeof(CommandHeader))
     return 0;
+  libaoPlayer = (header.code & COMMAND_PLAYER_LIBAO) != 0;
+  continuation = (header.code & COMMAND_CONTINUATION) != 0;
+  header.code &= ~(COMMAND_PLAYER_LIBAO | COMMAND_CONTINUATION);
   if (header.code == COMMAND_STOP)
     {
       stop();
       return 1;
     } /*COMMAND_STOP*/
-  if (header.code == COMMAND_SAY)
+  if (header.code == COMMAND_SAY || header.code == COMMAND_SAY_PERSISTENT)
     {
       char* synthCommand;
       char* playerCommand;
@@ -487,13 +774,17 @@ char processInputCommand(int fd)
 	  free(text);
 	  return 0;
 	}
-      play(synthCommand, playerCommand, text);
+      traceEvent(header.utterance, "received");
+      play(synthCommand, playerCommand, text, header.code == COMMAND_SAY_PERSISTENT, libaoPlayer, header.utterance, continuation);
       return 1;
     } /*COMMAND_EXECUTE*/
   if (header.code == COMMAND_TONE)
     {
       if (!isPlaying())
-	playTone(header.param1, header.param2); else 
+	{
+	  startItem(0);
+	  audioTone(header.param1, header.param2);
+	} else
 	putToneItemToQueue(header.param1, header.param2);
       return 1;
     } /*COMMAND_TONE*/
@@ -514,55 +805,76 @@ void handleSignals()
   if (wasSigChld)
     {
       wasSigChld = 0;
+      workersHandleSigChld();
+      waitPrefetched();
       if (!isPlaying())
 	return;
       /*synthesizer group processing*/
-      if (pid != (pid_t)0)
-	{
-	  pid_t pp = 0;
-	  pid_t p = waitpid(pid, NULL, WNOHANG);
-	  while(1)
-	    {
-	      pp = waitpid(-1 * pid, NULL, WNOHANG);
-	      if (pp <= (pid_t)0)/*All zombies are collected, but there can be live processes*/
-		break;
-	      /*yes, we have picked up real zombie and must try new waitpid(), there can be more*/
-	    } /*while()*/
-	  if (p != (pid_t)0 && pp != (pid_t)0)
-	    pid = 0;
-	} /*synthesizer group processing*/
+      if (pid != (pid_t)0 && waitGroup(pid))
+	pid = 0;
       /*player group processing*/
-      if (playerPid != (pid_t)0)
+      if (playerPid != (pid_t)0 && waitGroup(playerPid))
 	{
-	  pid_t pp = 0;
-	  pid_t p = waitpid(playerPid, NULL, WNOHANG);
-	  while(1)
-	    {
-	      pp = waitpid(-1 * playerPid, NULL, WNOHANG);
-	      if (pp <= (pid_t)0)/*All zombies are collected, but there can be live processes*/
-		break;
-	      /*yes, we have picked up real zombie and must try new waitpid(), there can be more*/
-	    } /*while()*/
-	  if (p != (pid_t)0 && pp != (pid_t)0)
-	    playerPid = 0;
-	} /*player group processing*/
+	  playerPid = 0;
+	  itemFinished();
+	}
       if (isPlaying())
 	return;
+      /*libao notification could come before synthesizer exit and could not finish the item*/
+      itemFinished();
       playNext();
     }
 }
 
+/*Reads synthesizer output to be played with libao*/
+void readSynthOutput()
+{
+  char buf[IO_BUF_SIZE];
+  size_t toRead = audioFreeSpace();
+  ssize_t res;
+  assert(synthOutput != -1);
+  if (toRead > sizeof(buf))
+    toRead = sizeof(buf);
+  if (toRead == 0)
+    return;
+  res = read(synthOutput, buf, toRead);
+  if (res > 0)
+    {
+      traceFirstPcm();
+      audioWrite(buf, (size_t)res);
+      return;
+    }
+  if (res == -1 && (errno == EAGAIN || errno == EINTR))
+    return;
+  /*Synthesizer has finished its work*/
+  close(synthOutput);
+  synthOutput = -1;
+  audioFinish();
+}
+
 int mainLoop(int fd, sigset_t* sigMask)
 {
   /*Endless loop for all commands*/
   while(1)
     {
       /*Preparing for pselect() call*/
-      fd_set fds;
+      fd_set fds, writeFds;
+      int maxFd;
+      int workersRes;
       FD_ZERO(&fds);
+      FD_ZERO(&writeFds);
       FD_SET(fd, &fds);
+      FD_SET(audioNotify, &fds);
+      maxFd = fd > audioNotify?fd:audioNotify;
+      if (synthOutput != -1 && audioFreeSpace() > 0)
+	{
+	  FD_SET(synthOutput, &fds);
+	  if (synthOutput > maxFd)
+	    maxFd = synthOutput;
+	}
+      maxFd = workersFillFdSets(&fds, &writeFds, maxFd);
       /*Calling pselect()*/
-      if (pselect(fd + 1, &fds, NULL, NULL, NULL, sigMask) == -1)
+      if (pselect(maxFd + 1, &fds, &writeFds, NULL, NULL, sigMask) == -1)
 	{
 	  /*pselect() has returned -1, what the problem*/
 	  int errorCode = errno;
@@ -576,7 +888,21 @@ int mainLoop(int fd, sigset_t* sigMask)
 	  /*it is an unexpected system call error, we must stop processing*/
 	  onSystemCallError("pselect()", errorCode);
 	} /*if (pselect() == -1)*/
-      assert(FD_ISSET(fd, &fds));
+      /*Audio data is handled before new commands to not delay playback*/
+      if (synthOutput != -1 && FD_ISSET(synthOutput, &fds))
+	readSynthOutput();
+      workersRes = workersProcessFdSets(&fds, &writeFds);
+      if (FD_ISSET(audioNotify, &fds) && audioProcessNotification() && !isPlaying())
+	{
+	  itemFinished();
+	  playNext();
+	}
+      if (workersRes == WORKER_UTTERANCE_FINISHED && !isAudioBusy())/*Persistent player has got all audio data*/
+	itemFinished();
+      if (!isPlaying() && workersRes == WORKER_UTTERANCE_FINISHED)
+	playNext();
+      if (!FD_ISSET(fd, &fds))
+	continue;
       if (!processInputCommand(fd))/*this function returnes zero if fd was closed*/
 	return 0;
     } /*while(1)*/
@@ -588,6 +914,8 @@ int main(int argc, char* argv[])
   struct sigaction sa;
   sigset_t origMask, blockedMask;
   setlocale(LC_ALL, "");
+  if (getenv("VOICEMAN_LOOKAHEAD") != NULL)
+    lookahead = strtoul(getenv("VOICEMAN_LOOKAHEAD"), NULL, 10);
   /*Installing SIGCHLD signal handler*/
   sigaction(SIGCHLD, NULL, &sa);
   sa.sa_handler = sigChldHandler;
@@ -598,7 +926,11 @@ int main(int argc, char* argv[])
   sigaddset(&blockedMask, SIGCHLD);
   sigprocmask(SIG_BLOCK, &blockedMask, &origMask);
   toneInit();
+  audioNotify = audioInit();
+  workersInit();
   exitCode = mainLoop(STDIN_FILENO, &origMask);
+  workersClose();
+  audioClose();
   toneClose();
   return exitCode;
 }
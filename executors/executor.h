@@ -0,0 +1,68 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_EXECUTOR_H__
+#define __VOICEMAN_EXECUTOR_H__
+
+/*
+ * Declarations shared by the executor modules: default.c reads commands
+ * and runs one-shot processes, workers.c serves persistent outputs,
+ * audio.c plays audio through libao and tone.c generates tones for it.
+ */
+
+#include<stddef.h>
+#include<sys/types.h>
+#include<sys/select.h>
+
+#define ERROR_PREFIX "voiceman-executor:"
+#define NULL_DEVICE "/dev/null"
+
+/*Values returned by workersProcessFdSets()*/
+#define WORKER_UTTERANCE_FINISHED 1
+
+/*default.c*/
+void traceEvent(size_t utterance, const char* event);
+void traceFirstPcm();
+
+/*tone.c*/
+void toneInit();
+void toneClose();
+void toneStart(size_t freq, size_t lengthMs, int rate);
+void toneCancel();
+size_t toneGenerate(short* buf, size_t maxFrames, int channels);
+
+/*workers.c*/
+void workersInit();
+void workersClose();
+char isWorkerBusy();
+char workerSay(const char* synthCommand, const char* playerCommand, const char* text, char libaoPlayer, size_t utterance);
+void workerStop();
+int workersFillFdSets(fd_set* readFds, fd_set* writeFds, int maxFd);
+int workersProcessFdSets(fd_set* readFds, fd_set* writeFds);
+void workersHandleSigChld();
+
+/*audio.c*/
+int audioInit();
+void audioClose();
+char audioStart(const char* formatSpec);
+void audioTone(size_t freq, size_t lengthMs);
+size_t audioWrite(const void* buf, size_t len);
+size_t audioFreeSpace();
+void audioFinish();
+void audioStop();
+char isAudioBusy();
+char audioProcessNotification();
+
+#endif /*__VOICEMAN_EXECUTOR_H__*/
@@ -18,9 +18,10 @@
 
 /*
  * This header declares the CommandHeader structure used for executor
- * commands transmission. This structure has command code and three
- * unsigned integer parameters. Parameters purpose depends on command
- * code and is described below for each command separately.
+ * commands transmission. This structure has command code, three
+ * unsigned integer parameters and utterance ID. Parameters purpose
+ * depends on command code and is described below for each command
+ * separately.
  *
  * COMMAND_SAY: The command to initiate text block speak or enqueue this
  * text block if executor is busy. Three parameters contain string length
@@ -43,18 +44,68 @@
  * first parameter is used. It specifies number of possible items in
  * playback queue. Special value 0 can be used to disable queue size
  * limit checking.
+ *
+ * COMMAND_SAY_PERSISTENT: The same as COMMAND_SAY with the same
+ * parameters, but synthesizer and player are long-lived processes
+ * shared by all text blocks with equal command lines. The synthesizer
+ * receives text blocks on its stdin, one block per line, and must
+ * answer on its stdout with a sequence of audio data frames. Each frame
+ * is prefixed with WORKER_FRAME_HEADER_SIZE bytes of data length in
+ * little-endian byte order, the frame with zero length marks the end of
+ * the text block. The executor copies frames data to stdin of the
+ * player which must play raw audio stream until its stdin is closed.
+ *
+ * COMMAND_PLAYER_LIBAO: The flag to be combined with COMMAND_SAY or
+ * COMMAND_SAY_PERSISTENT codes. It means synthesizer output must be
+ * played by executor itself through libao device instead of player
+ * process. Player command string contains audio format in this case as
+ * "RATE CHANNELS FORMAT", where format can be "s8", "u8", "s16le" or
+ * "s16be".
+ *
+ * COMMAND_CONTINUATION: The flag to be combined with COMMAND_SAY or
+ * COMMAND_SAY_PERSISTENT codes. It means the text block is the next
+ * chunk of the text split by the daemon. Such block is not checked
+ * against the queue size limit, it is enqueued if the previous text
+ * block was accepted and is dropped with "queuelimit" otherwise, so a
+ * long text is never cut in the middle.
+ *
+ * The utterance ID is used only with COMMAND_SAY and
+ * COMMAND_SAY_PERSISTENT and must be zero for other commands. Non-zero
+ * value asks executor to report the stages of the text block playback
+ * on its stdout as lines "trace ID EVENT SECONDS", where SECONDS is
+ * the CLOCK_MONOTONIC time of the event with fractional part. The
+ * events are "received" when the command is read, "synthstart" when
+ * synthesizer process is launched or gets the text block,
+ * "playerstart" when player process is launched, "firstpcm" when the
+ * first audio data passes through executor and "playerexit" when the
+ * playback is over. Executor does not see audio data sent by
+ * synthesizer directly to player process, so there is no "firstpcm"
+ * event in this case. With persistent player "playerexit" means all
+ * audio data of the text block is written to the player. Stopped text
+ * blocks have no "playerexit" event.
+ *
+ * Regardless of the utterance ID executor prints "played" line each
+ * time the playback of a text block or a tone is over, so the number of
+ * items waiting in its queue can be counted by the daemon.
  */
 
 #define COMMAND_SAY 0
 #define COMMAND_STOP 1
 #define COMMAND_TONE 2
 #define COMMAND_SET_QUEUE_LIMIT 3
+#define COMMAND_SAY_PERSISTENT 4
+
+#define COMMAND_PLAYER_LIBAO 0x100
+#define COMMAND_CONTINUATION 0x200
+
+#define WORKER_FRAME_HEADER_SIZE 4
 
 typedef struct {
   int code;
   size_t param1;
   size_t param2;
   size_t param3;
+  size_t utterance;
 } CommandHeader;
 
 #endif
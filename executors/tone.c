@@ -13,70 +13,72 @@
    General Public License for more details.
 */
 
+/*
+ * Tone signal generation. One period of sine wave is calculated once
+ * into the table and tones of any frequency are produced from it with
+ * 32-bit fixed-point phase accumulator, so no libm calls are made
+ * during playback. Generated samples are played by the audio thread
+ * through the same libao device as speech (see audio.c).
+ */
+
 #include<assert.h>
 #include<stdlib.h>
+#include<stdint.h>
 #include<math.h>
-#include<strings.h>
-#include<string.h>
-#include<ao/ao.h>
+#include"executor.h"
 
-#define VOICEMAN_LIBAO_DRIVER "VOICEMAN_LIBAO_DRIVER"
+/*The table size must be power of two, upper bits of phase are used as an index*/
+#define WAVETABLE_BITS 12
+#define WAVETABLE_SIZE (1 << WAVETABLE_BITS)
+#define TONE_AMPLITUDE (0.75 * 32767.0)
 
-static char* libAoDriver = NULL;
+static short wavetable[WAVETABLE_SIZE];
+static uint32_t phase = 0;
+static uint32_t increment = 0;
+static size_t framesLeft = 0;
 
 void toneInit()
 {
-  libAoDriver = getenv(VOICEMAN_LIBAO_DRIVER);
-  if (libAoDriver != NULL && strlen(libAoDriver) < 1)
-    libAoDriver = NULL;
-  ao_initialize();
+  size_t i;
+  for(i = 0;i < WAVETABLE_SIZE;i++)
+    wavetable[i] = (short)(TONE_AMPLITUDE * sin(2 * M_PI * (double)i / WAVETABLE_SIZE));
 }
 
 void toneClose()
 {
-  ao_shutdown();
+  framesLeft = 0;
 }
 
-void playTone(size_t fr, size_t lengthMs)
+/*Prepares generation of new tone signal with specified sample rate*/
+void toneStart(size_t freq, size_t lengthMs, int rate)
 {
-  ao_device *device = NULL;
-  ao_sample_format format;
-  int driver;
-  float freq=fr;
-  size_t bufSize = 0;
-  char* buffer = NULL;
-  size_t samplesToPlay = 0;
+  assert(rate > 0);
+  phase = 0;
+  /*The phase increment is freq/rate of the full period in 2^32 units*/
+  increment = (uint32_t)(((uint64_t)freq << 32) / (uint64_t)rate);
+  framesLeft = (size_t)((uint64_t)rate * lengthMs / 1000);
+}
+
+void toneCancel()
+{
+  framesLeft = 0;
+}
+
+/*Writes next portion of 16-bit samples to the buffer, returns number of generated frames*/
+size_t toneGenerate(short* buf, size_t maxFrames, int channels)
+{
+  const size_t count = maxFrames < framesLeft?maxFrames:framesLeft;
   size_t i;
-  assert(fr >= 0 && lengthMs >= 10);
-  bzero(&format, sizeof(ao_sample_format));
-  driver = libAoDriver != NULL?ao_driver_id(libAoDriver):ao_default_driver_id();
-  format.bits = 16;
-  format.channels = 2;
-  format.rate = 44100;
-  format.byte_format = AO_FMT_LITTLE;
-  samplesToPlay = format.rate*lengthMs/1000;
-  device = ao_open_live(driver, &format, NULL);
-  if (device == NULL) 
-    {
-      ao_shutdown();
-      return;
-    }
-  bufSize = format.bits/8 * format.channels * samplesToPlay;
-  buffer = (char*)calloc(bufSize, sizeof(char));
-  if (buffer == NULL)
-    {
-      ao_close(device);
-      ao_shutdown();
-      return;
-    }
-  for (i = 0; i < samplesToPlay; i++) 
+  int c;
+  assert(buf);
+  assert(channels > 0);
+  for(i = 0;i < count;i++)
     {
-      int sample = (int)(0.75 * 32768.0 *
-			 sin(2 * M_PI * freq * ((float) i/format.rate)));
-      buffer[4*i] = buffer[4*i+2] = sample & 0xff;
-      buffer[4*i+1] = buffer[4*i+3] = (sample >> 8) & 0xff;
+      const short sample = wavetable[phase >> (32 - WAVETABLE_BITS)];
+      for(c = 0;c < channels;c++)
+	buf[i * channels + c] = sample;
+      phase += increment;
     }
-  ao_play(device, buffer, bufSize);
-  free(buffer);
-  ao_close(device);
+  framesLeft -= count;
+  return count;
 }
@@ -0,0 +1,543 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * Long-lived synthesizer and player processes for outputs with
+ * persistent mode. The synthesizer gets one text block per line and
+ * answers with framed audio data (see executorCommandHeader.h), the
+ * player gets raw audio stream. Both pipes are written without
+ * blocking, so a synthesizer sending audio before reading the whole
+ * line cannot stall the executor. Both are spawned on first use and are
+ * kept running between text blocks, so no process is created for
+ * regular utterances. On stop the synthesizer busy with the text block
+ * and the player are killed to drop the rest of the audio, they are
+ * spawned again on next use.
+ */
+
+#include<assert.h>
+#include<stdlib.h>
+#include<stdio.h>
+#include<string.h>
+#include<sys/types.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/select.h>
+#include<sys/wait.h>
+#include<signal.h>
+#include<errno.h>
+#include"executorCommandHeader.h"
+#include"executor.h"
+
+#define MAX_SYNTH_WORKERS 4
+#define MAX_RETIRED_WORKERS 8
+#define WORKER_BUF_SIZE 65536
+#define WORKER_READ_SIZE 4096
+
+typedef struct Worker_
+{
+  char* command;
+  pid_t pid;
+  int inFd;
+  int outFd;
+  unsigned long lastUsed;
+} Worker;
+
+static Worker synthWorkers[MAX_SYNTH_WORKERS];
+static Worker player;
+static pid_t retiredWorkers[MAX_RETIRED_WORKERS];
+static unsigned long useCounter = 0;
+
+/*Current utterance state*/
+static Worker* currentSynth = NULL;
+static char busy = 0;
+static char synthDone = 0;
+static char playerDirty = 0;
+static char libao = 0;
+static unsigned char frameHeader[WORKER_FRAME_HEADER_SIZE];
+static size_t frameHeaderPos = 0;
+static size_t frameRemaining = 0;
+
+/*Text line waiting to be written to synthesizer*/
+static char* synthText = NULL;
+static size_t synthTextSize = 0;
+static size_t synthTextPos = 0;
+
+/*Audio data waiting to be written to player*/
+static char playerBuf[WORKER_BUF_SIZE];
+static size_t playerBufSize = 0;
+
+static void initWorker(Worker* w)
+{
+  w->command = NULL;
+  w->pid = 0;
+  w->inFd = -1;
+  w->outFd = -1;
+  w->lastUsed = 0;
+}
+
+static void setFdFlags(int fd, char nonBlocking)
+{
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (nonBlocking)
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/*Launches command with pipes to its stdin and optionally to its stdout, returns zero on error*/
+static char spawnWorker(Worker* w, const char* command, char withOutput)
+{
+  int inPp[2];
+  int outPp[2] = {-1, -1};
+  assert(w->pid == 0);
+  assert(command);
+  if (pipe(inPp) == -1)
+    {
+      perror("pipe()");
+      fflush(stderr);
+      return 0;
+    }
+  if (withOutput && pipe(outPp) == -1)
+    {
+      perror("pipe()");
+      fflush(stderr);
+      close(inPp[0]);
+      close(inPp[1]);
+      return 0;
+    }
+  w->pid = fork();
+  if (w->pid == (pid_t)-1)
+    {
+      perror("fork()");
+      fflush(stderr);
+      close(inPp[0]);
+      close(inPp[1]);
+      if (withOutput)
+	{
+	  close(outPp[0]);
+	  close(outPp[1]);
+	}
+      w->pid = 0;
+      return 0;
+    }
+  if (w->pid == (pid_t)0)/*The child process*/
+    {
+      int fd = open(NULL_DEVICE, O_WRONLY);
+      if (fd == -1)
+	exit(EXIT_FAILURE);
+      setpgrp();
+      signal(SIGPIPE, SIG_DFL);
+      close(inPp[1]);
+      dup2(inPp[0], STDIN_FILENO);
+      if (withOutput)
+	{
+	  close(outPp[0]);
+	  dup2(outPp[1], STDOUT_FILENO);
+	} else
+	dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      if (execlp("/bin/sh", "/bin/sh", "-c", command, NULL) == -1)
+	exit(EXIT_FAILURE);
+    } /*child process*/
+  close(inPp[0]);
+  w->inFd = inPp[1];
+  setFdFlags(w->inFd, 1);
+  if (withOutput)
+    {
+      close(outPp[1]);
+      w->outFd = outPp[0];
+      setFdFlags(w->outFd, 1);
+    }
+  w->command = strdup(command);
+  if (w->command == NULL)
+    {
+      fprintf(stderr, "%sno enough free memory\n", ERROR_PREFIX);
+      fflush(stderr);
+      exit(EXIT_FAILURE);
+    }
+  return 1;
+}
+
+/*Closes worker pipes letting it finish its work, the process is picked up later*/
+static void retireWorker(Worker* w)
+{
+  size_t i;
+  if (w->inFd != -1)
+    close(w->inFd);
+  if (w->outFd != -1)
+    close(w->outFd);
+  if (w->command)
+    free(w->command);
+  if (w->pid != 0)
+    {
+      for(i = 0;i < MAX_RETIRED_WORKERS;i++)
+	if (retiredWorkers[i] == 0)
+	  break;
+      if (i >= MAX_RETIRED_WORKERS)
+	{
+	  /*No more space to store process to pick up, waiting the oldest one*/
+	  killpg(retiredWorkers[0], SIGKILL);
+	  kill(retiredWorkers[0], SIGKILL);
+	  waitpid(retiredWorkers[0], NULL, 0);
+	  while(waitpid(-1 * retiredWorkers[0], NULL, 0) >= 0);
+	  memmove(&retiredWorkers[0], &retiredWorkers[1], sizeof(pid_t) * (MAX_RETIRED_WORKERS - 1));
+	  i = MAX_RETIRED_WORKERS - 1;
+	}
+      retiredWorkers[i] = w->pid;
+    }
+  initWorker(w);
+}
+
+static void killWorker(Worker* w)
+{
+  if (w->pid != 0)
+    {
+      kill(w->pid, SIGKILL);
+      killpg(w->pid, SIGKILL);
+      waitpid(w->pid, NULL, 0);
+      while(waitpid(-1 * w->pid, NULL, 0) >= 0);
+      w->pid = 0;
+    }
+  retireWorker(w);
+}
+
+/*Returns synthesizer worker with specified command line, launching it if necessary*/
+static Worker* getSynthWorker(const char* command)
+{
+  Worker* w = NULL;
+  size_t i;
+  for(i = 0;i < MAX_SYNTH_WORKERS;i++)
+    if (synthWorkers[i].pid != 0 && strcmp(synthWorkers[i].command, command) == 0)
+      {
+	synthWorkers[i].lastUsed = ++useCounter;
+	return &synthWorkers[i];
+      }
+  /*Taking free slot or the least recently used one*/
+  for(i = 0;i < MAX_SYNTH_WORKERS;i++)
+    {
+      if (synthWorkers[i].pid == 0)
+	{
+	  w = &synthWorkers[i];
+	  break;
+	}
+      if (w == NULL || synthWorkers[i].lastUsed < w->lastUsed)
+	w = &synthWorkers[i];
+    }
+  assert(w != NULL);
+  assert(w != currentSynth);
+  if (w->command != NULL)
+    retireWorker(w);
+  if (!spawnWorker(w, command, 1))
+    return NULL;
+  w->lastUsed = ++useCounter;
+  return w;
+}
+
+void workersInit()
+{
+  size_t i;
+  for(i = 0;i < MAX_SYNTH_WORKERS;i++)
+    initWorker(&synthWorkers[i]);
+  initWorker(&player);
+  for(i = 0;i < MAX_RETIRED_WORKERS;i++)
+    retiredWorkers[i] = 0;
+  /*Write errors on closed pipes are handled explicitly*/
+  signal(SIGPIPE, SIG_IGN);
+}
+
+void workersClose()
+{
+  size_t i;
+  for(i = 0;i < MAX_SYNTH_WORKERS;i++)
+    retireWorker(&synthWorkers[i]);
+  retireWorker(&player);
+  for(i = 0;i < MAX_RETIRED_WORKERS;i++)
+    if (retiredWorkers[i] != 0)
+      {
+	waitpid(retiredWorkers[i], NULL, 0);
+	retiredWorkers[i] = 0;
+      }
+}
+
+char isWorkerBusy()
+{
+  return busy;
+}
+
+static void freeSynthText()
+{
+  if (synthText != NULL)
+    free(synthText);
+  synthText = NULL;
+  synthTextSize = 0;
+  synthTextPos = 0;
+}
+
+/*Writes as much of the pending text line as synthesizer accepts, returns zero on error*/
+static char writeSynthText()
+{
+  while(synthTextPos < synthTextSize)
+    {
+      const ssize_t res = write(currentSynth->inFd, &synthText[synthTextPos], synthTextSize - synthTextPos);
+      if (res == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno == EAGAIN)
+	    return 1;
+	  perror("write()");
+	  fflush(stderr);
+	  return 0;
+	}
+      synthTextPos += (size_t)res;
+    } /*while()*/
+  freeSynthText();
+  return 1;
+}
+
+/*Starts speaking of text block with persistent processes, returns zero if text block cannot be spoken*/
+char workerSay(const char* synthCommand, const char* playerCommand, const char* text, char libaoPlayer, size_t utterance)
+{
+  size_t textLen = strlen(text);
+  char* line;
+  size_t i;
+  assert(synthCommand);
+  assert(playerCommand);
+  assert(text);
+  assert(!busy);
+  if (libaoPlayer)/*Player command contains audio format*/
+    {
+      if (!audioStart(playerCommand))
+	return 0;
+    } else
+    {
+      if (player.pid != 0 && strcmp(player.command, playerCommand) != 0)
+	retireWorker(&player);
+      if (player.pid == 0)
+	{
+	  if (!spawnWorker(&player, playerCommand, 0))
+	    return 0;
+	  traceEvent(utterance, "playerstart");
+	  playerDirty = 0;
+	}
+    }
+  libao = libaoPlayer;
+  currentSynth = getSynthWorker(synthCommand);
+  if (currentSynth == NULL)
+    {
+      if (libao)
+	audioStop();
+      return 0;
+    }
+  /*Text block must be sent as the single line*/
+  while(textLen > 0 && (text[textLen - 1] == '\n' || text[textLen - 1] == '\r'))
+    textLen--;
+  line = (char*)malloc(textLen + 1);
+  if (line == NULL)
+    {
+      fprintf(stderr, "%sno enough free memory\n", ERROR_PREFIX);
+      fflush(stderr);
+      exit(EXIT_FAILURE);
+    }
+  for(i = 0;i < textLen;i++)
+    line[i] = (text[i] == '\n' || text[i] == '\r')?' ':text[i];
+  line[textLen] = '\n';
+  /*The rest of the line not accepted by the pipe is written by workersProcessFdSets()*/
+  assert(synthText == NULL);
+  synthText = line;
+  synthTextSize = textLen + 1;
+  synthTextPos = 0;
+  if (!writeSynthText())
+    {
+      freeSynthText();
+      killWorker(currentSynth);
+      currentSynth = NULL;
+      if (libao)
+	audioStop();
+      return 0;
+    }
+  traceEvent(utterance, "synthstart");
+  busy = 1;
+  synthDone = 0;
+  frameHeaderPos = 0;
+  frameRemaining = 0;
+  playerBufSize = 0;
+  return 1;
+}
+
+void workerStop()
+{
+  playerBufSize = 0;
+  freeSynthText();
+  if (busy)
+    {
+      /*Synthesizer can spend long time on the rest of the text block, the new one must not wait for it*/
+      if (!synthDone && currentSynth != NULL)
+	killWorker(currentSynth);
+      busy = 0;
+      currentSynth = NULL;
+    }
+  /*Killing player is the only way to drop audio it has buffered*/
+  if (player.pid != 0 && playerDirty)
+    killWorker(&player);
+}
+
+int workersFillFdSets(fd_set* readFds, fd_set* writeFds, int maxFd)
+{
+  if (!busy)
+    return maxFd;
+  if (synthText != NULL && currentSynth != NULL)
+    {
+      FD_SET(currentSynth->inFd, writeFds);
+      if (currentSynth->inFd > maxFd)
+	maxFd = currentSynth->inFd;
+    }
+  if (!synthDone && currentSynth != NULL && playerBufSize + WORKER_READ_SIZE <= WORKER_BUF_SIZE)
+    {
+      FD_SET(currentSynth->outFd, readFds);
+      if (currentSynth->outFd > maxFd)
+	maxFd = currentSynth->outFd;
+    }
+  if (playerBufSize > 0 && !libao && player.pid != 0)
+    {
+      FD_SET(player.inFd, writeFds);
+      if (player.inFd > maxFd)
+	maxFd = player.inFd;
+    }
+  return maxFd;
+}
+
+/*Splits data read from synthesizer onto frames, copying audio data to player buffer*/
+static void processSynthData(const unsigned char* buf, size_t len)
+{
+  size_t pos = 0;
+  while(pos < len && !synthDone)
+    {
+      if (frameRemaining == 0)
+	{
+	  frameHeader[frameHeaderPos++] = buf[pos++];
+	  if (frameHeaderPos < WORKER_FRAME_HEADER_SIZE)
+	    continue;
+	  frameHeaderPos = 0;
+	  frameRemaining = (size_t)frameHeader[0] | ((size_t)frameHeader[1] << 8) | ((size_t)frameHeader[2] << 16) | ((size_t)frameHeader[3] << 24);
+	  if (frameRemaining == 0)
+	    synthDone = 1;
+	  continue;
+	}
+      {
+	const size_t toCopy = len - pos < frameRemaining?len - pos:frameRemaining;
+	traceFirstPcm();
+	assert(playerBufSize + toCopy <= WORKER_BUF_SIZE);
+	memcpy(&playerBuf[playerBufSize], &buf[pos], toCopy);
+	playerBufSize += toCopy;
+	pos += toCopy;
+	frameRemaining -= toCopy;
+      }
+    } /*while()*/
+  if (pos < len)
+    {
+      fprintf(stderr, "%ssynthesizer has sent data after the end of text block\n", ERROR_PREFIX);
+      fflush(stderr);
+    }
+}
+
+int workersProcessFdSets(fd_set* readFds, fd_set* writeFds)
+{
+  if (!busy)
+    return 0;
+  if (synthText != NULL && currentSynth != NULL && FD_ISSET(currentSynth->inFd, writeFds) && !writeSynthText())
+    {
+      fprintf(stderr, "%ssynthesizer \'%s\' does not accept text anymore\n", ERROR_PREFIX, currentSynth->command);
+      fflush(stderr);
+      killWorker(currentSynth);
+      currentSynth = NULL;
+      synthDone = 1;
+    }
+  if (!synthDone && currentSynth != NULL && FD_ISSET(currentSynth->outFd, readFds))
+    {
+      unsigned char buf[WORKER_READ_SIZE];
+      const ssize_t res = read(currentSynth->outFd, buf, sizeof(buf));
+      if (res > 0)
+	processSynthData(buf, (size_t)res); else
+	if (res == 0 || (errno != EAGAIN && errno != EINTR))
+	  {
+	    fprintf(stderr, "%ssynthesizer \'%s\' has closed its stdout unexpectedly\n", ERROR_PREFIX, currentSynth->command);
+	    fflush(stderr);
+	    killWorker(currentSynth);
+	    currentSynth = NULL;
+	    synthDone = 1;
+	  }
+    }
+  if (playerBufSize > 0 && libao)
+    {
+      const size_t res = audioWrite(playerBuf, playerBufSize);
+      memmove(playerBuf, &playerBuf[res], playerBufSize - res);
+      playerBufSize -= res;
+    }
+  if (playerBufSize > 0 && !libao && player.pid != 0 && FD_ISSET(player.inFd, writeFds))
+    {
+      const ssize_t res = write(player.inFd, playerBuf, playerBufSize);
+      if (res > 0)
+	{
+	  playerDirty = 1;
+	  memmove(playerBuf, &playerBuf[res], playerBufSize - (size_t)res);
+	  playerBufSize -= (size_t)res;
+	} else
+	if (res == -1 && errno != EAGAIN && errno != EINTR)
+	  {
+	    perror("write()");
+	    fflush(stderr);
+	    killWorker(&player);
+	    playerBufSize = 0;
+	  }
+    }
+  if (!libao && player.pid == 0)
+    playerBufSize = 0;
+  if (!synthDone || playerBufSize > 0)
+    return 0;
+  freeSynthText();
+  busy = 0;
+  currentSynth = NULL;
+  /*libao playback is finished later, the audio thread notifies about it*/
+  if (libao)
+    audioFinish();
+  return WORKER_UTTERANCE_FINISHED;
+}
+
+/*Picks up zombies of exited workers*/
+void workersHandleSigChld()
+{
+  size_t i;
+  for(i = 0;i < MAX_SYNTH_WORKERS;i++)
+    if (synthWorkers[i].pid != 0 && waitpid(synthWorkers[i].pid, NULL, WNOHANG) > 0)
+      {
+	while(waitpid(-1 * synthWorkers[i].pid, NULL, WNOHANG) > 0);
+	synthWorkers[i].pid = 0;
+	/*Stdout of current synthesizer must be read until the end*/
+	if (&synthWorkers[i] != currentSynth)
+	  retireWorker(&synthWorkers[i]);
+      }
+  if (player.pid != 0 && waitpid(player.pid, NULL, WNOHANG) > 0)
+    {
+      while(waitpid(-1 * player.pid, NULL, WNOHANG) > 0);
+      player.pid = 0;
+      retireWorker(&player);
+      playerBufSize = 0;
+    }
+  for(i = 0;i < MAX_RETIRED_WORKERS;i++)
+    if (retiredWorkers[i] != 0 && waitpid(retiredWorkers[i], NULL, WNOHANG) != 0)
+      {
+	while(waitpid(-1 * retiredWorkers[i], NULL, WNOHANG) > 0);
+	retiredWorkers[i] = 0;
+      }
+}
@@ -364,3 +364,51 @@ vm_result_t vm_family(vm_connection_t con, unsigned char lang, char* family)
   free(buf);
   return VOICEMAN_OK;
 }
+
+/*Reads statistics report terminated with empty line, buf always gets terminating '\0'*/
+vm_result_t vm_stats(vm_connection_t con, char* buf, size_t bufSize)
+{
+  size_t c = 0;
+  assert(con != VOICEMAN_BAD_CONNECTION);
+  if (con == VOICEMAN_BAD_CONNECTION)
+    return VOICEMAN_ERROR;
+  assert(buf);
+  if (!buf || bufSize == 0)
+    return VOICEMAN_ERROR;
+  buf[0] = '\0';
+  if (writeblock(con, "I:\n", 3) == -1)
+    return VOICEMAN_ERROR;
+  while(c + 1 < bufSize)
+    {
+      ssize_t res = read(con, &buf[c], bufSize - c - 1);
+      if (res == -1 && errno == EINTR)
+	continue;
+      if (res <= 0)
+	{
+	  buf[c] = '\0';
+	  return VOICEMAN_ERROR;
+	}
+      c += (size_t)res;
+      buf[c] = '\0';
+      /*The report is terminated by empty line*/
+      if ((c == 1 && buf[0] == '\n') || (c >= 2 && buf[c - 2] == '\n' && buf[c - 1] == '\n'))
+	return VOICEMAN_OK;
+    } /*while();*/
+  return VOICEMAN_ERROR;
+}
+
+/*Sends raw protocol line, the new line character is appended*/
+vm_result_t vm_send_line(vm_connection_t con, char* line, size_t len)
+{
+  assert(con != VOICEMAN_BAD_CONNECTION);
+  if (con == VOICEMAN_BAD_CONNECTION)
+    return VOICEMAN_ERROR;
+  assert(line || len == 0);
+  if (!line && len > 0)
+    return VOICEMAN_ERROR;
+  if (len > 0 && writebuf(con, line, len) == -1)
+    return VOICEMAN_ERROR;
+  if (writeblock(con, "\n", 1) == -1)
+    return VOICEMAN_ERROR;
+  return VOICEMAN_OK;
+}
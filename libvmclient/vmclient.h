@@ -50,5 +50,7 @@ EXTC vm_result_t vm_rate(vm_connection_t con, unsigned char value);
 EXTC vm_result_t vm_volume(vm_connection_t con, unsigned char value);
 EXTC vm_result_t vm_procmode(vm_connection_t con, unsigned char procmode);
 EXTC vm_result_t vm_family(vm_connection_t con, unsigned char lang, char* family);
+EXTC vm_result_t vm_stats(vm_connection_t con, char* buf, size_t bufSize);
+EXTC vm_result_t vm_send_line(vm_connection_t con, char* line, size_t len);
 
 #endif /*__VOICEMAN_VMCLIENT_H__*/
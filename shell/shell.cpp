@@ -37,6 +37,8 @@
 #define PUNC_HEAD "punc"
 #define FAMILY_HEAD "family"
 
+#define STATS_BUF_SIZE 65536
+
 CmdArg cmdLineParams[] = {
   {'f', "family", "NAME", "set voice family to NAME;"},
   {'h', "help", "", "show this help screen and exit;"},
@@ -46,6 +48,7 @@ CmdArg cmdLineParams[] = {
   {'r', "rate", "VALUE", "set speech rate to VALUE (using numbers from 0 to 100);"},
   {'S', "say", "", "say text and exit;"},
   {'s', "socket", "FILE_NAME", "connect to server via UNIX domain socket;"},
+  {'i', "stats", "", "print server runtime statistics and exit;"},
   {'q', "stop", "", "send stop command and exit (can be mixed with \'--say\');"},
   {'v', "volume", "VALUE", "set speech volume to VALUE (using numbers from 0 to 100)."},
   {' ', NULL, NULL, NULL}
@@ -254,6 +257,17 @@ int main(int argc, char* argv[])
 
   //INitial connection parameters;
   assert(con != VOICEMAN_BAD_CONNECTION);
+  if (cmdLine.used("stats"))
+    {
+      std::vector<char> buf(STATS_BUF_SIZE);
+      if (vm_stats(con, &buf[0], buf.size()) != VOICEMAN_OK)
+	{
+	  std::cerr << ERROR_PREFIX << "Could not receive statistics from server." << std::endl;
+	  return 1;
+	}
+      std::cout << &buf[0];
+      return 0;
+    }
   if (cmdLine.used("stop"))
     vm_stop(con);
   if (cmdLine.used("pitch"))
@@ -0,0 +1,150 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_TRIMMER_H__
+#define __VOICEMAN_TRIMMER_H__
+
+#include<string.h>
+#include<stdint.h>
+#include<vector>
+
+enum {TrimUnlimitedGap = (size_t)-1};
+
+/**\brief The filter of blank gaps in a stream of samples
+ *
+ * This class drops silence at the beginning and at the end of a stream
+ * and optionally shortens silence gaps inside of it. A sample is silent
+ * if its absolute value does not exceed the threshold. The stream is fed
+ * by blocks of any size, so the silent run pending at the end of one
+ * block is continued by the next one. The trailing silence is never
+ * written, exactly as the stream end is unknown until the input is
+ * closed.
+ *
+ * With zero threshold and unlimited gap length the output is the input
+ * with leading and trailing zero samples removed. In this mode zero runs
+ * are found a machine word at a time.
+ */
+template<typename T>
+class Trimmer
+{
+public:
+  /**\brief The constructor
+   *
+   * \param [in] threshold The maximum absolute value of a silent sample
+   * \param [in] maxGap The maximum number of silent samples to keep between sounds, TrimUnlimitedGap to keep all of them
+   */
+  Trimmer(unsigned int threshold = 0, size_t maxGap = TrimUnlimitedGap)
+    : m_threshold(threshold), m_maxGap(maxGap), m_started(0), m_gapLen(0) {}
+
+public:
+  /**\brief Filters the next block of samples
+   *
+   * \param [in] data The samples to filter
+   * \param [in] count The number of samples in the block
+   * \param [out] output The vector to append filtered samples to
+   */
+  void process(const T* data, size_t count, std::vector<T>& output)
+  {
+    size_t i = 0;
+    while(i < count)
+      {
+	if (!m_started)
+	  {
+	    i += findSound(data + i, count - i);
+	    if (i >= count)
+	      break;
+	    m_started = 1;
+	  }
+	if (m_gapLen == 0)
+	  {
+	    const size_t soundLen = findSilence(data + i, count - i);
+	    output.insert(output.end(), data + i, data + i + soundLen);
+	    i += soundLen;
+	    if (i >= count)
+	      break;
+	  }
+	const size_t silenceLen = findSound(data + i, count - i);
+	if (m_threshold != 0)
+	  saveGap(data + i, silenceLen);
+	m_gapLen += silenceLen;
+	i += silenceLen;
+	if (i >= count)
+	  break;
+	flushGap(output);
+      } //while();
+  }
+
+private:
+  bool isSilent(T value) const
+  {
+    const int v = (int)value;
+    return (unsigned int)(v < 0?-v:v) <= m_threshold;
+  }
+
+  size_t findSound(const T* data, size_t count) const
+  {
+    size_t i = 0;
+    if (m_threshold == 0)
+      {
+	const size_t wordLen = sizeof(uint64_t) / sizeof(T);
+	while(i + wordLen <= count)
+	  {
+	    uint64_t word;
+	    memcpy(&word, data + i, sizeof(word));
+	    if (word != 0)
+	      break;
+	    i += wordLen;
+	  } //while();
+      }
+    while(i < count && isSilent(data[i]))
+      i++;
+    return i;
+  }
+
+  size_t findSilence(const T* data, size_t count) const
+  {
+    size_t i = 0;
+    while(i < count && !isSilent(data[i]))
+      i++;
+    return i;
+  }
+
+  void saveGap(const T* data, size_t count)
+  {
+    if (m_gap.size() >= m_maxGap)
+      return;
+    const size_t toSave = m_maxGap - m_gap.size() < count?m_maxGap - m_gap.size():count;
+    m_gap.insert(m_gap.end(), data, data + toSave);
+  }
+
+  void flushGap(std::vector<T>& output)
+  {
+    const size_t keep = m_gapLen < m_maxGap?m_gapLen:m_maxGap;
+    if (m_threshold != 0)
+      output.insert(output.end(), m_gap.begin(), m_gap.begin() + keep); else
+      output.insert(output.end(), keep, (T)0);
+    m_gap.clear();
+    m_gapLen = 0;
+  }
+
+private:
+  const unsigned int m_threshold;
+  const size_t m_maxGap;
+  bool m_started;
+  size_t m_gapLen;
+  std::vector<T> m_gap;
+}; //class Trimmer;
+
+#endif //__VOICEMAN_TRIMMER_H__
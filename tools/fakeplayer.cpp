@@ -0,0 +1,209 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The stand-in player for benchmarking without audio hardware. It reads
+ * raw PCM from stdin and consumes it at the pace of real playback, or
+ * faster if the speed factor is given, or at once with zero speed. The
+ * moments of process start, the first audio data and the end of
+ * playback can be appended to the log file as lines "PID EVENT SECONDS
+ * [BYTES]", where SECONDS is the value of the monotonic clock, the same
+ * as in latency traces of the executor.
+ */
+
+#include<stdio.h>
+#include<iostream>
+#include<string>
+#include<stdlib.h>
+#include<errno.h>
+#include<time.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+#define INPUT_STREAM 0
+
+#define DEFAULT_SAMPLE_RATE 22050
+#define DEFAULT_FRAME_SIZE 2
+#define BLOCK_SIZE 4096
+
+static double getTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static void sleepUntil(double moment)
+{
+  while(1)
+    {
+      const double delay = moment - getTime();
+      if (delay <= 0)
+	return;
+      struct timespec ts;
+      ts.tv_sec = (time_t)delay;
+      ts.tv_nsec = (long)((delay - (double)ts.tv_sec) * 1000000000.0);
+      if (nanosleep(&ts, NULL) == 0)
+	return;
+    } //while(1);
+}
+
+static size_t readBlock(char* buf, size_t size)
+{
+  while(1)
+    {
+      const ssize_t count = read(INPUT_STREAM, buf, size);
+      if (count >= 0)
+	return (size_t)count;
+      if (errno == EINTR)
+	continue;
+      perror("read(stdin)");
+      exit(EXIT_FAILURE);
+    } //while(1);
+}
+
+class EventLog
+{
+public:
+  EventLog()
+    : m_fd(-1) {}
+
+  ~EventLog()
+  {
+    if (m_fd != -1)
+      close(m_fd);
+  }
+
+public:
+  bool open(const std::string& fileName)
+  {
+    m_fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    return m_fd != -1;
+  }
+
+  //Each event is written by single write() call, so several players may share one log file;
+  void event(const char* name, double moment, size_t bytes = (size_t)-1) const
+  {
+    if (m_fd == -1)
+      return;
+    char line[128];
+    int len;
+    if (bytes != (size_t)-1)
+      len = snprintf(line, sizeof(line), "%lu %s %.9f %lu\n", (unsigned long)getpid(), name, moment, (unsigned long)bytes); else
+      len = snprintf(line, sizeof(line), "%lu %s %.9f\n", (unsigned long)getpid(), name, moment);
+    if (write(m_fd, line, len) != len)
+      perror("write(log)");
+  }
+
+private:
+  int m_fd;
+}; //class EventLog;
+
+static bool parseNumber(const std::string& str, unsigned long& value)
+{
+  if (str.empty())
+    return 0;
+  char* end = NULL;
+  value = strtoul(str.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+static bool parseFactor(const std::string& str, double& value)
+{
+  if (str.empty())
+    return 0;
+  char* end = NULL;
+  value = strtod(str.c_str(), &end);
+  return *end == '\0' && value >= 0;
+}
+
+static void printHelp()
+{
+  std::cout << "Stand-in player consuming raw PCM at the pace of real playback for benchmarks." << std::endl;
+  std::cout << "This utility is part of the VOICEMAN speech system." << std::endl;
+  std::cout << "There are following command line options:" << std::endl;
+  std::cout << "\t-h, --help - print this help;" << std::endl;
+  std::cout << "\t-r N, --rate N - set sample rate to N (default " << DEFAULT_SAMPLE_RATE << ");" << std::endl;
+  std::cout << "\t-b N, --frame-size N - set size of one sample for all channels to N bytes (default " << DEFAULT_FRAME_SIZE << ");" << std::endl;
+  std::cout << "\t-x N, --speed N - play N times faster than real time, 0 consumes input at once (default 1);" << std::endl;
+  std::cout << "\t-l FILE, --log FILE - append timestamps of start, first audio data and end of playback to FILE." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  const double startTime = getTime();
+  unsigned long sampleRate = DEFAULT_SAMPLE_RATE, frameSize = DEFAULT_FRAME_SIZE;
+  double speed = 1;
+  EventLog log;
+  for(int i = 1;i < argc;i++)
+    {
+      const std::string arg = argv[i];
+      if (arg == "--help" || arg == "-h")
+	{
+	  printHelp();
+	  return 0;
+	}
+      if (i + 1 >= argc)
+	{
+	  std::cerr << "voiceman-fakeplayer:option \'" << arg << "\' is unknown or requires an argument" << std::endl;
+	  return EXIT_FAILURE;
+	}
+      const std::string value = argv[++i];
+      bool valid;
+      if (arg == "--rate" || arg == "-r")
+	valid = parseNumber(value, sampleRate) && sampleRate > 0; else
+      if (arg == "--frame-size" || arg == "-b")
+	valid = parseNumber(value, frameSize) && frameSize > 0; else
+      if (arg == "--speed" || arg == "-x")
+	valid = parseFactor(value, speed); else
+      if (arg == "--log" || arg == "-l")
+	{
+	  if (!log.open(value))
+	    {
+	      perror(value.c_str());
+	      return EXIT_FAILURE;
+	    }
+	  valid = 1;
+	} else
+	{
+	  std::cerr << "voiceman-fakeplayer:unknown command line argument \'" << arg << "\'" << std::endl;
+	  return EXIT_FAILURE;
+	}
+      if (!valid)
+	{
+	  std::cerr << "voiceman-fakeplayer:invalid value \'" << value << "\' of option \'" << arg << "\'" << std::endl;
+	  return EXIT_FAILURE;
+	}
+    } //for();
+  log.event("start", startTime);
+  const double bytesPerSecond = (double)sampleRate * (double)frameSize * speed;
+  char buf[BLOCK_SIZE];
+  size_t total = 0, count;
+  double playbackStart = 0;
+  while((count = readBlock(buf, sizeof(buf))) > 0)
+    {
+      if (total == 0)
+	{
+	  playbackStart = getTime();
+	  log.event("firstpcm", playbackStart);
+	}
+      total += count;
+      //Returns when the data read so far would have been played;
+      if (speed > 0)
+	sleepUntil(playbackStart + (double)total / bytesPerSecond);
+    } //while();
+  log.event("end", getTime(), total);
+  return 0;
+}
@@ -0,0 +1,267 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+/*
+ * The stand-in synthesizer for benchmarking without real speech
+ * engines. It produces deterministic 16-bit little-endian mono PCM:
+ * each letter or digit of the text becomes a tone of the frequency
+ * depending on the character and any other character becomes silence
+ * of the same length. The audio of a character is written as soon as
+ * its synthesis cost is spent, so the output is streamed like real
+ * synthesizers do. In framed mode the text blocks are read line by
+ * line and the audio is written in frames as persistent synthesizers
+ * must do (see executors/executorCommandHeader.h).
+ */
+
+#include<stdio.h>
+#include<iostream>
+#include<string>
+#include<vector>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<math.h>
+#include<time.h>
+#include<unistd.h>
+#include"executorCommandHeader.h"
+
+#define OUTPUT_STREAM 1
+
+#define DEFAULT_SAMPLE_RATE 22050
+#define DEFAULT_CHAR_DURATION 60
+#define AMPLITUDE 8000
+
+struct Params
+{
+  Params()
+    : sampleRate(DEFAULT_SAMPLE_RATE), charDuration(DEFAULT_CHAR_DURATION),
+      startupDelay(0), charCost(0), jitter(0), seed(1), framed(0) {}
+
+  unsigned long sampleRate;
+  unsigned long charDuration;//milliseconds of audio;
+  unsigned long startupDelay;//milliseconds;
+  unsigned long charCost;//microseconds;
+  unsigned long jitter;//percents;
+  unsigned long seed;
+  bool framed;
+}; //struct Params;
+
+static double getTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static void sleepUntil(double moment)
+{
+  while(1)
+    {
+      const double delay = moment - getTime();
+      if (delay <= 0)
+	return;
+      struct timespec ts;
+      ts.tv_sec = (time_t)delay;
+      ts.tv_nsec = (long)((delay - (double)ts.tv_sec) * 1000000000.0);
+      if (nanosleep(&ts, NULL) == 0)
+	return;
+    } //while(1);
+}
+
+static void writeBlock(const char* buf, size_t size)
+{
+  size_t written = 0;
+  while(written < size)
+    {
+      const ssize_t count = write(OUTPUT_STREAM, buf + written, size - written);
+      if (count == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  perror("write(stdout)");
+	  exit(EXIT_FAILURE);
+	}
+      written += (size_t)count;
+    } //while();
+}
+
+static void writeFrameHeader(size_t len)
+{
+  char header[WORKER_FRAME_HEADER_SIZE];
+  for(size_t i = 0;i < WORKER_FRAME_HEADER_SIZE;i++)
+    header[i] = (char)((len >> (8 * i)) & 0xff);
+  writeBlock(header, WORKER_FRAME_HEADER_SIZE);
+}
+
+class FakeSynth
+{
+public:
+  FakeSynth(const Params& params)
+    : m_params(params), m_seed(params.seed),
+      m_samples(params.sampleRate * params.charDuration / 1000), m_deadline(getTime()) {}
+
+public:
+  void startup()
+  {
+    m_deadline += withJitter((double)m_params.startupDelay / 1000);
+    sleepUntil(m_deadline);
+  }
+
+  void synth(const std::string& text)
+  {
+    if (m_deadline < getTime())
+      m_deadline = getTime();
+    for(std::string::size_type i = 0;i < text.length();i++)
+      {
+	const unsigned char c = (unsigned char)text[i];
+	//UTF-8 continuation bytes do not start new characters;
+	if ((c & 0xc0) == 0x80 || c == '\n')
+	  continue;
+	m_deadline += withJitter((double)m_params.charCost / 1000000);
+	sleepUntil(m_deadline);
+	makeAudio(c);
+	if (m_params.framed)
+	  writeFrameHeader(m_buf.size());
+	writeBlock(&m_buf[0], m_buf.size());
+      } //for();
+    if (m_params.framed)
+      writeFrameHeader(0);
+  }
+
+private:
+  double withJitter(double value)
+  {
+    if (m_params.jitter == 0)
+      return value;
+    m_seed = m_seed * 1103515245 + 12345;
+    //Uniformly distributed in the range of -jitter..+jitter percents;
+    const double deviation = (double)((m_seed >> 16) % (2 * m_params.jitter * 100 + 1)) / 10000.0 - (double)m_params.jitter / 100;
+    return value * (1 + deviation);
+  }
+
+  void makeAudio(unsigned char c)
+  {
+    m_buf.resize(m_samples * 2);
+    const bool sound = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c >= 0x80;
+    const double freq = 200 + (double)(c % 32) * 20;
+    for(size_t i = 0;i < m_samples;i++)
+      {
+	const short value = sound?(short)(AMPLITUDE * sin(M_PI * (double)i / (double)m_samples) * sin(2 * M_PI * freq * (double)i / (double)m_params.sampleRate)):0;
+	m_buf[2 * i] = (char)(value & 0xff);
+	m_buf[2 * i + 1] = (char)((value >> 8) & 0xff);
+      }
+  }
+
+private:
+  const Params& m_params;
+  unsigned long m_seed;
+  const size_t m_samples;
+  double m_deadline;
+  std::vector<char> m_buf;
+}; //class FakeSynth;
+
+static bool parseNumber(const std::string& str, unsigned long& value)
+{
+  if (str.empty())
+    return 0;
+  char* end = NULL;
+  value = strtoul(str.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+static void printHelp()
+{
+  std::cout << "Stand-in synthesizer producing deterministic 16-bit mono PCM for benchmarks." << std::endl;
+  std::cout << "This utility is part of the VOICEMAN speech system." << std::endl;
+  std::cout << "There are following command line options:" << std::endl;
+  std::cout << "\t-h, --help - print this help;" << std::endl;
+  std::cout << "\t-f, --framed - read text blocks line by line and write audio frames as persistent synthesizer;" << std::endl;
+  std::cout << "\t-r N, --rate N - set sample rate to N (default " << DEFAULT_SAMPLE_RATE << ");" << std::endl;
+  std::cout << "\t-d N, --char-duration N - produce N milliseconds of audio for each character (default " << DEFAULT_CHAR_DURATION << ");" << std::endl;
+  std::cout << "\t-s N, --startup N - wait N milliseconds before processing of input (default 0);" << std::endl;
+  std::cout << "\t-c N, --char-cost N - spend N microseconds to synthesize each character (default 0);" << std::endl;
+  std::cout << "\t-j N, --jitter N - vary startup delay and character cost randomly by N percents (default 0);" << std::endl;
+  std::cout << "\t-S N, --seed N - use N as the seed of jitter generator (default 1)." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  Params params;
+  for(int i = 1;i < argc;i++)
+    {
+      const std::string arg = argv[i];
+      if (arg == "--help" || arg == "-h")
+	{
+	  printHelp();
+	  return 0;
+	}
+      if (arg == "--framed" || arg == "-f")
+	{
+	  params.framed = 1;
+	  continue;
+	}
+      unsigned long* value = NULL;
+      if (arg == "--rate" || arg == "-r")
+	value = &params.sampleRate;
+      if (arg == "--char-duration" || arg == "-d")
+	value = &params.charDuration;
+      if (arg == "--startup" || arg == "-s")
+	value = &params.startupDelay;
+      if (arg == "--char-cost" || arg == "-c")
+	value = &params.charCost;
+      if (arg == "--jitter" || arg == "-j")
+	value = &params.jitter;
+      if (arg == "--seed" || arg == "-S")
+	value = &params.seed;
+      if (value == NULL)
+	{
+	  std::cerr << "voiceman-fakesynth:unknown command line argument \'" << arg << "\'" << std::endl;
+	  return EXIT_FAILURE;
+	}
+      if (i + 1 >= argc || !parseNumber(argv[i + 1], *value))
+	{
+	  std::cerr << "voiceman-fakesynth:option \'" << arg << "\' requires a numeric argument" << std::endl;
+	  return EXIT_FAILURE;
+	}
+      i++;
+    } //for();
+  if (params.sampleRate == 0 || params.jitter > 100)
+    {
+      std::cerr << "voiceman-fakesynth:sample rate must be positive and jitter can not exceed 100 percents" << std::endl;
+      return EXIT_FAILURE;
+    }
+  //Empty audio of a character would be taken as the end of text block in framed mode;
+  if (params.sampleRate * params.charDuration / 1000 == 0)
+    {
+      std::cerr << "voiceman-fakesynth:character duration must give at least one sample at the sample rate" << std::endl;
+      return EXIT_FAILURE;
+    }
+  FakeSynth synth(params);
+  synth.startup();
+  if (params.framed)
+    {
+      std::string line;
+      while(std::getline(std::cin, line))
+	synth.synth(line);
+      return 0;
+    }
+  std::string text;
+  char buf[4096];
+  size_t count;
+  while((count = fread(buf, 1, sizeof(buf), stdin)) > 0)
+    text.append(buf, count);
+  synth.synth(text);
+  return 0;
+}
@@ -16,93 +16,129 @@
 #include<stdio.h>
 #include<iostream>
 #include<string>
+#include<vector>
 #include<stdlib.h>
+#include<errno.h>
 #include <unistd.h>
+#include"Trimmer.h"
 
 #define INPUT_STREAM 0
 #define OUTPUT_STREAM 1
 
-template<typename T> T read();
-template<typename T> void write(T c);
+#define BLOCK_SIZE 65536
 
-template<> char read<char>()
+static size_t readBlock(char* buf, size_t size)
 {
-  char c;
-  const ssize_t count = read(INPUT_STREAM, &c, sizeof(c));
-  if (count == -1)
+  while(1)
     {
+      const ssize_t count = read(INPUT_STREAM, buf, size);
+      if (count >= 0)
+	return (size_t)count;
+      if (errno == EINTR)
+	continue;
       perror("read(stdin)");
       exit(EXIT_FAILURE);
-    }
-  if (count == 0)
-    exit(EXIT_SUCCESS);
-  return c;
+    } //while(1);
 }
 
-template<> short read<short>()
+static void writeBlock(const char* buf, size_t size)
 {
-  short c;
-  const ssize_t count = read(INPUT_STREAM, &c, sizeof(c));
-  if (count == -1)
+  size_t written = 0;
+  while(written < size)
     {
-      perror("read(stdin)");
-      exit(EXIT_FAILURE);
-    }
-  if (count < 2)
-    exit(EXIT_SUCCESS);
-  return c;
+      const ssize_t count = write(OUTPUT_STREAM, buf + written, size - written);
+      if (count == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  perror("write(stdout)");
+	  exit(EXIT_FAILURE);
+	}
+      written += (size_t)count;
+    } //while();
 }
 
-template<> void write<char>(char c)
+template<typename T> void run(unsigned int threshold, size_t maxGap)
 {
-  if (write(OUTPUT_STREAM, &c, sizeof(c)) == -1)
+  Trimmer<T> trimmer(threshold, maxGap);
+  std::vector<T> input(BLOCK_SIZE / sizeof(T)), output;
+  output.reserve(input.size());
+  char* buf = (char*)&input[0];
+  size_t filled = 0;
+  while(1)
     {
-      perror("write(stdout)");
-      exit(EXIT_FAILURE);
-    }
+      const size_t count = readBlock(buf + filled, BLOCK_SIZE - filled);
+      if (count == 0)
+	break;
+      filled += count;
+      const size_t units = filled / sizeof(T);
+      trimmer.process(&input[0], units, output);
+      if (!output.empty())
+	writeBlock((const char*)&output[0], output.size() * sizeof(T));
+      output.clear();
+      //The incomplete sample is moved to the beginning of the buffer;
+      const size_t rest = filled - units * sizeof(T);
+      memmove(buf, buf + units * sizeof(T), rest);
+      filled = rest;
+    } //while(1);
 }
 
-template<> void write<short>(short c)
+static bool parseNumber(const std::string& str, unsigned long& value)
 {
-  if (write(OUTPUT_STREAM, &c, sizeof(c)) == -1)
-    {
-      perror("write(stdout)");
-      exit(EXIT_FAILURE);
-    }
+  if (str.empty())
+    return 0;
+  char* end = NULL;
+  value = strtoul(str.c_str(), &end, 10);
+  return *end == '\0';
 }
 
-template<typename T> void run()
+static void printHelp()
 {
-  T c;
-  do {
-    c=read<T>();
-  } while(c==0);
-  while(1)
-    {
-      write<T>(c);
-      ssize_t k=-1;
-      do {
-	c=read<T>();
-	k++;
-      } while(c==0);
-      for(;k>0;k--)
-	write<T>(0);
-    } // while(1);
+  std::cout << "Utility to filter blank gaps in I/O streams." << std::endl;
+  std::cout << "This utility is part of the VOICEMAN speech system." << std::endl;
+  std::cout << "There are following command line options:" << std::endl;
+  std::cout << "\t-h, --help - print this help;" << std::endl;
+  std::cout << "\t-w, --words - set processing unit to two bytes;" << std::endl;
+  std::cout << "\t-t N, --threshold N - treat units with absolute value not greater than N as silence (default 0);" << std::endl;
+  std::cout << "\t-g N, --max-gap N - shorten silence gaps between sounds to N units (default unlimited)." << std::endl;
 }
 
 int main(int argc, char *argv[])
 {
-  if (argc == 2 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h"))
+  bool words = 0;
+  unsigned long threshold = 0, maxGap = TrimUnlimitedGap;
+  for(int i = 1;i < argc;i++)
     {
-      std::cout << "Utility to filter blank gaps in I/O streams." << std::endl;
-      std::cout << "This utility is part of the VOICEMAN speech system." << std::endl;
-      std::cout << "There are following command line options:" << std::endl;
-      std::cout << "\t-h, --help - print this help;" << std::endl;
-      std::cout << "\t-w, --words - set processing unit to two bytes." << std::endl;
-      return 0;
-    }
-  if (argc == 2 && (std::string(argv[1]) == "--words" || std::string(argv[1]) == "-w"))
-    run<short>(); else
-    run<char>();
+      const std::string arg = argv[i];
+      if (arg == "--help" || arg == "-h")
+	{
+	  printHelp();
+	  return 0;
+	}
+      if (arg == "--words" || arg == "-w")
+	{
+	  words = 1;
+	  continue;
+	}
+      if (arg == "--threshold" || arg == "-t" || arg == "--max-gap" || arg == "-g")
+	{
+	  unsigned long value;
+	  if (i + 1 >= argc || !parseNumber(argv[i + 1], value))
+	    {
+	      std::cerr << "voiceman-trim:option \'" << arg << "\' requires a numeric argument" << std::endl;
+	      return EXIT_FAILURE;
+	    }
+	  i++;
+	  if (arg == "--threshold" || arg == "-t")
+	    threshold = value; else
+	    maxGap = value;
+	  continue;
+	}
+      std::cerr << "voiceman-trim:unknown command line argument \'" << arg << "\'" << std::endl;
+      return EXIT_FAILURE;
+    } //for();
+  if (words)
+    run<short>(threshold, maxGap); else
+    run<char>(threshold, maxGap);
   return 0;
 }
@@ -0,0 +1,127 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#include<assert.h>
+#include<string.h>
+#include<string>
+#include"LineReader.h"
+
+static size_t removeCarriageReturns(char* data, size_t length)
+{
+  if (memchr(data, '\r', length) == NULL)
+    return length;
+  size_t k = 0;
+  for(size_t i = 0;i < length;i++)
+    if (data[i] != '\r')
+      data[k++] = data[i];
+  return k;
+}
+
+void LineReader::compact()
+{
+  if (m_offset >= m_buffer.size())
+    {
+      m_buffer.clear();
+      m_offset = 0;
+      m_scanned = 0;
+      return;
+    }
+  if (m_offset > 0 && m_offset >= m_buffer.size() / 2)
+    {
+      //Moving the incomplete line to the beginning, it takes no more than already consumed data;
+      m_buffer.erase(0, m_offset);
+      m_scanned -= m_offset;
+      m_offset = 0;
+    }
+}
+
+void LineReader::append(const char* data, size_t size)
+{
+  compact();
+  m_buffer.append(data, size);
+}
+
+char* LineReader::reserve(size_t size)
+{
+  compact();
+  m_reserved = m_buffer.size();
+  m_buffer.resize(m_reserved + size);
+  return &m_buffer[m_reserved];
+}
+
+void LineReader::commit(size_t size)
+{
+  assert(m_reserved + size <= m_buffer.size());
+  m_buffer.resize(m_reserved + size);
+}
+
+bool LineReader::next(LineRef& line)
+{
+  assert(m_offset <= m_scanned && m_scanned <= m_buffer.size());
+  const char* begin = m_buffer.data();
+  const char* newLine = (const char*)memchr(begin + m_scanned, '\n', m_buffer.size() - m_scanned);
+  if (newLine == NULL)
+    {
+      m_scanned = m_buffer.size();
+      return 0;
+    }
+  const size_t end = newLine - begin;
+  char* lineBegin = &m_buffer[m_offset];
+  size_t length = end - m_offset;
+  length = removeCarriageReturns(lineBegin, length);
+  line.data = lineBegin;
+  line.length = length;
+  m_offset = end + 1;
+  m_scanned = m_offset;
+  return 1;
+}
+
+bool LineReader::next(std::string& line)
+{
+  LineRef ref;
+  if (!next(ref))
+    return 0;
+  line.assign(ref.data, ref.length);
+  return 1;
+}
+
+LineRef LineReader::pending()
+{
+  assert(m_scanned == m_buffer.size());
+  LineRef line;
+  if (m_offset >= m_buffer.size())
+    return line;
+  char* lineBegin = &m_buffer[m_offset];
+  size_t length = m_buffer.size() - m_offset;
+  length = removeCarriageReturns(lineBegin, length);
+  m_buffer.resize(m_offset + length);
+  m_scanned = m_buffer.size();
+  line.data = lineBegin;
+  line.length = length;
+  return line;
+}
+
+void LineReader::dropPending()
+{
+  m_buffer.resize(m_offset);
+  m_scanned = m_offset;
+}
+
+void LineReader::clear()
+{
+  m_buffer.clear();
+  m_offset = 0;
+  m_scanned = 0;
+}
@@ -0,0 +1,127 @@
+/*
+	Copyright (c) 2000-2016 Michael Pozhidaev<michael.pozhidaev@gmail.com>
+   This file is part of the VoiceMan speech service.
+
+   VoiceMan speech service is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   VoiceMan speech service is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+*/
+
+#ifndef __VOICEMAN_LINE_READER_H__
+#define __VOICEMAN_LINE_READER_H__
+
+/**\brief The reference to a line stored in LineReader buffer
+ *
+ * The referenced data is not terminated by zero character and remains
+ * valid until next append() or clear() call of the reader object.
+ */
+struct LineRef
+{
+  LineRef()
+    : data(NULL), length(0) {}
+
+  /**\brief Makes a copy of the referenced line*/
+  std::string str() const
+  {
+    return std::string(data, length);
+  }
+
+  const char* data;
+  size_t length;
+}; //struct LineRef;
+
+/**\brief Splits incoming data onto lines
+ *
+ * This class accumulates data read from pipe or socket by blocks of any
+ * size and returns complete lines as soon as they are received. Unlike
+ * splitting of the whole pending chain on every new line, the buffer is
+ * consumed by moving an offset and every byte is scanned for a new line
+ * character only once, so draining any number of lines takes linear
+ * time. The buffer memory is reused between calls. Carriage return
+ * characters are removed from returned lines.
+ */
+class LineReader
+{
+public:
+  /**\brief The default constructor*/
+  LineReader()
+    : m_offset(0), m_scanned(0), m_reserved(0) {}
+
+public:
+  /**\brief Adds new data to the end of the buffer
+   *
+   * \param [in] data The data to add
+   * \param [in] size The size of data to add
+   */
+  void append(const char* data, size_t size);
+
+  /**\brief Provides space at the end of the buffer to read data into
+   *
+   * This method lets data to be read from a descriptor directly into the
+   * buffer with no intermediate copying. The number of bytes actually
+   * stored must be reported with commit() before any other call.
+   *
+   * \param [in] size The number of bytes to provide
+   *
+   * \return The pointer to the beginning of provided space
+   */
+  char* reserve(size_t size);
+
+  /**\brief Confirms data stored in the space provided by reserve()
+   *
+   * \param [in] size The number of stored bytes, must not exceed the reserved size
+   */
+  void commit(size_t size);
+
+  /**\brief Returns next complete line without copying
+   *
+   * \param [out] line The reference to next line
+   *
+   * \return Non-zero if next line is accessible or zero otherwise
+   */
+  bool next(LineRef& line);
+
+  /**\brief Returns a copy of next complete line
+   *
+   * \param [out] line The string to put next line to
+   *
+   * \return Non-zero if next line is accessible or zero otherwise
+   */
+  bool next(std::string& line);
+
+  /**\brief Returns the incomplete line at the end of the buffer
+   *
+   * This method must be called only after next() has returned zero.
+   * Carriage return characters are removed from the returned data.
+   *
+   * \return The reference to the incomplete line
+   */
+  LineRef pending();
+
+  /**\brief Drops the incomplete line at the end of the buffer*/
+  void dropPending();
+
+  /**\brief Removes all data keeping the allocated memory*/
+  void clear();
+
+  /**\brief Returns the size of data not returned as lines yet*/
+  size_t getPendingSize() const
+  {
+    return m_buffer.size() - m_offset;
+  }
+
+private:
+  void compact();
+
+private:
+  std::string m_buffer;
+  size_t m_offset, m_scanned, m_reserved;
+}; //class LineReader;
+
+#endif //__VOICEMAN_LINE_READER_H__
@@ -14,14 +14,16 @@
 */
 
 #include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
 #include<string>
 #include<iostream>
 #include<sys/types.h>
 #include<errno.h>
 #include<iconv.h>
+#include<ctype.h>
 #include"Transcoding.h"
 
-#define ICONV_UTF8_ID "utf8"
 #define ICONV_WSTRING_ID "utf32le"
 #define ICONV_BLOCK_SIZE 50
 #define WSTRING_BAD_CHAR L'?'
@@ -59,12 +61,6 @@ bool Transcoding::initIConv()
   m_iconvWString2IO = iconv_open(m_curIO.c_str(), ICONV_WSTRING_ID);
   if (m_iconvWString2IO==(iconv_t)-1)
     return 0;
-  m_iconvUTF82WString = iconv_open(ICONV_WSTRING_ID, ICONV_UTF8_ID);
-  if (m_iconvUTF82WString==(iconv_t)-1)
-    return 0;
-  m_iconvWString2UTF8 = iconv_open(ICONV_UTF8_ID, ICONV_WSTRING_ID);
-  if (m_iconvWString2UTF8==(iconv_t)-1)
-    return 0;
   return 1;
 }
 
@@ -81,6 +77,7 @@ bool Transcoding::initCurIO()
   for(i = 0;i < lang.length();i++)
     if (lang[i]=='.')
       d=i;
+  m_ioUTF8 = 0;
   if (d < 0)
     {
       m_curIO="US-ASCII";
@@ -90,6 +87,11 @@ bool Transcoding::initCurIO()
   for(i = d + 1;i < lang.length();i++)
     cp += lang[i];
   m_curIO = cp;
+  std::string normalized;
+  for(i = 0;i < cp.length();i++)
+    if (cp[i] != '-' && cp[i] != '_')
+      normalized += (char)toupper(cp[i]);
+  m_ioUTF8 = normalized == "UTF8";
   return 1;
 }
 
@@ -99,246 +101,293 @@ std::ostream& operator <<(std::ostream& s, const std::wstring& ws)
   return s;
 }
 
-std::wstring Transcoding::trIO2WString(const std::string& s) const
+/*
+ * UTF-8 is processed without iconv. ASCII text is found by checking
+ * eight bytes at once and such runs are copied with no decoding, only
+ * the rest of characters are processed one by one. The validation is
+ * strict: overlong forms, surrogates and values above 0x10ffff are
+ * treated as illegal sequences.
+ */
+
+enum {UTF8Complete = 0, UTF8Incomplete = 1, UTF8Illegal = 2};
+
+#define ASCII_MASK 0x8080808080808080ULL
+
+static int decodeUTF8Chars(const char* s, size_t length, std::wstring& res, size_t& processed)
 {
-  std::wstring res;
-  size_t i;
-  char* b = new char[s.length()];
-  char* bb = b;
-  for(i = 0;i < s.length();i++)
-    b[i] = s[i];
-  std::string::size_type bSize = s.length();
-  while(bSize)
+  const size_t start = res.size();
+  res.resize(start + length);
+  wchar_t* out = &res[start];
+  size_t count = 0, i = 0;
+  int status = UTF8Complete;
+  while(i < length)
     {
-      wchar_t* r = new wchar_t[ICONV_BLOCK_SIZE];
-      char* rr=(char*)r;
-      size_t rsize=ICONV_BLOCK_SIZE*sizeof(wchar_t);
-      if (iconv(m_iconvIO2WString, &b, &bSize, &rr, &rsize) == (size_t)(-1))
+      while(i + sizeof(uint64_t) <= length)
 	{
-	  if (errno == EILSEQ)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      res += WSTRING_BAD_CHAR;
-	      b++;
-	      bSize--;
-	      delete[] r;
-	      continue;
-	    } // bad sequence;
-	  if (errno == EINVAL)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      res += WSTRING_BAD_CHAR;
-	      delete[] r;
-	      break;
-	    }
-	  if (errno == E2BIG)
+	  uint64_t word;
+	  memcpy(&word, s + i, sizeof(word));
+	  if (word & ASCII_MASK)
+	    break;
+	  for(size_t k = 0;k < sizeof(uint64_t);k++)
+	    out[count + k] = (unsigned char)s[i + k];
+	  count += sizeof(uint64_t);
+	  i += sizeof(uint64_t);
+	} //while();
+      if (i >= length)
+	break;
+      const unsigned char c = s[i];
+      if (c < 0x80)
+	{
+	  out[count++] = c;
+	  i++;
+	  continue;
+	}
+      size_t need;
+      unsigned long ch;
+      if (c >= 0xc2 && c <= 0xdf)
+	{
+	  need = 1;
+	  ch = c & 0x1f;
+	} else
+	if (c >= 0xe0 && c <= 0xef)
+	  {
+	    need = 2;
+	    ch = c & 0x0f;
+	  } else
+	  if (c >= 0xf0 && c <= 0xf7)
 	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      delete[] r;
-	      continue;
-	    }
-	} // (size_t)(-1);
-      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-	res += r[i];
-      delete[] r;
-    } // while;
-  delete[] bb;
-  return res;
+	      need = 3;
+	      ch = c & 0x07;
+	    } else
+	    if (c >= 0xf8 && c <= 0xfd)
+	      {
+		//Obsolete five and six byte forms, they are never valid but are incomplete until their end;
+		need = c <= 0xfb?4:5;
+		ch = 0;
+	      } else
+	      {
+		status = UTF8Illegal;
+		break;
+	      }
+      size_t k;
+      for(k = 1;k <= need && i + k < length;k++)
+	{
+	  const unsigned char b = s[i + k];
+	  if ((b & 0xc0) != 0x80)
+	    break;
+	  ch = (ch << 6) | (b & 0x3f);
+	}
+      if (k <= need)
+	{
+	  status = i + k >= length?UTF8Incomplete:UTF8Illegal;
+	  break;
+	}
+      if (need > 3 || (need == 2 && ch < 0x800) || (need == 3 && ch < 0x10000) ||
+	  (ch >= 0xd800 && ch <= 0xdfff) || ch > 0x10ffff)
+	{
+	  status = UTF8Illegal;
+	  break;
+	}
+      out[count++] = (wchar_t)ch;
+      i += need + 1;
+    } //while();
+  res.resize(start + count);
+  processed = i;
+  return status;
 }
 
-std::string Transcoding::trWString2IO(const std::wstring& s) const
+static bool isValidUnicodeChar(wchar_t c)
 {
-  std::string res;
-  size_t i;
-  wchar_t* b = new wchar_t[s.length()];
-  char* bb = (char*)b;
-  for(i = 0;i < s.length();i++)
-    b[i] = s[i];
-  std::string::size_type bSize = s.length()*sizeof(wchar_t);
-  while(bSize)
+  const unsigned long ch = (unsigned long)c;
+  return ch <= 0x10ffff && (ch < 0xd800 || ch > 0xdfff);
+}
+
+void Transcoding::trEncodeUTF8(const std::wstring& s, std::string& res) const
+{
+  size_t length = 0;
+  for(std::wstring::size_type i = 0;i < s.length();i++)
+    {
+      const unsigned long ch = (unsigned long)s[i];
+      length += ch < 0x80?1:ch < 0x800?2:ch < 0x10000?3:4;
+    }
+  res.resize(length);
+  char* out = length > 0?&res[0]:NULL;
+  size_t count = 0;
+  for(std::wstring::size_type i = 0;i < s.length();i++)
     {
-      char* r = new char[ICONV_BLOCK_SIZE],* rr = r;
-      size_t rsize = ICONV_BLOCK_SIZE;
-      if (iconv(m_iconvWString2IO, &bb, &bSize, &rr, &rsize) == (size_t)(-1))
+      const unsigned long ch = (unsigned long)s[i];
+      if (ch < 0x80)
 	{
-	  if (errno == EILSEQ)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-		res += r[i];
-	      res += STRING_BAD_CHAR;
-	      for(i = 0;i < sizeof(wchar_t);i++)
-		bb++;
-	      bSize -= sizeof(wchar_t);
-	      delete[] r;
-	      continue;
-	    } // bad sequence;
-	  if (errno == EINVAL)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-		res += r[i];
-	      res += STRING_BAD_CHAR;
-	      delete[] r;
-	      break;
-	    }
-	  if (errno == E2BIG)
-	    {
-	      for( i= 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-		res += r[i];
-	      delete[] r;
-	      continue;
-	    }
-	} // (size_t)(-1);
-      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-	res += r[i];
-      delete[] r;
-    } // while;
-  delete[] b;
-  return res;
+	  out[count++] = (char)ch;
+	  continue;
+	}
+      if (!isValidUnicodeChar(s[i]))
+	{
+	  out[count++] = STRING_BAD_CHAR;
+	  continue;
+	}
+      if (ch < 0x800)
+	{
+	  out[count++] = (char)(0xc0 | (ch >> 6));
+	  out[count++] = (char)(0x80 | (ch & 0x3f));
+	  continue;
+	}
+      if (ch < 0x10000)
+	{
+	  out[count++] = (char)(0xe0 | (ch >> 12));
+	  out[count++] = (char)(0x80 | ((ch >> 6) & 0x3f));
+	  out[count++] = (char)(0x80 | (ch & 0x3f));
+	  continue;
+	}
+      out[count++] = (char)(0xf0 | (ch >> 18));
+      out[count++] = (char)(0x80 | ((ch >> 12) & 0x3f));
+      out[count++] = (char)(0x80 | ((ch >> 6) & 0x3f));
+      out[count++] = (char)(0x80 | (ch & 0x3f));
+    } //for();
+  res.resize(count);
 }
 
 std::string Transcoding::trEncodeUTF8(const std::wstring& s) const
 {
   std::string res;
-  size_t i;
-  wchar_t* b = new wchar_t[s.length()];
-  char* bb = (char*)b;
-  for(i = 0;i < s.length();i++)
-    b[i] = s[i];
-  std::string::size_type bSize = s.length()*sizeof(wchar_t);
-  while(bSize)
-    {
-      char* r = new char[ICONV_BLOCK_SIZE], *rr = r;
-      size_t rsize = ICONV_BLOCK_SIZE;
-      if (iconv(m_iconvWString2UTF8, &bb, &bSize, &rr, &rsize) == (size_t)(-1))
-	{
-	  if (errno == EILSEQ)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-		res += r[i];
-	      res += STRING_BAD_CHAR;
-	      for(i = 0;i < sizeof(wchar_t);i++)
-		bb++;
-	      bSize -= sizeof(wchar_t);
-	      delete[] r;
-	      continue;
-	    } // bad sequence;
-	  if (errno == EINVAL)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-		res += r[i];
-	      res += STRING_BAD_CHAR;
-	      delete[] r;
-	      break;
-	    }
-	  if (errno == E2BIG)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-		res += r[i];
-	      delete[] r;
-	      continue;
-	    }
-	} // (size_t)(-1);
-      for(i = 0;i < ICONV_BLOCK_SIZE - rsize;i++)
-	res += r[i];
-      delete[] r;
-    } // while;
-  delete[] b;
+  trEncodeUTF8(s, res);
   return res;
 }
 
 bool Transcoding::trDecodeUTF8(const std::string& s, std::wstring& res) const
 {
   res.erase();
-  size_t i;
-  char* b = new char[s.length()];
-  char* bb = b;
-  for(i = 0;i < s.length();i++)
-    b[i] = s[i];
-  std::string::size_type bSize = s.length();
-  while(bSize)
+  size_t processed;
+  return decodeUTF8Chars(s.data(), s.length(), res, processed) != UTF8Illegal;
+}
+
+void Transcoding::trReadUTF8(const char* s, size_t length, std::wstring& res) const
+{
+  res.erase();
+  size_t processed;
+  const int status = decodeUTF8Chars(s, length, res, processed);
+  if (status == UTF8Incomplete)
+    res += WSTRING_BAD_CHAR;
+  if (status == UTF8Illegal)
+    res.append(3, WSTRING_BAD_CHAR);
+}
+
+std::wstring Transcoding::trReadUTF8(const std::string& s) const
+{
+  std::wstring res;
+  trReadUTF8(s.data(), s.length(), res);
+  return res;
+}
+
+std::wstring Transcoding::trReadUTF8(const char* s, size_t length) const
+{
+  std::wstring res;
+  trReadUTF8(s, length, res);
+  return res;
+}
+
+/*
+ * The conversions between I/O charset and UNICODE put iconv() output
+ * directly into the result string growing it when needed. Illegal
+ * sequences are replaced with the question mark and skipped. If I/O
+ * charset is UTF-8 iconv() is not used at all.
+ */
+
+void Transcoding::trIO2WString(const std::string& s, std::wstring& res) const
+{
+  res.erase();
+  if (m_ioUTF8)
     {
-      wchar_t* r = new wchar_t[ICONV_BLOCK_SIZE];
-      char* rr = (char*)r;
-      size_t rsize = ICONV_BLOCK_SIZE*sizeof(wchar_t);
-      if (iconv(m_iconvUTF82WString, &b, &bSize, &rr, &rsize) == (size_t)(-1))
+      size_t pos = 0;
+      while(pos < s.length())
 	{
-	  if (errno == EILSEQ)
-	    {
-	      delete[] r;
-	      delete[] bb;
-	      return 0;
-	    } // bad sequence;
-	  if (errno == EINVAL)
-	    {
-	      delete[] r;
-	      delete[] bb;
-	      break;
-	    }
-	  if (errno == E2BIG)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      delete[] r;
-	      continue;
-	    }
-	} // (size_t)(-1);
-      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-	res += r[i];
-      delete[] r;
-    } // while;
-  delete[] bb;
-  return 1;
+	  size_t processed;
+	  const int status = decodeUTF8Chars(s.data() + pos, s.length() - pos, res, processed);
+	  pos += processed;
+	  if (status == UTF8Complete)
+	    break;
+	  res += WSTRING_BAD_CHAR;
+	  if (status == UTF8Incomplete)
+	    break;
+	  pos++;
+	} //while();
+      return;
+    }
+  char* in = const_cast<char*>(s.data());
+  size_t inSize = s.length(), count = 0;
+  res.resize(s.length());
+  while(inSize > 0)
+    {
+      if (res.size() - count < ICONV_BLOCK_SIZE)
+	res.resize(count + ICONV_BLOCK_SIZE);
+      char* out = (char*)&res[count];
+      size_t outSize = (res.size() - count) * sizeof(wchar_t);
+      const size_t converted = iconv(m_iconvIO2WString, &in, &inSize, &out, &outSize);
+      count = res.size() - outSize / sizeof(wchar_t);
+      if (converted != (size_t)-1)
+	break;
+      if (errno == E2BIG)
+	{
+	  res.resize(res.size() * 2 + ICONV_BLOCK_SIZE);
+	  continue;
+	}
+      if (count == res.size())
+	res.resize(count + ICONV_BLOCK_SIZE);
+      res[count++] = WSTRING_BAD_CHAR;
+      if (errno != EILSEQ)
+	break;
+      in++;
+      inSize--;
+    } //while();
+  res.resize(count);
 }
 
-std::wstring Transcoding::trReadUTF8(const std::string& s) const
+std::wstring Transcoding::trIO2WString(const std::string& s) const
 {
   std::wstring res;
-  size_t i;
-  char* b = new char[s.length()];
-  char* bb = b;
-  for(i = 0;i < s.length();i++)
-    b[i] = s[i];
-  std::string::size_type bSize = s.length();
-  while(bSize)
+  trIO2WString(s, res);
+  return res;
+}
+
+void Transcoding::trWString2IO(const std::wstring& s, std::string& res) const
+{
+  if (m_ioUTF8)
     {
-      wchar_t* r = new wchar_t[ICONV_BLOCK_SIZE];
-      char* rr = (char*)r;
-      size_t rsize = ICONV_BLOCK_SIZE*sizeof(wchar_t);
-      if (iconv(m_iconvUTF82WString, &b, &bSize, &rr, &rsize) == (size_t)(-1))
+      trEncodeUTF8(s, res);
+      return;
+    }
+  char* in = (char*)const_cast<wchar_t*>(s.data());
+  size_t inSize = s.length() * sizeof(wchar_t), count = 0;
+  res.resize(s.length());
+  while(inSize > 0)
+    {
+      if (res.size() - count < ICONV_BLOCK_SIZE)
+	res.resize(count + ICONV_BLOCK_SIZE);
+      char* out = &res[count];
+      size_t outSize = res.size() - count;
+      const size_t converted = iconv(m_iconvWString2IO, &in, &inSize, &out, &outSize);
+      count = res.size() - outSize;
+      if (converted != (size_t)-1)
+	break;
+      if (errno == E2BIG)
 	{
-	  if (errno == EILSEQ)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      res += WSTRING_BAD_CHAR;
-	      res += WSTRING_BAD_CHAR;
-	      res += WSTRING_BAD_CHAR;
-	      delete[] r;
-	      break;
-	    } // bad sequence;
-	  if (errno == EINVAL)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      res += WSTRING_BAD_CHAR;
-	      delete[] r;
-	      break;
-	    }
-	  if (errno == E2BIG)
-	    {
-	      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-		res += r[i];
-	      delete[] r;
-	      continue;
-	    }
-	} // (size_t)(-1);
-      for(i = 0;i < ICONV_BLOCK_SIZE - rsize / sizeof(wchar_t);i++)
-	res += r[i];
-      delete[] r;
-    } // while;
-  delete[] bb;
+	  res.resize(res.size() * 2 + ICONV_BLOCK_SIZE);
+	  continue;
+	}
+      if (count == res.size())
+	res.resize(count + ICONV_BLOCK_SIZE);
+      res[count++] = STRING_BAD_CHAR;
+      if (errno != EILSEQ)
+	break;
+      in += sizeof(wchar_t);
+      inSize -= sizeof(wchar_t);
+    } //while();
+  res.resize(count);
+}
+
+std::string Transcoding::trWString2IO(const std::wstring& s) const
+{
+  std::string res;
+  trWString2IO(s, res);
   return res;
 }
@@ -41,21 +41,52 @@ public:
    */
   std::wstring trIO2WString(const std::string& s) const;
 
+  /**\brief Converts string from default I/O charset to UNICODE into provided string
+   *
+   * This method is the same as previous one but reuses the memory of the
+   * result string object.
+   *
+   * \param [in] s The string to translate
+   * \param [out] res The string to put translated data to
+   */
+  void trIO2WString(const std::string& s, std::wstring& res) const;
+
   /**\brief Converts UNICODE string to the default charset of I/O operations*/
   std::string trWString2IO(const std::wstring& s) const;
 
+  /**\brief Converts UNICODE string to the default charset of I/O operations into provided string
+   *
+   * \param [in] s The string to translate
+   * \param [out] res The string to put translated data to
+   */
+  void trWString2IO(const std::wstring& s, std::string& res) const;
+
   /**\brief Encodes UNICODE string with UTF-8 coding system
    *
    * \param [in] s The string to encode
    */
   std::string trEncodeUTF8(const std::wstring& s) const;
 
+  /**\brief Encodes UNICODE string with UTF-8 coding system into provided string
+   *
+   * This method is the same as previous one but reuses the memory of the
+   * result string object. Characters not representable in UTF-8 are
+   * replaced with question marks.
+   *
+   * \param [in] s The string to encode
+   * \param [out] res The string to put encoded data to
+   */
+  void trEncodeUTF8(const std::wstring& s, std::string& res) const;
+
   /**\brief Decodes UTF-8 string to standart UNICODE format
    *
    * \param [in] s The string to convert 
    * \param [out] The converted string
    *
    * \return Non-zero if there no errors or zero if s is not a valid UTF-8 string
+   *
+   * An incomplete sequence at the end of the string is not an error, it
+   * is just omitted.
    */
   bool trDecodeUTF8(const std::string& s, std::wstring& res) const;
 
@@ -68,13 +99,35 @@ public:
    */
   std::wstring trReadUTF8(const std::string& s) const;
 
+  /**\brief Decodes UTF-8 data with no error indications
+   *
+   * This method is the same as previous one but takes data not stored in
+   * string object, so received data can be decoded without copying.
+   *
+   * \param [in] s The data to decode
+   * \param [in] length The length of data to decode
+   */
+  std::wstring trReadUTF8(const char* s, size_t length) const;
+
+  /**\brief Decodes UTF-8 data with no error indications into provided string
+   *
+   * This method is the same as previous one but reuses the memory of the
+   * result string object.
+   *
+   * \param [in] s The data to decode
+   * \param [in] length The length of data to decode
+   * \param [out] res The string to put decoded data to
+   */
+  void trReadUTF8(const char* s, size_t length, std::wstring& res) const;
+
 private:
   bool initIConv();
   bool initCurIO();
 
 private:
   std::string m_curIO;
-  iconv_t m_iconvIO2WString, m_iconvWString2IO, m_iconvUTF82WString, m_iconvWString2UTF8;
+  bool m_ioUTF8;
+  iconv_t m_iconvIO2WString, m_iconvWString2IO;
 }; //class Transcoding;
 
 extern Transcoding transcoding;
@@ -888,73 +888,4 @@ private:
   typename T::size_type m_end;
 };//class StringDelimitedIterator;
 
-/**\brief Splits string object to the set of lines 
- *
- * This class gets set of lines (possibly incomplete) saved in one string
- * object and splits it the separate strings until it is possible. This
- * process can be easily continued later when complete data is
- * received. This class is very useful to read strings from pipe.
- */
-template<class TStr>
-class TextQueue
-{
-public:
-  /**\brief The default constructor*/
-  TextQueue() {}
-
-  /**\brief The constructor with initial string specification
-   *
-   * \param [in] initialValue The string to split onto lines
-   */
-  TextQueue(const TStr& initialValue)
-    : m_chain(initialValue) {}
-
-  /**\brief Reads next line from string object
-   *
-   * This method checks if new line is accessible to read from string
-   * object. If it is accessible it returns next line.
-   *
-   * \param [out] line The next line from string
-   *
-   * \return Non-zero if next line is accessible or zero otherwise
-   */
-  bool next(TStr& line)
-  {
-    TStr s1, s2;
-    bool wasNewLine = 0;
-    for(typename TStr::size_type i = 0;i < m_chain.length();i++)
-      {
-	if (m_chain[i] == '\r')
-	  continue;
-	if (m_chain[i] == '\n' && !wasNewLine)
-	  {
-	    wasNewLine = 1;
-	    continue;
-	  }
-	if (!wasNewLine)
-	  s1 += m_chain[i]; else 
-	  s2 += m_chain[i];
-      } //for();
-    if (!wasNewLine)
-      return 0;
-    line = s1;
-    m_chain = s2;
-    return 1;
-  }
-
-  /**\brief Returns accessible part of incomplete line
-   *
-   * Use this method to get accessible part of of incomplete line.
-   *
-   * \return Accessible part of incomplete line 
-   */
-  TStr chain() const
-  {
-    return m_chain;
-  }
-
-private:
-  TStr m_chain;
-}; //class TextQueue;
-
 #endif //__VOICEMAN_STRINGS_H__